@@ -35,35 +35,43 @@
 #endif //precompiled headers
 
 #include <wx/fileconf.h>
+#include <unordered_map>
 
 #include "ocpn_plugin.h" //Required for OCPN plugin functions
 #include "autopilotgui_impl.h"
 
 #include "jsonreader.h"
 #include "jsonwriter.h"
+#include "sentencecapture.h"
+#include "seatalkconnection.h"
+#include "controlserver.h"
+#include "sentencerouter.h"
+#include "jsonscanner.h"
+#include "autopilotcore.h"
 
 #include "version.h"
 
-#define AUTO		1
-#define STANDBY		2
-#define AUTOWIND	3
-#define TRACK		4
-#define	WINDSHIFT	5
-#define AUTOTRACK	6
-#define OFFCOURSE	7
-#define UNKNOWN		0
-
 
 class Dlg;
+class AutopilotBus;
 class localTimer;
+class animationTimer;
 
 //----------------------------------------------------------------------------------------------------------
 //    The PlugIn Class Definition
 //----------------------------------------------------------------------------------------------------------
 
 #define CALCULATOR_TOOL_POSITION    -1          // Request default positioning of toolbar tool
+#define AUTOPILOT_POLL_MS           250         // localTimer, drives the timeouts of AutopilotCore, Init() to DeInit()
+#define AUTOPILOT_ANIMATION_MS      33          // animationTimer, 30 compass texts per second while turning
+#define AUTOPILOT_REPEAT_DELAY_MS   500         // held +-1/+-10 button, until it repeats
+#define AUTOPILOT_REPEAT_MS         200         // then 5 per second
+#define AUTOPILOT_REPEAT_SEND_MS    1000        // the repeats are collected and sent this often
+#define AUTOPILOT_BUS_MENU          (wxID_HIGHEST + 100) // first id of the bus menu of the dialog
+#define AUTOPILOT_RECONNECT_MS      1000        // first try to open a lost direct connection again
+#define AUTOPILOT_RECONNECT_MAX_MS  60000       // doubled up to this
 
-class raymarine_autopilot_pi : public opencpn_plugin_116
+class raymarine_autopilot_pi : public opencpn_plugin_116, public AutopilotSink
 {
 	
 public:
@@ -71,7 +79,6 @@ public:
 	   ~raymarine_autopilot_pi(void);
 	  void SendNMEASentence(wxString sentence);
 
-	  wxString ComputeChecksum(wxString sentence);
 //    The required PlugIn Methods
       int Init(void);
       bool DeInit(void);
@@ -86,6 +93,7 @@ public:
       wxString GetLongDescription();
 	  void SetNMEASentence(wxString &sentence_incomming);
 	  void SetPluginMessage(wxString &message_id, wxString &message_body);
+	  void SetPositionFixEx(PlugIn_Position_Fix_Ex &pfix);
 
 //    The required override PlugIn Methods
       int GetToolbarToolCount(void);
@@ -105,48 +113,71 @@ public:
       void SetCalculatorDialogWidth     (int x){ m_route_dialog_width = x;};
       void SetCalculatorDialogHeight    (int x){ m_route_dialog_height = x;};      
 	  void OnautopilotDialogClose();
-	  void AddVariationToRMCanSendOut(wxString &sentence_incomming);
-	  int			   Autopilot_Status;
-	  int			   Autopilot_Status_Before;
-	  int			   DisplayShow; // Anzahl ser $STALK,84, ... Sequenzen, bis wieder Werte anzezeigt werden.
+
+//    AutopilotSink, called from the decoder and state machine
+	  void PushSentence(const std::string &sentence);
+	  void ShowStatus(const std::string &Text);
+	  void ShowCompass(const std::string &Text);
+	  void ShowNormalColours();
+	  void ShowAlarmColours();
+	  void ShowParameter(int Parameter, int Value);
+	  void LogMessage(const std::string &Text);
+	  void LogInfo(const std::string &Text);
+	  // Seatalk sentences of the bus to its direct connection if open, the
+	  // others (the RMC with variation) always to OpenCPN
+	  void PushSentence(SeatalkConnection &Connection, const std::string &SendName, const std::string &sentence);
+
+//    Several course computers, each on its own bus. The dialog shows and
+//    steers the selected one (m_pCore), or shows all with SelectBus(-1).
+	  size_t BusCount() const { return m_Buses.size(); }
+	  AutopilotBus &Bus(size_t Index) { return *m_Buses[Index]; }
+	  int SelectedBus() const { return m_SelectedBus; }
+	  void SelectBus(int Index);
+	  void ShowAllBuses();
+	  // The state of the selected bus to the clients of the control socket
+	  // and, after a "subscribe", to the other plugins
+	  void PublishState();
+	  // Lost direct connections: closed, so OpenCPN carries the sentences,
+	  // and opened again with a backoff. From localTimer, so also while the
+	  // dialog is hidden.
+	  void CheckConnections();
+
+	  AutopilotCore	   *m_pCore;            // of the selected bus, the first one for all
 	  bool			   ShowParameters;
-	  bool			   NewAutoWindCommand;
-	  bool			   NewAutoOnStandby;
-	  bool			   ChangeValueToLast;
-	  bool			   SendTrack;
-	  int			   TimeToSendNewWaypiont;
-	  int		       GoneTimeToSendNewWaypoint;
-	  bool			   WriteMessages;
-	  bool			   WriteDebug;
-	  bool			   ModyfyRMC;
-	  bool             NewStandbyNoStandbyReceived;
-	  wxString	       STALKSendName;
-	  wxString		   STALKReceiveName;
-	  bool			   StandbySelfPressed;
-	  bool             Standbycommandreceived;
-	  bool			   NeedCompassCorrection;
-	  int			   CounterStandbySentencesReceived;
-	  int			   NoStandbyCounter;
-	  int			   SelectCounterStandby;
-	  int			   IS_standby;
-	  int			   ResponseLevel;
-	  int              RudderLevel;
-	  double           BoatVariation;
+	  bool			   CaptureSentences; // write all sentences to a session file
+	  int			   CaptureFileSize;  // MByte, reserved when the capture starts
+	  wxString		   DirectConnection; // own connection to the Seatalk bridge, empty = through OpenCPN
+	  wxString		   ControlSocket;    // endpoint for remote clients (unix:path, tcp:port), empty = off
+	  int			   DodgeChange;      // degrees of a right click on +-10
+	  int			   DodgeSeconds;     // then back, 0 = with the next right click
+	  std::vector<SteeringProfile> Profiles; // after the parameters in the parameter bar
       double           Skalefaktor;
 	  Dlg			   *m_pDialog;
-	  wxString			WayPointBearing;
 
 private:
       
 	  void OnClose( wxCloseEvent& event );
-	  int GetAutopilotMode(wxString &sentence);
-	  bool ConfirmNextWaypoint(const wxString &sentence);
-	  void GetWaypointBearing(const wxString &sentence);
-	  wxString GetAutopilotCompassCourse(wxString &sentence);
-	  wxString GetAutopilotMAGCourse(wxString &sentence);
-	  wxString GetAutopilotCompassDifferenz(wxString &sentence);
-	  char GetHexValue(char AsChar);
 	  void SetAutopilotparametersChangeable();
+	  void StartCapture();
+	  void StopCapture();
+	  void StartConnection();
+	  void ReceiveFromConnection();
+	  void StartBusConnection(size_t Index);
+	  void ReceiveFromBus(size_t Index);
+	  void CheckConnection(SeatalkConnection &Connection, AutopilotBus &Bus, const wxString &Spec);
+	  void StartControl();
+	  void ReceiveFromControl();
+	  // Client 0 are the other plugins, see SetPluginMessage()
+	  bool ExecuteRemote(int Client, const RemoteCommand &Command, std::string &Error);
+	  typedef void (raymarine_autopilot_pi::*PluginMessageHandler)(const wxString &Body);
+	  void OnStatisticsRequest(const wxString &Body);
+	  void OnCommandMessage(const wxString &Body);
+	  void OnVariationMessage(const wxString &Body);
+	  void CreateBuses();
+	  void DeleteBuses();
+	  void ShareSettings();
+	  void StartAnimation();
+	  void StopAnimation();
 	  raymarine_autopilot_pi *plugin;
   
 	  wxLog				*pLogger;
@@ -162,8 +193,50 @@ private:
 	  bool              m_bautopilotShowIcon;
 	  bool              m_bShowautopilot;
 	  wxTimer		   *p_Resettimer;
-	  int				LastCompassCourse;
-      int               WMM_receive_count;
+	  wxTimer		   *p_Animationtimer;  // only runs while the heading turns
+	  SentenceCapture   m_Capture;
+	  wxEvtHandler      m_ConnectionEvents; // pending calls are dropped with the plugin
+	  SeatalkConnection m_Connection;       // after m_ConnectionEvents, is closed first
+	  ControlServer     m_Control;          // the same
+	  std::vector<AutopilotBus *> m_Buses;  // the first one has the settings and m_Connection
+	  SentenceRouter    m_Router;           // receive name -> bus
+	  int               m_SelectedBus;      // -1 for all
+	  std::unordered_map<std::string, PluginMessageHandler> m_MessageHandlers; // by message id
+	  bool              m_StateMessages;    // RAYMARINE_AP_STATE on every change
+	  std::string       m_LastState;        // of the last one
+};
+
+// One course computer on its own Seatalk bus with its own sentence names,
+// decoder and state machine. The first bus uses the direct connection of the
+// plugin, the others can have one of their own, each with its own queue.
+class AutopilotBus : public AutopilotSink
+{
+public:
+	AutopilotBus(raymarine_autopilot_pi *pPlugin, int Index);
+
+	void PushSentence(const std::string &sentence);
+	void ShowStatus(const std::string &Text);
+	void ShowCompass(const std::string &Text);
+	void ShowNormalColours();
+	void ShowAlarmColours();
+	void ShowParameter(int Parameter, int Value);
+	void LogMessage(const std::string &Text);
+	void LogInfo(const std::string &Text);
+
+	AutopilotCore		Core;
+	SeatalkConnection	Connection;		// not used for the first bus
+	wxString			ConnectionSpec;	// empty = through OpenCPN
+	int64_t				ReconnectAt;	// ms of Core, 0 if not waiting; for the first bus of m_Connection
+	int64_t				ReconnectMs;
+	std::string			Status;			// last texts, for all buses in the dialog
+	std::string			Compass;
+
+private:
+	AutopilotBus(const AutopilotBus &);
+	AutopilotBus &operator=(const AutopilotBus &);
+
+	raymarine_autopilot_pi	*m_pPlugin;
+	int						m_Index;
 };
 
 class localTimer :public wxTimer
@@ -176,5 +249,15 @@ private:
 		raymarine_autopilot_pi *pAutopilot;
 };
 
+class animationTimer :public wxTimer
+{
+public:
+	animationTimer(raymarine_autopilot_pi *pAuto);
+	~animationTimer(){};
+	void Notify();
+private:
+		raymarine_autopilot_pi *pAutopilot;
+};
+
 
 #endif
@@ -0,0 +1,62 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _AUTOPILOTCLOCK_H_
+#define _AUTOPILOTCLOCK_H_
+
+#include <stdint.h>
+#include <chrono>
+
+// Time source of everything time dependent in the core (timeouts, waypoint
+// confirmation). Milliseconds of a monotonic clock, the zero point is free.
+class AutopilotClock
+{
+public:
+	virtual ~AutopilotClock() {}
+	virtual int64_t NowMs() const = 0;
+};
+
+// Used in the plugin
+class SteadyClock : public AutopilotClock
+{
+public:
+	int64_t NowMs() const
+	{
+		return (int64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+};
+
+// Used in the tools, the time only moves when it is set.
+class VirtualClock : public AutopilotClock
+{
+public:
+	VirtualClock() : m_Now(0) {}
+	int64_t NowMs() const { return m_Now; }
+	void Set(int64_t Now) { m_Now = Now; }
+	void Advance(int64_t Ms) { m_Now += Ms; }
+
+private:
+	int64_t m_Now;
+};
+
+#endif
@@ -0,0 +1,317 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _AUTOPILOTCORE_H_
+#define _AUTOPILOTCORE_H_
+
+// Decoder and state machine of the plugin. No wxWidgets in here, so the
+// same code runs inside OpenCPN and in the tools (replay, benchmark).
+
+#include <string>
+
+#include "autopilotclock.h"
+#include "echofilter.h"
+#include "parametercache.h"
+#include "remotecommand.h"
+#include "seastatecontrol.h"
+#include "seatalk.h"
+#include "steeringprofile.h"
+#include "steeringstats.h"
+#include "telemetry.h"
+#include "trackcontrol.h"
+
+#define AUTO		1
+#define STANDBY		2
+#define AUTOWIND	3
+#define TRACK		4
+#define	WINDSHIFT	5
+#define AUTOTRACK	6
+#define OFFCOURSE	7
+#define UNKNOWN		0
+
+// Keystrokes of a ST600x remote, sent as 86,21,Key,~Key
+#define KEY_AUTO				0x01
+#define KEY_STANDBY				0x02
+#define KEY_TRACK				0x03
+#define KEY_MINUS_1				0x05
+#define KEY_MINUS_10			0x06
+#define KEY_PLUS_1				0x07
+#define KEY_PLUS_10				0x08
+#define KEY_AUTOWIND			0x23
+#define KEY_RESPONSE_DISPLAY	0x2E
+#define KEY_RUDDERGAIN_DISPLAY	0x6E
+
+// All fields of a 0x84 datagram: 84,U6,VW,XY,0Z,0M,RR,SS,TT
+struct StatusDatagram
+{
+	int				Heading;        // degrees, U & VW
+	int				LockedCourse;   // degrees, V & XY
+	int				Rudder;         // degrees, RR signed, positive is starboard
+	int				Mode;           // Z: 0x02 auto, 0x04 vane, 0x08 track
+	int				Alarms;         // M: 0x04 off course, 0x08 wind shift
+	int				Display;        // SS: 0x10 large XTE, 0x80 "Auto Rel"
+	bool			TurningRight;   // U & 0x08
+};
+
+// Everything the state machine does to the outside world.
+// The plugin forwards to PushNMEABuffer, the dialog and wxLog.
+class AutopilotSink
+{
+public:
+	virtual ~AutopilotSink() {}
+	virtual void PushSentence(const std::string &sentence) = 0;     // complete sentence with checksum and CR LF
+	virtual void ShowStatus(const std::string &Text) = 0;
+	virtual void ShowCompass(const std::string &Text) = 0;
+	virtual void ShowNormalColours() = 0;
+	virtual void ShowAlarmColours() = 0;
+	virtual void ShowParameter(int Parameter, int Value) = 0;
+	virtual void LogMessage(const std::string &Text) = 0;
+	virtual void LogInfo(const std::string &Text) = 0;
+};
+
+class AutopilotCore
+{
+public:
+	AutopilotCore(AutopilotSink *pSink);
+	// The settings below for another bus, without the sentence names and
+	// ModyfyRMC, which is for one bus only
+	void CopySettings(const AutopilotCore &From);
+
+	void SetNMEASentence(const std::string &sentence_incomming);
+	void SetDatagram(const SeatalkDatagram &Datagram); // from a binary Seatalk connection
+	void SendNMEASentence(const std::string &sentence);
+	void SendKeystroke(int Key);
+	// Held +-1/+-10: the changes are shown at once and collected, SendCourseChange()
+	// sends all of them with the fewest keys (+6 is +10 -1 -1 -1 -1).
+	void AddCourseChange(int Change);
+	int SendCourseChange();
+	int PendingCourseChange() const { return m_HeldChange; }
+	static int CourseKeys(int Change, int &Tens, int &Ones);
+	// Locked course Heading (0 .. 359) the shorter way round, with the fewest
+	// keys of CourseKeys() sent at once. After the keys had their time the
+	// 0x84 tells what is missing, that is planned and sent again, up to
+	// TargetTries times. false if the 0x84 is not in auto. Other course keys end it.
+	bool SteerTo(int Heading);
+	int SteeringTarget() const { return m_TargetHeading; }	// -1 if none
+	// The locked course with the keys sent, -1 if not known
+	int TargetCourse() const;
+	// Around a pot or a boat: SteerTo() the locked course + Offset, after
+	// Seconds (0 = until EndDodge()) SteerTo() the course before again. The
+	// deadline runs in Poll(). Another Dodge() keeps the course before, mode
+	// keys and no data end it. false if not in auto.
+	bool Dodge(int Offset, int Seconds);
+	// Back now, false if there is no dodge or not in auto
+	bool EndDodge();
+	bool IsDodging() const { return m_DodgeCourse >= 0; }
+	std::string KeystrokeSentence(int Key) const;
+	// 0x92 of PARAMETER_... and the display key, which makes the course
+	// computer send the value back to confirm it (see ParameterTable)
+	bool WriteParameter(int Parameter, int Value);
+	// All values of Profile as one batch: the 0x92 of the values not already
+	// set, then one display key for each that can be confirmed. Its answers
+	// are not shown, the profile is shown when all are confirmed or after
+	// Parameters.ConfirmMs. Returns the number of 0x92 sent.
+	int ApplyProfile(const SteeringProfile &Profile);
+	bool IsApplyingProfile() const { return m_ProfileSent != 0; }
+	// A command of a remote client (control socket, plugin message) the way
+	// the buttons of the dialog do it. false with the reason in Error when it is refused.
+	bool Execute(const RemoteCommand &Command, std::string &Error);
+	// Mode, heading, locked course, rudder and the known parameters as JSON
+	// object, the state snapshot for the remote clients
+	std::string StateJSON() const;
+	// Own position of OpenCPN (SetPositionFixEx), for Track. COG true, SOG knots.
+	void SetPositionFix(double Lat, double Lon, double Cog, double Sog) { Track.Fix(Lat, Lon, Cog, Sog, NowMs()); }
+	void NoDataReceived();
+	// The next 0x84 is handled completely, also if it is a repeat, and the
+	// dialog gets all texts again (new dialog, new settings).
+	void Redisplay();
+
+	// Compass display between two 0x84 (one per second), extrapolated with the
+	// turn rate of the last samples. Animate() shows the text for now and is
+	// false when there is nothing to move: steady heading, no heading shown
+	// or no 0x84 for too long. IsTurning() tells whether to start animating.
+	bool IsTurning() const;
+	bool Animate();
+
+	// No data timeout, runs on the clock. Poll() must be called regularly,
+	// it calls NoDataReceived() when there was no 0x84 for NoDataTimeout ms.
+	void SetClock(AutopilotClock *pClock) { m_pClock = pClock; }
+	int64_t NowMs() const { return m_pClock->NowMs(); }
+	void StartNoDataTimeout();
+	void StopNoDataTimeout();
+	void Poll();
+
+	std::string ComputeChecksum(const std::string &sentence) const;
+	int GetAutopilotMode(const std::string &sentence) const;
+	std::string GetAutopilotCompassCourse(const std::string &sentence) const;
+	std::string GetAutopilotMAGCourse(const std::string &sentence) const;
+	std::string GetAutopilotCompassDifferenz(const std::string &sentence) const;
+	bool GetAutopilotStatus(const std::string &sentence, StatusDatagram &Status) const;
+	void GetWaypointBearing(const std::string &sentence);
+	void AddVariationToRMCanSendOut(const std::string &sentence_incomming);
+	static int GetHexValue(char AsChar);	// 0 .. 15, -1 if no hex digit
+
+	// Settings
+	bool			NewAutoWindCommand;
+	bool			NewAutoOnStandby;
+	bool			ChangeValueToLast;
+	bool			SendTrack;
+	int				TimeToSendNewWaypiont; // Sekunden
+	int				NoDataTimeout;         // ms
+	int				EchoWindow;            // ms, own sentences coming back in this time are dropped, 0 = off
+	int				CommandTimeout;        // ms, a course change not in the 0x84 after this time failed
+	int				TargetTries;           // plans of SteerTo()
+	bool			WriteMessages;
+	bool			WriteDebug;
+	bool			ModyfyRMC;
+	bool			NewStandbyNoStandbyReceived;
+	int				SelectCounterStandby;
+	std::string		STALKSendName;
+	std::string		STALKReceiveName;
+
+	// State
+	int				Autopilot_Status;
+	int				Autopilot_Status_Before;
+	int				DisplayShow; // Anzahl der $STALK,84, ... Sequenzen, bis wieder Werte angezeigt werden.
+	bool			StandbySelfPressed;
+	bool			Standbycommandreceived;
+	bool			NeedCompassCorrection;
+	int				CounterStandbySentencesReceived;
+	int				NoStandbyCounter;
+	int				IS_standby;
+	int				ResponseLevel;
+	int				RudderLevel;
+	int				LastCompassCourse;
+	double			BoatVariation;
+	int				WMM_receive_count;
+	std::string		WayPointBearing;
+	std::string		DestinationWaypoint;   // from RMB, a new one starts a new leg in Statistics
+
+	// Statistics
+	uint64_t		EchoesSuppressed;
+	uint64_t		StatusFrames;          // 0x84 received
+	uint64_t		StatusRepeats;         // of them a repeat with nothing to do, only the timeout restarted
+	uint64_t		FailedCommands;        // +-1/+-10 not in the locked course of the 0x84 after CommandTimeout
+
+	// Response, wind trim and rudder gain, asked for in Poll() when stale
+	ParameterCache	Parameters;
+
+	// Response level from the heading error and rudder of the 0x84, off by default
+	SeaStateControl	SeaState;
+
+	// Keeps the boat on the leg of RMB with course changes in auto, off by default
+	TrackControl	Track;
+
+	// Every 0x84 as heading, locked course, rudder and alarms
+	TelemetryRing	Telemetry;
+	SteeringStatistics	Statistics;
+
+private:
+	// Everything HandleStatus() reads besides the sentence and the settings.
+	struct StatusState
+	{
+		int		Autopilot_Status;
+		int		Autopilot_Status_Before;
+		int		DisplayShow;
+		bool	StandbySelfPressed;
+		bool	Standbycommandreceived;
+		bool	NeedCompassCorrection;
+		int		CounterStandbySentencesReceived;
+		int		NoStandbyCounter;
+		int		IS_standby;
+		int		LastCompassCourse;
+		int64_t	NextWaypointStart;
+		bool	TrackSent;
+
+		bool operator==(const StatusState &s) const;
+	};
+
+	// To the sink only when changed
+	void ShowStatus(const std::string &Text);
+	void ShowCompass(const std::string &Text, int Kind = 0);	// Kind COMPASS_..., 0 other text
+	// CourseText() or MAGCourseText() with the kind they composed
+	void ShowCourse(const std::string &sentence);
+	void ShowMAGCourse(const std::string &sentence);
+	void ShowNormalColours();
+	// "Course ( Difference )" and heading of the 0x84, without formatting
+	const std::string &CourseText(const std::string &sentence);
+	const std::string &MAGCourseText(const std::string &sentence);
+	void ComposeCourse(std::string &Text, int Heading) const;
+	bool TurnRate(double &DegreesPerSecond) const;
+	// The locked course expected after +-1/+-10 is shown at once, until the 0x84 has it
+	void Predict(int Key);
+	bool PredictChange(int Change);
+	bool Reconcile();
+	void CheckTarget();
+	void FollowTrack();
+	void CheckDodge();
+	void AdaptResponse();
+	bool SendParameter(int Parameter, int Value);
+	bool ProfileReceived(int Parameter);
+	void CheckProfile();
+
+	StatusState GetStatusState() const;
+	bool IsStatusRepeat(const std::string &sentence) const;
+	bool ConfirmNextWaypoint(const std::string &sentence);
+	void StatusReceived();
+	void HandleStatus(const std::string &sentence);
+	void Message(const char *Format, ...);
+	void Info(const char *Format, ...);
+
+	AutopilotSink	*m_pSink;
+	AutopilotClock	*m_pClock;
+	bool			m_TimeoutRunning;
+	bool			m_TimeoutRepeat;    // after the first 0x84 the timeout repeats, before it runs once
+	int64_t			m_TimeoutStart;
+	int64_t			m_NextWaypointStart; // "Next WayP." shown since, -1 if not
+	bool			m_TrackSent;
+	EchoFilter		m_Echoes;
+	uint64_t		m_Events;           // counts what can change the reaction to a 0x84 besides the state
+	std::string		m_LastStatus;       // last 0x84 handled
+	StatusState		m_LastStatusState;  // state after it
+	uint64_t		m_LastStatusEvents;
+	bool			m_StatusSteady;     // handling it did not change anything, a repeat can be skipped
+	TelemetrySample	m_LastSample;       // of m_LastStatus
+	bool			m_LastSampleValid;
+	bool			m_Predicted;        // m_PredictedCourse is shown instead of the locked course
+	int				m_PredictedCourse;
+	int64_t			m_PredictedSince;   // last key
+	int				m_HeldChange;       // collected by AddCourseChange(), not sent
+	int				m_TargetHeading;    // of SteerTo(), -1 if none
+	int				m_TargetTries;      // plans sent for it
+	int				m_TargetKeys;       // keys sent for it
+	int				m_DodgeCourse;      // locked course before Dodge(), -1 if none
+	int				m_DodgeOffset;
+	int64_t			m_DodgeUntil;       // back then, 0 for EndDodge()
+	SteeringProfile	m_Profile;          // being applied
+	unsigned		m_ProfileSent;      // bit of each parameter written for it, 0 if none
+	int64_t			m_ProfileStart;
+	std::string		m_CompassText;      // reused buffer of CourseText()
+	int				m_ComposedKind;     // what is in m_CompassText, COMPASS_...
+	int				m_CompassKind;      // what the display shows
+	std::string		m_AnimatedText;
+	std::string		m_ShownStatus;
+	std::string		m_ShownCompass;
+	bool			m_NormalColoursShown;
+};
+
+#endif
@@ -67,6 +67,11 @@ public:
 
 		//void OnGenerate(autopilot_pi& a);
 		void OnKlickInDisplay(wxMouseEvent& event);
+		void OnBusMenu(wxMouseEvent& event);
+		void OnSteerTo(wxMouseEvent& event);
+		void OnDodge(wxMouseEvent& event);
+		void EnableCommands(bool Enable);
+		void OnEnterDisplay(wxMouseEvent& event);
 		void OnAuto(wxCommandEvent& event);
 		void OnAutoWind(wxCommandEvent& event);
 		void OnTrack(wxCommandEvent& event);
@@ -74,6 +79,9 @@ public:
 		void OnDecrementTen(wxCommandEvent& event);
 		void OnIncrementTen(wxCommandEvent& event);
 		void OnIncrementOne(wxCommandEvent& event);
+		void OnCourseButtonDown(wxMouseEvent& event);
+		void OnCourseButtonUp(wxMouseEvent& event);
+		void OnRepeatTimer(wxTimerEvent& event);
 		void OnStandby(wxCommandEvent& event);
 		void OnActiveApp(wxCommandEvent& event);
 		void SetStatusText(wxString Text);
@@ -84,6 +92,8 @@ public:
 		void SetBgTextCompassColor(wxColour Color);
 		void OnSetParameterValue(wxCommandEvent& event);
 		void OnSelectParameter(wxCommandEvent& event);
+		void SetParameter(int Parameter, int Value);
+		void ShowProfiles();
 		void OnCloseApp(wxCloseEvent& event);
 		raymarine_autopilot_pi *plugin; 
 
@@ -97,6 +107,11 @@ private:
         bool dbg;
 		wxString     m_gpx_path;
 		short int SetToggel;
+		int          m_ValuesOf;    // parameter with its values in ParameterValue, -1 for a profile
+		wxTimer      m_RepeatTimer;
+		int          m_HeldStep;    // of the held +-1/+-10 button, 0 if none
+		int          m_HeldRepeats;
+		bool         m_HeldClick;   // the click after the press is already sent
 };
 
 
@@ -0,0 +1,141 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _CONTROLSERVER_H_
+#define _CONTROLSERVER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "autopilotclock.h"
+#include "remotecommand.h"
+
+// Local control endpoint for remote clients (tablet, push-button box):
+//
+//   unix:/tmp/raymarine_autopilot   Unix domain socket
+//   tcp:port                        TCP on 127.0.0.1
+//   tcp:host:port                   TCP on the address of host
+//
+// One JSON-RPC request per line, see RemoteCommand. A poll() driven I/O
+// thread accepts, reads, parses and limits the rate of each client; "state"
+// and "subscribe" are answered there. The steering commands go to the main
+// thread (Receive), which answers with Reply(). Publish() encodes a state
+// snapshot once, every subscribed client is sent the same buffer; a slow
+// client only misses the snapshots in between.
+// Not available on Windows.
+class ControlServer
+{
+public:
+	ControlServer();
+	~ControlServer();
+
+	bool Open(const std::string &Spec);
+	void Close();
+	bool IsOpen() const { return m_fd >= 0; }
+	const std::string &Error() const { return m_Error; }
+
+	// Called on the I/O thread when a request is queued and the last call was
+	// answered by Receive() returning false. Must only post to the main thread.
+	void SetNotify(const std::function<void()> &Notify) { m_Notify = Notify; }
+
+	// Main thread
+	bool Receive(int &Client, RemoteCommand &Command);
+	void Reply(int Client, const std::string &Line);
+	// The state as JSON object, sent as {"jsonrpc":"2.0","method":"state","params":State}.
+	// Nothing is sent when it did not change.
+	void Publish(const std::string &State);
+	// One client steers at a time: the client of the last command keeps
+	// control for HoldMs, commands of others are refused. Standby is never
+	// refused and ends the control of the client before.
+	bool Arbitrate(int Client, const RemoteCommand &Command, int64_t Now);
+
+	int						RatePerSecond;	// commands of one client, the rest is refused
+	int						Burst;
+	int64_t					HoldMs;
+	size_t					MaxClients;
+
+	std::atomic<uint64_t>	Requests;
+	std::atomic<uint64_t>	RateLimited;
+	uint64_t				Refused;		// by Arbitrate()
+
+private:
+	struct ClientState
+	{
+		int			fd;
+		int			Id;
+		std::string	In;
+		std::string	Out;			// replies
+		std::shared_ptr<const std::string>	Snapshot;	// being sent, or the last one sent
+		size_t		SnapshotSent;	// bytes of it
+		bool		Subscribed;
+		double		Tokens;
+		int64_t		TokenTime;
+	};
+	struct Request
+	{
+		int				Client;
+		RemoteCommand	Command;
+	};
+
+	ControlServer(const ControlServer &);
+	ControlServer &operator=(const ControlServer &);
+
+	int OpenUnix(const std::string &Path);
+	int OpenTcp(const std::string &Host, const std::string &Port);
+	void Run();
+	void Accept();
+	bool Read(ClientState &c);
+	bool Write(ClientState &c);
+	void Handle(ClientState &c, const std::string &Line);
+	bool Admit(ClientState &c);
+	void Wake();
+
+	int						m_fd;
+	int						m_Wake[2];		// pipe, wakes up poll() for Reply(), Publish() and Close()
+	std::string				m_Path;			// of the Unix socket, removed on Close()
+	std::string				m_Error;
+	std::vector<ClientState>		m_Clients;		// I/O thread only
+	int						m_NextId;
+	SteadyClock				m_Clock;
+	std::thread				m_Thread;
+	std::atomic<bool>		m_Stop;
+	std::atomic<bool>		m_NotifyPending;
+	std::function<void()>	m_Notify;
+
+	std::mutex				m_Mutex;		// for the members below
+	std::deque<Request>		m_Requests;
+	std::deque<std::pair<int, std::string> >	m_Replies;
+	std::shared_ptr<const std::string>	m_Snapshot;
+	std::string				m_State;		// main thread, of the last Publish()
+
+	int						m_Owner;		// main thread, client in control, -1 if none
+	int64_t					m_OwnerTime;
+};
+
+#endif
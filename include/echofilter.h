@@ -0,0 +1,98 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _ECHOFILTER_H_
+#define _ECHOFILTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// The longest plans sent at once: a course change of 175 is 17 x +10 and
+// 5 x +1 (see AutopilotCore::CourseKeys()), a profile up to 10 x 0x92 and
+// their display keys. Older fingerprints are overwritten.
+#define ECHO_FILTER_SLOTS	32
+
+// Fingerprints of the sentences sent in the last WindowMs. Send and receive
+// both use $STALK, so the OpenCPN multiplexer hands our own commands back.
+// Such an echo is found here and taken out, every sent sentence only once.
+// Fixed number of slots, no allocation. Times are ms of an AutopilotClock.
+class EchoFilter
+{
+public:
+	EchoFilter() : WindowMs(1000), m_Next(0)
+	{
+		for (size_t i = 0; i < ECHO_FILTER_SLOTS; i++)
+			m_Slots[i].Time = -1;
+	}
+
+	// FNV-1a of the sentence without CR LF and trailing spaces
+	static uint64_t Fingerprint(const std::string &sentence)
+	{
+		size_t Length = sentence.find_last_not_of(" \t\r\n");
+		Length = Length == std::string::npos ? 0 : Length + 1;
+		uint64_t Hash = 14695981039346656037ULL;
+		for (size_t i = 0; i < Length; i++)
+		{
+			Hash ^= (unsigned char)sentence[i];
+			Hash *= 1099511628211ULL;
+		}
+		return Hash;
+	}
+
+	void Sent(uint64_t Fingerprint, int64_t Now)
+	{
+		Slot &s = m_Slots[m_Next];
+		s.Fingerprint = Fingerprint;
+		s.Time = Now;
+		m_Next = (m_Next + 1) % ECHO_FILTER_SLOTS;
+	}
+
+	// true if the sentence was sent in the window, the slot is freed then
+	bool IsEcho(uint64_t Fingerprint, int64_t Now)
+	{
+		for (size_t i = 0; i < ECHO_FILTER_SLOTS; i++)
+		{
+			Slot &s = m_Slots[i];
+			if (s.Time >= 0 && s.Fingerprint == Fingerprint && Now - s.Time <= WindowMs)
+			{
+				s.Time = -1;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int		WindowMs;
+
+private:
+	struct Slot
+	{
+		uint64_t	Fingerprint;
+		int64_t		Time;	// -1 free
+	};
+
+	Slot	m_Slots[ECHO_FILTER_SLOTS];
+	size_t	m_Next;
+};
+
+#endif
@@ -0,0 +1,35 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _HEADINGTEXT_H_
+#define _HEADINGTEXT_H_
+
+// Preformatted texts of every heading "0" .. "359" and every difference
+// "-180" .. "180", made once. Out of range gives "---" and "-".
+class HeadingText
+{
+public:
+	static const char *Degrees(int Value);
+	static const char *Difference(int Value);
+};
+
+#endif
@@ -0,0 +1,53 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _JSONSCANNER_H_
+#define _JSONSCANNER_H_
+
+#include <stddef.h>
+#include <string>
+
+// Pull scanner over one JSON text, for the small messages of remote clients
+// and other plugins. The caller reads the members while they come, there is
+// no DOM; strings are only copied for the values that are needed.
+class JsonScanner
+{
+public:
+	JsonScanner(const char *pText, size_t Length) : p(pText), End(pText + Length) {}
+
+	void Space();
+	bool Peek(char c);		// next character after white space
+	bool Expect(char c);	// and skip it
+	bool AtEnd();
+	// A string into Text, NULL to skip it. \u escapes outside of ASCII
+	// become '?', no name or method needs them.
+	bool String(std::string *Text);
+	bool Integer(int &Value);	// a fraction is cut off
+	bool Number(double &Value);
+	// Any value without looking at it, its text into Text (NULL for none)
+	bool Skip(std::string *Text);
+
+	const char	*p;
+	const char	*End;
+};
+
+#endif
@@ -0,0 +1,59 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _OUTBOUNDQUEUE_H_
+#define _OUTBOUNDQUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Sentences to the course computer. They leave the queue not faster than the
+// bridge can put them on the Seatalk bus: after a sentence of n bytes the next
+// one waits n / BytesPerSecond plus MinGapMs. Filled by the plugin, emptied
+// by the I/O thread. Times are ms of an AutopilotClock.
+class OutboundQueue
+{
+public:
+	OutboundQueue();
+
+	bool Push(const std::string &sentence);
+	// The next sentence if one is due at Now, else false and Wait is the
+	// time in ms until the next one is due (-1 if the queue is empty).
+	bool Pop(int64_t Now, std::string &sentence, int64_t &Wait);
+	size_t Size() const;
+	void Clear();
+
+	int			BytesPerSecond;
+	int			MinGapMs;
+	size_t		MaxSize;
+	uint64_t	Dropped;	// queue was full
+
+private:
+	mutable std::mutex		m_Mutex;
+	std::deque<std::string>	m_Queue;
+	int64_t					m_NextSend;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _PARAMETERCACHE_H_
+#define _PARAMETERCACHE_H_
+
+#include <stdint.h>
+
+#include "parametertable.h"
+
+// Where a cached value comes from
+#define PARAMETER_NONE			0	// not known
+#define PARAMETER_BUS			1	// 0x87 / 0x91 from the course computer
+#define PARAMETER_WRITTEN		2	// sent with 0x92, not confirmed (yet)
+#define PARAMETER_CONFIRMED		3	// sent with 0x92, the course computer sent it back
+
+struct ParameterEntry
+{
+	int		Value;
+	int		Source;			// PARAMETER_NONE ...
+	int64_t	Time;			// ms of the value
+	bool	Pending;		// PendingValue sent with 0x92 and not confirmed
+	int		PendingValue;
+	int64_t	PendingTime;
+	int64_t	AskedTime;		// ms of the last query, 0 if never
+};
+
+// Autopilot parameters with source and age. Reads come from the cache. Response
+// and rudder gain can be asked for (the display keys make the course computer
+// send 0x87 / 0x91), the others are only known after writing them. The caller
+// sends the datagrams, the cache says which and counts.
+class ParameterCache
+{
+public:
+	ParameterCache();
+
+	bool Get(int Parameter, int &Value) const;	// false if not known
+	const ParameterEntry &Entry(int Parameter) const { return m_Entries[Parameter]; }
+	static bool CanAsk(int Parameter);
+	bool IsStale(int Parameter, int64_t Now) const;
+
+	// 0x87 / 0x91 received, true if it answers Ask() (and not the user)
+	bool Received(int Parameter, int Value, int64_t Now);
+	void Written(int Parameter, int Value, int64_t Now);
+	// The stale parameter to ask for now, at most one at a time, 0 if none.
+	// Also gives up writes not confirmed in ConfirmMs.
+	int Ask(int64_t Now);
+
+	int64_t		MaxAgeMs;		// older values are asked for again, 0 = never ask
+	int64_t		ConfirmMs;		// a write or a question is answered within this time
+	int64_t		RetryMs;		// after an unanswered question
+
+	uint64_t	Questions;
+	uint64_t	Confirmed;
+	uint64_t	WriteFailures;	// other value sent back or no answer
+
+private:
+	ParameterEntry	m_Entries[PARAMETER_COUNT];
+	int				m_Asking;	// parameter asked for, 0 if none
+};
+
+#endif
@@ -0,0 +1,61 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _PARAMETERTABLE_H_
+#define _PARAMETERTABLE_H_
+
+#include <string>
+
+// Parameter selection in the dialog (ParameterChoise), rows of ParameterTable
+#define PARAMETER_RESPONSE		1
+#define PARAMETER_WINDTRIM		2
+#define PARAMETER_RUDDERGAIN	3
+#define PARAMETER_COUNTERRUDDER	4
+#define PARAMETER_RUDDERLIMIT	5
+#define PARAMETER_TURNRATELIMIT	6
+#define PARAMETER_OFFCOURSELIMIT	7
+#define PARAMETER_AUTOTRIM		8
+#define PARAMETER_RUDDERDAMPING	9
+#define PARAMETER_AUTOTACKANGLE	10
+#define PARAMETER_COUNT			11
+
+// One parameter of the course computer, set with 92,02,XX,YY,00
+struct ParameterInfo
+{
+	const char	*Name;			// in the dialog and the config
+	int			Code;			// XX
+	int			Min;			// range of YY
+	int			Max;
+	int			Default;		// shown while not known
+	int			DisplayKey;		// the course computer sends the value (0x87 / 0x91), 0 if none
+};
+
+// A new parameter is a new row in src/parametertable.cpp. Row 0 is "no parameter".
+class ParameterTable
+{
+public:
+	static const ParameterInfo &Get(int Parameter);	// row 0 when out of range
+	static int Find(const std::string &Name);		// 0 if none
+	static int FindCode(int Code);					// 0 if none
+};
+
+#endif
@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _REMOTECOMMAND_H_
+#define _REMOTECOMMAND_H_
+
+#include <stddef.h>
+#include <string>
+
+// Methods of a remote client
+#define REMOTE_NONE			0
+#define REMOTE_STANDBY		1
+#define REMOTE_AUTO			2
+#define REMOTE_TRACK		3
+#define REMOTE_AUTOWIND		4
+#define REMOTE_COURSE		5	// params "change": +-n degrees
+#define REMOTE_SET			6	// params "parameter": name (or number of the table), "value"
+#define REMOTE_STATE		7	// the last state snapshot as result
+#define REMOTE_SUBSCRIBE	8	// every new state snapshot as "state" notification
+#define REMOTE_UNSUBSCRIBE	9
+#define REMOTE_HEADING		10	// params "heading": locked course to steer, 0 .. 359
+#define REMOTE_DODGE		11	// params "change": +-n degrees, "seconds": then back, 0 = until "resume"
+#define REMOTE_RESUME		12	// back to the course before the dodge
+
+// JSON-RPC 2.0 error codes
+#define REMOTE_PARSE_ERROR		-32700
+#define REMOTE_INVALID_REQUEST	-32600	// an id that is no string, number or null
+#define REMOTE_UNKNOWN_METHOD	-32601
+#define REMOTE_INVALID_PARAMS	-32602
+#define REMOTE_REFUSED			-32000	// not now: mode, other client, rate
+
+// One JSON-RPC request of a remote client, one line:
+//   {"jsonrpc":"2.0","id":7,"method":"course","params":{"change":-10}}
+// or the flat form of the plugin message RAYMARINE_AP_COMMAND:
+//   {"id":7,"command":"course","change":-10}
+// Parse() reads it in one pass without a DOM: the known members go into the
+// fields, everything else is skipped. The id is kept as it was sent and
+// copied into the reply.
+class RemoteCommand
+{
+public:
+	RemoteCommand();
+	void Clear();
+	// false with ErrorCode and Error set, Id is set if it was read and valid
+	bool Parse(const char *pText, size_t Length);
+	bool Parse(const std::string &Text) { return Parse(Text.data(), Text.length()); }
+
+	// The response line (with LF), result "ok" or the error
+	std::string Reply() const;
+	std::string Reply(int Code, const std::string &Message) const;
+	// The answer to RAYMARINE_AP_COMMAND (RAYMARINE_AP_RESULT), without LF:
+	// {"id":1,"result":"ok","state":{...}} or "error":"reason" for the result
+	std::string MessageReply(const std::string &Error, const std::string &State) const;
+	static const char *MethodName(int Method);
+
+	int				Method;			// REMOTE_...
+	std::string		Id;				// JSON text of the id, empty for a notification
+	int				Change;
+	int				Heading;
+	int				Seconds;
+	int				Parameter;		// PARAMETER_..., 0 if none
+	int				Value;
+	bool			HasValue;
+	int				ErrorCode;
+	std::string		Error;
+};
+
+#endif
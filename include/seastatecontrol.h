@@ -0,0 +1,90 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _SEASTATECONTROL_H_
+#define _SEASTATECONTROL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry.h"
+
+#define SEASTATE_WINDOW		120		// samples, 2 minutes of 0x84
+
+// Response level from the sea state. A sliding window of the last samples
+// gives the standard deviation of the heading error and the rudder work
+// (mean |change of rudder| per sample), with running sums, O(1) per sample.
+//
+//   heading error sd above RoughErrorSd                   one step up
+//   sd below CalmErrorSd and rudder work below CalmRudder one step down
+//
+// in between the level stays (hysteresis). A decision needs a full window,
+// which is started again after a change, a course change, a gap or outside
+// of auto, and there is at most one change in MinIntervalMs.
+class SeaStateControl
+{
+public:
+	SeaStateControl();
+
+	// Sample of the 0x84 and the response level now, 0 if not known or
+	// not to be changed now. Returns the level to set, 0 to keep it.
+	int Add(const TelemetrySample &Sample, int Response);
+	void Clear();
+
+	size_t Size() const { return m_Size; }
+	double ErrorSd() const;
+	double RudderWork() const;
+
+	bool		Enabled;
+	int64_t		MinIntervalMs;
+	double		CalmErrorSd;	// degrees
+	double		RoughErrorSd;
+	double		CalmRudder;		// degrees per sample
+	int			MinResponse;
+	int			MaxResponse;
+	int			CourseChange;	// degrees of the locked course that start the window again
+	int64_t		MaxGapMs;
+
+	uint64_t	Changes;
+	double		ChangeErrorSd;	// of the window of the last change
+	double		ChangeRudderWork;
+
+private:
+	struct Entry
+	{
+		int16_t	Error;
+		int16_t	RudderChange;	// |change|
+	};
+
+	Entry			m_Window[SEASTATE_WINDOW];
+	size_t			m_Head;		// next to write
+	size_t			m_Size;
+	int64_t			m_SumError;
+	int64_t			m_SumError2;
+	int64_t			m_SumRudder;
+	bool			m_HaveLast;
+	TelemetrySample	m_Last;
+	bool			m_Changed;
+	int64_t			m_LastChange;
+};
+
+#endif
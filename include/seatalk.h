@@ -0,0 +1,138 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _SEATALK_H_
+#define _SEATALK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Seatalk 1 datagram: command byte, attribute byte, data bytes.
+// The low nibble of the attribute is the number of data bytes after the
+// first one, so a datagram has 3 to 18 bytes.
+#define SEATALK_MAX_LENGTH	18
+
+struct SeatalkDatagram
+{
+	unsigned char	Data[SEATALK_MAX_LENGTH];
+	int				Length;
+};
+
+// Same text form as the NMEA <-> Seatalk converters: $STALK,84,46,2D,...*CS
+std::string SeatalkSentence(const std::string &Name, const SeatalkDatagram &Datagram);
+
+// Cuts the 9 bit Seatalk byte stream into datagrams. A byte with the 9th
+// (command) bit set starts a datagram, the attribute gives its length.
+// A command byte in the middle of a datagram (collision on the bus) throws
+// the incomplete datagram away.
+class SeatalkFramer
+{
+public:
+	SeatalkFramer();
+
+	// One 9 bit character, returns true when Datagram is complete.
+	bool Push(unsigned char Byte, bool Command, SeatalkDatagram &Datagram);
+
+	// Bytes from a serial port set up for the parity trick: space parity with
+	// PARMRK, a byte with the 9th bit set arrives as 0xFF 0x00 <byte> and a
+	// data byte 0xFF as 0xFF 0xFF. OnDatagram(const SeatalkDatagram &) is
+	// called for every complete datagram. Returns Count, all bytes are used.
+	template <class Callback> size_t PushMarked(const unsigned char *pBytes, size_t Count, Callback OnDatagram);
+
+	// 16 bit little endian words, bit 8 is the command bit (USB Seatalk readers,
+	// recorded streams).
+	template <class Callback> size_t PushWords(const unsigned char *pBytes, size_t Count, Callback OnDatagram);
+
+	void Reset();
+
+	uint64_t	Datagrams;
+	uint64_t	Errors;		// incomplete datagrams and data without a command byte
+
+private:
+	SeatalkDatagram	m_Datagram;
+	int				m_Expected;		// 0 = wait for a command byte
+	int				m_MarkState;	// PARMRK escape: 0 none, 1 after 0xFF, 2 after 0xFF 0x00
+	bool			m_HaveLowByte;
+	unsigned char	m_LowByte;
+};
+
+template <class Callback> size_t SeatalkFramer::PushMarked(const unsigned char *pBytes, size_t Count, Callback OnDatagram)
+{
+	SeatalkDatagram Datagram;
+	for (size_t i = 0; i < Count; i++)
+	{
+		unsigned char c = pBytes[i];
+		bool Command = false;
+		if (m_MarkState == 0)
+		{
+			if (c == 0xFF)
+			{
+				m_MarkState = 1;
+				continue;
+			}
+		}
+		else if (m_MarkState == 1)
+		{
+			m_MarkState = 0;
+			if (c == 0x00)
+			{
+				m_MarkState = 2;
+				continue;
+			}
+			// 0xFF 0xFF is a data byte 0xFF, anything else is not defined
+			if (c != 0xFF)
+			{
+				Errors++;
+				continue;
+			}
+		}
+		else
+		{
+			m_MarkState = 0;
+			Command = true;
+		}
+		if (Push(c, Command, Datagram))
+			OnDatagram(Datagram);
+	}
+	return Count;
+}
+
+template <class Callback> size_t SeatalkFramer::PushWords(const unsigned char *pBytes, size_t Count, Callback OnDatagram)
+{
+	SeatalkDatagram Datagram;
+	for (size_t i = 0; i < Count; i++)
+	{
+		if (!m_HaveLowByte)
+		{
+			m_LowByte = pBytes[i];
+			m_HaveLowByte = true;
+			continue;
+		}
+		m_HaveLowByte = false;
+		if (Push(m_LowByte, (pBytes[i] & 0x01) != 0, Datagram))
+			OnDatagram(Datagram);
+	}
+	return Count;
+}
+
+#endif
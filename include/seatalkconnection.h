@@ -0,0 +1,100 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _SEATALKCONNECTION_H_
+#define _SEATALKCONNECTION_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "autopilotclock.h"
+#include "outboundqueue.h"
+#include "seatalk.h"
+#include "sentencering.h"
+
+// Own connection to the NMEA <-> Seatalk bridge, past the OpenCPN multiplexer.
+//
+//   serial:/dev/ttyUSB0[:baud]   NMEA text, also a pty (default 4800 baud)
+//   seatalk:/dev/ttyUSB0         raw Seatalk with the parity trick
+//   tcp:host:port                NMEA text, TCP client
+//   udp:host:port                NMEA text, sent to host:port, received on port
+//
+// A poll() driven I/O thread reads into Inbound and writes from Outbound.
+// Not available on Windows.
+class SeatalkConnection
+{
+public:
+	SeatalkConnection();
+	~SeatalkConnection();
+
+	// Name is the Seatalk sentence name, for the text form of binary datagrams.
+	bool Open(const std::string &Spec, const std::string &Name);
+	void Close();
+	bool IsOpen() const { return m_fd >= 0; }
+	const std::string &Error() const { return m_Error; }
+
+	// Called on the I/O thread when Inbound gets data and the last call was
+	// answered by Receive() returning false. Must only post to the main thread.
+	void SetNotify(const std::function<void()> &Notify) { m_Notify = Notify; }
+
+	void Send(const std::string &sentence);
+	bool Receive(std::string &sentence);
+
+	OutboundQueue			Outbound;
+	SentenceRing			Inbound;
+	std::atomic<uint64_t>	BytesIn;
+	std::atomic<uint64_t>	BytesOut;
+	std::atomic<bool>		Lost;		// peer closed or device gone, Close() and Open() again
+
+private:
+	SeatalkConnection(const SeatalkConnection &);
+	SeatalkConnection &operator=(const SeatalkConnection &);
+
+	void Run();
+	void Read();
+	void Write(const std::string &sentence);
+	void WriteBinary(const std::string &sentence);
+	void Deliver(const char *pSentence, size_t Length);
+	int OpenSerial(const std::string &Path, int Baud, bool Binary);
+	int OpenSocket(const std::string &Host, const std::string &Port, bool Udp);
+
+	int						m_fd;
+	int						m_Wake[2];	// pipe, wakes up poll() for Send() and Close()
+	bool					m_Binary;
+	bool					m_Udp;
+	bool					m_Socket;	// tcp or udp, send() instead of write()
+	std::string				m_Name;
+	std::string				m_Error;
+	std::string				m_Line;
+	std::string				m_Peer;		// UDP, struct sockaddr of host:port
+	SeatalkFramer			m_Framer;
+	SteadyClock				m_Clock;
+	std::thread				m_Thread;
+	std::atomic<bool>		m_Stop;
+	std::atomic<bool>		m_NotifyPending;
+	std::function<void()>	m_Notify;
+};
+
+#endif
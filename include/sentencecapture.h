@@ -0,0 +1,103 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _SENTENCECAPTURE_H_
+#define _SENTENCECAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CAPTURE_INBOUND		1
+#define CAPTURE_OUTBOUND	2
+
+#define CAPTURE_MAGIC		"STCAP01"
+#define CAPTURE_VERSION		1
+
+// Session file layout (little endian, all records 8 byte aligned):
+//
+//   CaptureFileHeader
+//   record: uint64 time_ns   monotonic, nanoseconds since session start
+//           uint8  direction CAPTURE_INBOUND / CAPTURE_OUTBOUND
+//           uint8  reserved
+//           uint16 length    number of sentence bytes
+//           uint32 reserved
+//           sentence bytes, padded with 0 to the next 8 byte boundary
+//
+// The file is preallocated and zero filled, so a record with time_ns == 0 and
+// length == 0 marks the end of the data, even if the header was not updated.
+struct CaptureFileHeader
+{
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	header_size;
+	uint64_t	file_size;
+	uint64_t	used;            // bytes in use, header included
+	uint64_t	records;
+	int64_t		start_time;      // wall clock, seconds since 1970 at session start
+	uint64_t	dropped;         // records not written because the file was full
+	uint8_t		reserved[8];
+};
+
+struct CaptureRecordHeader
+{
+	uint64_t	time_ns;
+	uint8_t		direction;
+	uint8_t		reserved1;
+	uint16_t	length;
+	uint32_t	reserved2;
+};
+
+// Appends sentences to a memory mapped, preallocated session file.
+// Append() only copies into the mapping, there is no fsync() and no system
+// call on the hot path. The data reaches the disk through the page cache.
+class SentenceCapture
+{
+public:
+	SentenceCapture();
+	~SentenceCapture();
+
+	bool Open(const char *path, uint64_t size);
+	void Close();
+	bool IsOpen() const { return m_pBase != NULL; }
+	bool Append(int direction, const char *sentence, size_t length);
+	uint64_t Records() const;
+	uint64_t Dropped() const;
+
+private:
+	SentenceCapture(const SentenceCapture &);
+	SentenceCapture &operator=(const SentenceCapture &);
+
+	uint64_t NowNs() const;
+
+	unsigned char	*m_pBase;
+	uint64_t		m_Size;
+	uint64_t		m_Used;
+	int64_t			m_StartNs;
+#ifdef _WIN32
+	void			*m_hFile;
+	void			*m_hMapping;
+#else
+	int				m_fd;
+#endif
+};
+
+#endif
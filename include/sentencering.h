@@ -0,0 +1,85 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _SENTENCERING_H_
+#define _SENTENCERING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+
+#define SENTENCE_RING_SLOTS		256		// power of 2
+#define SENTENCE_RING_LENGTH	126		// NMEA allows 82, Seatalk text form 18 * 3 + name
+
+// Fixed size ring between one producer (I/O thread) and one consumer
+// (plugin). No lock and no allocation on the producer side. When the ring
+// is full the new sentence is dropped and counted.
+class SentenceRing
+{
+public:
+	SentenceRing() : Overruns(0), m_Head(0), m_Tail(0) {}
+
+	bool Push(const char *pSentence, size_t Length)
+	{
+		uint32_t Head = m_Head.load(std::memory_order_relaxed);
+		if (Head - m_Tail.load(std::memory_order_acquire) >= SENTENCE_RING_SLOTS)
+		{
+			Overruns++;
+			return false;
+		}
+		Slot &s = m_Slots[Head & (SENTENCE_RING_SLOTS - 1)];
+		if (Length > SENTENCE_RING_LENGTH)
+			Length = SENTENCE_RING_LENGTH;
+		memcpy(s.Data, pSentence, Length);
+		s.Length = (uint16_t)Length;
+		m_Head.store(Head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(std::string &sentence)
+	{
+		uint32_t Tail = m_Tail.load(std::memory_order_relaxed);
+		if (Tail == m_Head.load(std::memory_order_acquire))
+			return false;
+		const Slot &s = m_Slots[Tail & (SENTENCE_RING_SLOTS - 1)];
+		sentence.assign(s.Data, s.Length);
+		m_Tail.store(Tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	std::atomic<uint64_t>	Overruns;
+
+private:
+	struct Slot
+	{
+		uint16_t	Length;
+		char		Data[SENTENCE_RING_LENGTH];
+	};
+
+	Slot					m_Slots[SENTENCE_RING_SLOTS];
+	std::atomic<uint32_t>	m_Head;
+	std::atomic<uint32_t>	m_Tail;
+};
+
+#endif
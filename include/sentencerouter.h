@@ -0,0 +1,46 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _SENTENCEROUTER_H_
+#define _SENTENCEROUTER_H_
+
+#include <string>
+#include <unordered_map>
+
+// Seatalk sentences to their bus by the sentence name: "$STALK2,84,..." goes
+// to the bus which receives STALK2. One hash lookup per sentence, the key
+// buffer is reused, so short names do not allocate.
+class SentenceRouter
+{
+public:
+	void Add(const std::string &Name, int Bus);
+	void Clear() { m_Buses.clear(); }
+	size_t Size() const { return m_Buses.size(); }
+	// The bus of the sentence name, -1 for other sentences (RMB, RMC, ...)
+	int Route(const std::string &sentence) const;
+
+private:
+	std::unordered_map<std::string, int>	m_Buses;
+	mutable std::string						m_Key;
+};
+
+#endif
@@ -0,0 +1,51 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _STEERINGPROFILE_H_
+#define _STEERINGPROFILE_H_
+
+#include <string>
+
+#include "parametertable.h"
+
+// A named set of parameter values, one entry in the group
+// /Settings/raymarine_autopilot_pi/Profiles of the config:
+//
+//   harbour=Response=3,RudderGain=7,CounterRudder=6
+//
+// Parameters not in the text are left as they are when it is applied.
+class SteeringProfile
+{
+public:
+	SteeringProfile();
+
+	// "Name=Value,Name=Value" of the ParameterTable names, false on an
+	// unknown name or a value out of range
+	bool Parse(const std::string &Text);
+	std::string Format() const;
+	int Count() const;
+
+	std::string	Name;
+	int			Values[PARAMETER_COUNT];	// -1 if not in the profile
+};
+
+#endif
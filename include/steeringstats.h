@@ -0,0 +1,106 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _STEERINGSTATS_H_
+#define _STEERINGSTATS_H_
+
+#include <stdint.h>
+#include <string>
+
+#include "telemetry.h"
+
+// Running mean and variance (Welford), O(1) per value, no history.
+class Welford
+{
+public:
+	Welford() { Clear(); }
+	void Clear() { Count = 0; Mean = 0; m_M2 = 0; }
+	void Add(double Value)
+	{
+		Count++;
+		double Delta = Value - Mean;
+		Mean += Delta / Count;
+		m_M2 += Delta * (Value - Mean);
+	}
+	double Variance() const { return Count > 1 ? m_M2 / (Count - 1) : 0; }
+	double StdDev() const;
+
+	uint64_t	Count;
+	double		Mean;
+
+private:
+	double		m_M2;
+};
+
+// How well the course is held, for one mode or one leg.
+struct SteeringStats
+{
+	SteeringStats() { Clear(); }
+	void Clear();
+
+	Welford		HeadingError;	// degrees, heading - locked course
+	double		RudderActivity;	// sum of |change of rudder|, degrees
+	int64_t		TimeMs;			// steering in this mode / on this leg
+	int64_t		OffCourseMs;	// with off course alarm
+	int			StandbyDrops;	// went to standby without a standby command
+};
+
+#define STEERING_AUTO		0
+#define STEERING_WIND		1
+#define STEERING_TRACK		2
+#define STEERING_MODES		3
+
+// Statistics of every steering mode since the start and of the current
+// route leg (from the destination waypoint of RMB). Fed with the samples
+// of the 0x84, which are also written to the telemetry.
+class SteeringStatistics
+{
+public:
+	SteeringStatistics();
+
+	void Add(const TelemetrySample &Sample);
+	void StandbyDrop();
+	void NewLeg(const std::string &Name);
+	void Clear();
+
+	const SteeringStats &Mode(int Mode) const { return m_Modes[Mode]; }
+	const SteeringStats &Leg() const { return m_Leg; }
+	const std::string &LegName() const { return m_LegName; }
+	static const char *ModeName(int Mode);
+
+	// {"leg":{"name":..., ...},"modes":{"auto":{...},"wind":{...},"track":{...}}}
+	std::string ToJSON() const;
+
+	int64_t		MaxGapMs;		// a longer time without 0x84 is not counted
+
+private:
+	static int SteeringMode(int Flags);
+
+	SteeringStats	m_Modes[STEERING_MODES];
+	SteeringStats	m_Leg;
+	std::string		m_LegName;
+	bool			m_HaveLast;
+	int				m_LastSteeringMode;	// of the last sample in a steering mode, -1 none
+	TelemetrySample	m_Last;
+};
+
+#endif
@@ -0,0 +1,103 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Flags of a sample, from the 0x84 datagram
+#define TELEMETRY_AUTO			0x01	// Z & 0x02
+#define TELEMETRY_VANE			0x02	// Z & 0x04
+#define TELEMETRY_TRACK			0x04	// Z & 0x08
+#define TELEMETRY_TURNING_RIGHT	0x08	// U & 0x08
+#define TELEMETRY_OFFCOURSE		0x10	// M & 0x04
+#define TELEMETRY_WINDSHIFT		0x20	// M & 0x08
+#define TELEMETRY_LARGE_XTE		0x40	// SS & 0x10
+
+struct TelemetrySample
+{
+	int64_t			Time;			// ms of the AutopilotClock
+	int16_t			Heading;		// degrees
+	int16_t			LockedCourse;	// degrees
+	int8_t			Rudder;			// degrees, positive is starboard
+	uint8_t			Flags;			// TELEMETRY_...
+};
+
+// One sample, or the samples of a longer time: min / max of the heading
+// error (heading - locked course, -180 .. 179) and of the rudder, the flags
+// of all samples ored together, heading and locked course of the last one.
+struct TelemetryBucket
+{
+	int64_t			TimeFirst;
+	int64_t			TimeLast;
+	uint16_t		Count;
+	int16_t			Heading;
+	int16_t			LockedCourse;
+	int16_t			ErrorMin;
+	int16_t			ErrorMax;
+	int8_t			RudderMin;
+	int8_t			RudderMax;
+	uint8_t			Flags;
+};
+
+#define TELEMETRY_LEVELS	3
+#define TELEMETRY_BUCKETS	(300 + 360 + 240)
+
+// Steering history in constant memory. With one 0x84 per second:
+//   level 0  every sample          300 buckets   5 minutes
+//   level 1  10 samples / bucket   360 buckets   1 hour
+//   level 2  60 samples / bucket   240 buckets   4 hours
+// The oldest bucket of a level is overwritten when it is full.
+class TelemetryRing
+{
+public:
+	TelemetryRing();
+
+	void Add(const TelemetrySample &Sample);
+	void Clear();
+
+	size_t Size(int Level) const { return m_Levels[Level].Size; }
+	size_t Capacity(int Level) const;
+	size_t SamplesPerBucket(int Level) const;
+	// Index 0 is the oldest bucket of the level
+	const TelemetryBucket &At(int Level, size_t Index) const;
+	// The finest level which still reaches back Span ms, for display of a time window
+	int LevelFor(int64_t Span) const;
+
+private:
+	struct LevelRing
+	{
+		size_t			First;		// in m_Buckets
+		size_t			Head;		// next to write
+		size_t			Size;
+		TelemetryBucket	Open;		// collects the samples of the next bucket
+	};
+
+	void Push(int Level, const TelemetryBucket &Bucket);
+
+	LevelRing		m_Levels[TELEMETRY_LEVELS];
+	TelemetryBucket	m_Buckets[TELEMETRY_BUCKETS];
+};
+
+#endif
@@ -0,0 +1,96 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _TRACKCONTROL_H_
+#define _TRACKCONTROL_H_
+
+#include <stdint.h>
+#include <string>
+
+// Track following in auto for installations where the course computer cannot
+// follow RMB/APB itself. The leg ends at the destination of RMB and starts at
+// the destination before or, for the first leg, at the position when it came.
+// The own position fixes give the cross track error (XTE) and the course over
+// ground (COG). The course to make good is
+//
+//   bearing of the leg - Gain * XTE, at most MaxIntercept off the leg
+//
+// and its difference to the COG is the change of the locked course, at most
+// MaxStep and not below Deadband. Taking the COG instead of the heading
+// includes leeway, current and the variation. At most one change in
+// MinIntervalMs, the boat has to settle on the new course first.
+// Legs up to some 100 nm, the earth is flat around the start of the leg.
+class TrackControl
+{
+public:
+	TrackControl();
+
+	// Destination of RMB, a new name starts a new leg. Now in ms.
+	void Destination(const std::string &Name, double Lat, double Lon, int64_t Now);
+	// Own position, COG in degrees true and SOG in knots, NaN if not known
+	void Fix(double Lat, double Lon, double Cog, double Sog, int64_t Now);
+	void Clear();
+
+	// Change of the locked course to send now, 0 for none. Only to be asked
+	// when the autopilot is in auto and no other course change is under way.
+	int Correction(int64_t Now);
+
+	bool HasLeg() const { return m_HaveFrom && m_HaveTo; }
+	const std::string &Leg() const { return m_Name; }
+	// Of the last fix, nm, positive is starboard of the leg. false without leg or fix.
+	bool Xte(double &Nm) const;
+
+	bool		Enabled;
+	int64_t		MinIntervalMs;
+	double		Gain;			// degrees of intercept per nm XTE
+	double		MaxIntercept;	// degrees
+	int			MaxStep;		// degrees per change
+	int			Deadband;		// degrees
+	double		MinSpeed;		// knots, below the COG is not used
+	int64_t		MaxAgeMs;		// of the fix and the RMB
+
+	uint64_t	Corrections;
+	double		CorrectionXte;	// nm, at the last change
+	double		CorrectionCog;	// degrees, course to make good of the last change
+
+private:
+	bool Geometry(double &XteNm, double &Bearing) const;
+
+	bool		m_HaveFrom;
+	bool		m_HaveTo;
+	bool		m_HaveFix;
+	double		m_FromLat;
+	double		m_FromLon;
+	double		m_ToLat;
+	double		m_ToLon;
+	std::string	m_Name;
+	int64_t		m_LegTime;		// last RMB
+	double		m_Lat;
+	double		m_Lon;
+	double		m_Cog;
+	double		m_Sog;
+	int64_t		m_FixTime;
+	bool		m_Changed;
+	int64_t		m_LastChange;
+};
+
+#endif
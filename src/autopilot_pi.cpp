@@ -31,6 +31,7 @@
 #include "autopilot_pi.h"
 #include "autopilotgui_impl.h"
 #include "autopilotgui.h"
+#include <wx/filename.h>
 
 
 // the class factories, used to create and destroy instances of the PlugIn
@@ -64,10 +65,12 @@ raymarine_autopilot_pi::raymarine_autopilot_pi(void *ppimgr) :opencpn_plugin_116
       // Create the PlugIn icons
       initialize_images();
 	  m_bShowautopilot = false;
-	  Autopilot_Status = UNKNOWN;
-	  StandbySelfPressed = FALSE;
-	  LastCompassCourse = -1; // Nicht gltig
-	  NeedCompassCorrection = false;
+	  CreateBuses();
+	  m_StateMessages = false;
+	  // One hash lookup for the many messages of other plugins
+	  m_MessageHandlers["RAYMARINE_AP_STATISTICS_REQUEST"] = &raymarine_autopilot_pi::OnStatisticsRequest;
+	  m_MessageHandlers["RAYMARINE_AP_COMMAND"] = &raymarine_autopilot_pi::OnCommandMessage;
+	  m_MessageHandlers["WMM_VARIATION_BOAT"] = &raymarine_autopilot_pi::OnVariationMessage;
 	  wxLogMessage(("    Creating Raymarine Autopilot Plugin"));
 }
 
@@ -77,6 +80,7 @@ raymarine_autopilot_pi::~raymarine_autopilot_pi(void)
      _img_autopilot_pi = NULL;
      delete _img_autopilot;
      _img_autopilot = NULL;
+	 DeleteBuses();
 	 wxLogMessage(("    Deleting Raymarine Autopilot Plugin"));
 }
 
@@ -95,35 +99,38 @@ int raymarine_autopilot_pi::Init(void)
       //    Get a pointer to the opencpn configuration object
       m_pconfig = GetOCPNConfigObject();
 
-	  // Standardparameter settings
+	  // Standardparameter settings (Decoder and state machine in AutopilotCore)
+	  CreateBuses();
 	  ShowParameters = TRUE;
-	  NewAutoWindCommand = FALSE;
-	  NewAutoOnStandby = FALSE;
-	  SendTrack = FALSE;
-	  GoneTimeToSendNewWaypoint = 0;
-	  TimeToSendNewWaypiont = 10; // Default 10 Sekunden.
-	  WriteMessages = FALSE;
-	  WriteDebug = FALSE;
-	  ModyfyRMC = FALSE;
-	  STALKSendName = "STALK";
-	  STALKReceiveName = "STALK";
+	  CaptureSentences = FALSE;
+	  CaptureFileSize = 64;
+	  DirectConnection = wxEmptyString;
+	  ControlSocket = wxEmptyString;
+	  DodgeChange = 20;
+	  DodgeSeconds = 60;
 	  p_Resettimer = NULL;
-	  StandbySelfPressed = FALSE;
-	  Autopilot_Status_Before = UNKNOWN;
-	  NoStandbyCounter = 0;
-	  ResponseLevel = 0; // Unbekannter Responselevel.
-	  RudderLevel = 0; // Unbekannt
-	  Standbycommandreceived = TRUE;
-	  CounterStandbySentencesReceived = 0;
+	  p_Animationtimer = NULL;
       Skalefaktor = 1;
-	  IS_standby = 0;
-	  BoatVariation = 0x01FF;  // Not Avalibal
-      WMM_receive_count = 60; // set to No Information from WMM
-	  WayPointBearing = "unknown";
       //    And load the configuration items
       LoadConfig();
 	  if (Skalefaktor < 1 || Skalefaktor > 2.1)
 		  Skalefaktor = 1;
+	  if (CaptureSentences)
+		  StartCapture();
+	  if (!DirectConnection.IsEmpty())
+		  StartConnection();
+	  ShareSettings();
+	  for (size_t i = 1; i < m_Buses.size(); i++)
+		  if (!m_Buses[i]->ConnectionSpec.IsEmpty())
+			  StartBusConnection(i);
+	  if (!ControlSocket.IsEmpty())
+		  StartControl();
+	  // The timeouts, the dodge deadline, reconnects and the state of the
+	  // remote clients also run while the dialog is hidden
+	  p_Resettimer = new localTimer(this);
+	  p_Resettimer->Start(AUTOPILOT_POLL_MS);
+	  for (size_t i = 0; i < m_Buses.size(); i++)
+		  m_Buses[i]->Core.StartNoDataTimeout();
 	  //    This PlugIn needs a toolbar icon, so request its insertion
 	  if(m_bautopilotShowIcon)
 		m_leftclick_tool_id  = InsertPlugInTool(_T(""), _img_autopilot, _img_autopilot, wxITEM_CHECK,
@@ -131,35 +138,22 @@ int raymarine_autopilot_pi::Init(void)
              CALCULATOR_TOOL_POSITION, 0, this);
 
       m_pDialog = NULL;
-	  DisplayShow = 0;
 	  m_pDialog = new Dlg(m_parent_window, Skalefaktor);
 	  m_pDialog->plugin = this;
+	  m_pDialog->ShowProfiles();
+	  m_pDialog->EnableCommands(m_SelectedBus >= 0);
 	  m_pDialog->Move(wxPoint(m_route_dialog_x, m_route_dialog_y));
 	  if (m_bShowautopilot) {
 		  m_pDialog->Show();
-		  if (NoStandbyCounter != 0)
+		  if (m_pCore->NoStandbyCounter != 0)
 		  {
 			  m_pDialog->SetBgTextStatusColor(wxColour(255, 128, 128));
 			  m_pDialog->SetBgTextCompassColor(wxColour(255, 128, 128));
 		  }
 		  SetAutopilotparametersChangeable();
-		  // 
-		  if (NULL == p_Resettimer)
-		  {
-			  p_Resettimer = new localTimer(this);
-			  p_Resettimer->StartOnce(12000);
-		  }		  
 	  }
 	  else
-	  {
 		  m_pDialog->Hide();
-		  if (NULL != p_Resettimer)
-		  {
-			  p_Resettimer->Stop();
-			  delete p_Resettimer;
-			  p_Resettimer = NULL;
-		  }
-	  }
 	  //SetColorScheme(cs);
 
 	  return (WANTS_PREFERENCES |
@@ -203,6 +197,33 @@ bool raymarine_autopilot_pi::DeInit(void)
 		  delete p_Resettimer;
 		  p_Resettimer = NULL;
 	  }
+	StopAnimation();
+	m_Connection.Close();
+	for (size_t i = 1; i < m_Buses.size(); i++)
+		m_Buses[i]->Connection.Close();
+	StopCapture();
+	m_Control.Close();
+	if (m_Control.Requests > 0)
+		wxLogMessage(("Raymarine Autopilot: %llu requests on the control socket, %llu over the rate limit, %llu refused for another client"),
+			(unsigned long long)m_Control.Requests, (unsigned long long)m_Control.RateLimited, (unsigned long long)m_Control.Refused);
+	for (size_t i = 0; i < m_Buses.size(); i++)
+	{
+		AutopilotCore *pCore = &m_Buses[i]->Core;
+		wxString Name = wxString::FromUTF8(pCore->STALKReceiveName.c_str());
+		if (pCore->EchoesSuppressed > 0)
+			wxLogMessage(("Raymarine Autopilot %s: %llu own sentences came back and were dropped"), Name, (unsigned long long)pCore->EchoesSuppressed);
+		if (pCore->FailedCommands > 0)
+			wxLogMessage(("Raymarine Autopilot %s: %llu course changes did not arrive at the autopilot"), Name, (unsigned long long)pCore->FailedCommands);
+		if (pCore->Parameters.WriteFailures > 0)
+			wxLogMessage(("Raymarine Autopilot %s: %llu parameters were not confirmed by the autopilot"), Name, (unsigned long long)pCore->Parameters.WriteFailures);
+		if (pCore->SeaState.Changes > 0)
+			wxLogMessage(("Raymarine Autopilot %s: response changed %llu times for the sea state"), Name, (unsigned long long)pCore->SeaState.Changes);
+		if (pCore->Track.Corrections > 0)
+			wxLogMessage(("Raymarine Autopilot %s: %llu course changes to follow the track"), Name, (unsigned long long)pCore->Track.Corrections);
+		if (pCore->WriteMessages && pCore->StatusFrames > 0)
+			wxLogMessage(("Raymarine Autopilot %s: %llu of %llu 0x84 status sentences were repeats"), Name,
+				(unsigned long long)pCore->StatusRepeats, (unsigned long long)pCore->StatusFrames);
+	}
     SaveConfig();
     RequestRefresh(m_parent_window); // refresh mainn window 
     return true;
@@ -269,15 +290,18 @@ void raymarine_autopilot_pi::SetColorScheme(PI_ColorScheme cs)
 
 void raymarine_autopilot_pi::OnToolbarToolCallback(int id)
 {
+	m_pCore->Redisplay();
       if(NULL == m_pDialog)
       {
             m_pDialog = new Dlg(m_parent_window, Skalefaktor);
             m_pDialog->plugin = this;
+            m_pDialog->ShowProfiles();
+            m_pDialog->EnableCommands(m_SelectedBus >= 0);
 			m_pDialog->Move(wxPoint(m_route_dialog_x, m_route_dialog_y));
       }
 	  else
 	  {		  
-		  if (NoStandbyCounter != 0)
+		  if (m_pCore->NoStandbyCounter != 0)
 		  {
 			  m_pDialog->SetBgTextStatusColor(wxColour(255, 128, 128));
 			  m_pDialog->SetBgTextCompassColor(wxColour(255, 128, 128));
@@ -289,28 +313,17 @@ void raymarine_autopilot_pi::OnToolbarToolCallback(int id)
       //    Toggle dialog? 
       if(m_bShowautopilot) {
           m_pDialog->Show();
-		  if (NoStandbyCounter != 0)
+		  if (m_pCore->NoStandbyCounter != 0)
 		  {
 			  m_pDialog->SetBgTextStatusColor(wxColour(255, 128, 128));
 			  m_pDialog->SetBgTextCompassColor(wxColour(255, 128, 128));
 		  }
 		  SetAutopilotparametersChangeable();
-		  // 
-		  if (NULL == p_Resettimer)
-		  {
-			  p_Resettimer = new localTimer(this);
-			  p_Resettimer->StartOnce(12000);
-		  }
 	  }
 	  else
 	  {
 		  m_pDialog->Hide();
-		  if (NULL != p_Resettimer)
-		  {
-			  p_Resettimer->Stop();
-			  delete p_Resettimer;
-			  p_Resettimer = NULL;
-		  }
+		  StopAnimation();
 	  }
       // Toggle is handled by the toolbar but we must keep plugin manager b_toggle updated
       // to actual status to ensure correct status upon toolbar rebuild
@@ -332,21 +345,60 @@ bool raymarine_autopilot_pi::LoadConfig(void)
             m_route_dialog_y =  pConf->Read ( _T ( "DialogPosY" ), 20L );
          
 			ShowParameters = (bool) pConf->Read(_T("ShowParameters"), ShowParameters);
-			NewAutoWindCommand = (bool) pConf->Read(_T("NewAutoWindCommand"), NewAutoWindCommand);
-			NewAutoOnStandby = (bool) pConf->Read(_T("NewAutoOnStandby"), NewAutoOnStandby);
-			SendTrack = (bool)pConf->Read(_T("SendTrack"), SendTrack);
-			TimeToSendNewWaypiont= pConf->Read(_T("TimeToSendNewWaypiont"), TimeToSendNewWaypiont);
-			STALKSendName = pConf->Read(_T("STALKSendName"), STALKSendName);
-			STALKReceiveName = pConf->Read(_T("STALKReceiveName"), STALKReceiveName);
-			NewStandbyNoStandbyReceived = (bool) pConf->Read(_T("NewStandbyNoStandbyReceived"), NewStandbyNoStandbyReceived);
-			ChangeValueToLast = (bool)pConf->Read(_T("ChangeValueToLast"), ChangeValueToLast);
+			m_pCore->NewAutoWindCommand = (bool)pConf->Read(_T("NewAutoWindCommand"), m_pCore->NewAutoWindCommand);
+			m_pCore->NewAutoOnStandby = (bool)pConf->Read(_T("NewAutoOnStandby"), m_pCore->NewAutoOnStandby);
+			m_pCore->SendTrack = (bool)pConf->Read(_T("SendTrack"), m_pCore->SendTrack);
+			m_pCore->TimeToSendNewWaypiont = pConf->Read(_T("TimeToSendNewWaypiont"), m_pCore->TimeToSendNewWaypiont);
+			m_pCore->STALKSendName = pConf->Read(_T("STALKSendName"), wxString(m_pCore->STALKSendName)).ToStdString();
+			m_pCore->STALKReceiveName = pConf->Read(_T("STALKReceiveName"), wxString(m_pCore->STALKReceiveName)).ToStdString();
+			m_pCore->NewStandbyNoStandbyReceived = (bool)pConf->Read(_T("NewStandbyNoStandbyReceived"), m_pCore->NewStandbyNoStandbyReceived);
+			m_pCore->ChangeValueToLast = (bool)pConf->Read(_T("ChangeValueToLast"), m_pCore->ChangeValueToLast);
 			// will be set to 0 when plugin starts
 			// NoStandbyCounter = pConf->Read(_T("NoStandbyCounter"), NoStandbyCounter);
-			SelectCounterStandby = pConf->Read(_T("SelectCounterStandby"), SelectCounterStandby);
+			m_pCore->SelectCounterStandby = pConf->Read(_T("SelectCounterStandby"), m_pCore->SelectCounterStandby);
             Skalefaktor = ((double)pConf->Read(_T("Skalefaktor"), Skalefaktor)) / 10;
-			WriteMessages = (bool)pConf->Read(_T("WriteMessages"), WriteMessages);
-			WriteDebug = (bool)pConf->Read(_T("WriteDebug"), WriteDebug);
-			ModyfyRMC = (bool)pConf->Read(_T("ModyfyRMC"), ModyfyRMC);
+			m_pCore->WriteMessages = (bool)pConf->Read(_T("WriteMessages"), m_pCore->WriteMessages);
+			m_pCore->WriteDebug = (bool)pConf->Read(_T("WriteDebug"), m_pCore->WriteDebug);
+			m_pCore->ModyfyRMC = (bool)pConf->Read(_T("ModyfyRMC"), m_pCore->ModyfyRMC);
+			CaptureSentences = (bool)pConf->Read(_T("CaptureSentences"), CaptureSentences);
+			CaptureFileSize = pConf->Read(_T("CaptureFileSize"), CaptureFileSize);
+			DirectConnection = pConf->Read(_T("DirectConnection"), DirectConnection);
+			ControlSocket = pConf->Read(_T("ControlSocket"), ControlSocket);
+			DodgeChange = pConf->Read(_T("DodgeChange"), DodgeChange);
+			DodgeSeconds = pConf->Read(_T("DodgeSeconds"), DodgeSeconds);
+			m_pCore->EchoWindow = pConf->Read(_T("EchoWindow"), m_pCore->EchoWindow);
+			m_pCore->CommandTimeout = pConf->Read(_T("CommandTimeout"), m_pCore->CommandTimeout);
+			m_pCore->Parameters.MaxAgeMs = pConf->Read(_T("ParameterMaxAge"), (long)m_pCore->Parameters.MaxAgeMs);
+			m_pCore->SeaState.Enabled = (bool)pConf->Read(_T("SeaStateControl"), m_pCore->SeaState.Enabled);
+			m_pCore->SeaState.MinIntervalMs = pConf->Read(_T("SeaStateInterval"), (long)(m_pCore->SeaState.MinIntervalMs / 60000)) * 60000LL;
+			m_pCore->Track.Enabled = (bool)pConf->Read(_T("VirtualTrack"), m_pCore->Track.Enabled);
+			m_pCore->Track.MinIntervalMs = pConf->Read(_T("VirtualTrackInterval"), (long)(m_pCore->Track.MinIntervalMs / 1000)) * 1000LL;
+			m_pCore->TargetTries = pConf->Read(_T("TargetTries"), m_pCore->TargetTries);
+			// Steering profiles, one entry "Name=Value,Name=Value" each
+			Profiles.clear();
+			pConf->SetPath(_T("/Settings/raymarine_autopilot_pi/Profiles"));
+			wxString Name, Text;
+			long Index;
+			for (bool More = pConf->GetFirstEntry(Name, Index); More; More = pConf->GetNextEntry(Name, Index))
+			{
+				SteeringProfile Profile;
+				Profile.Name = Name.ToStdString();
+				if (pConf->Read(Name, &Text) && Profile.Parse(Text.ToStdString()))
+					Profiles.push_back(Profile);
+				else
+					wxLogMessage(("Raymarine Autopilot: profile %s not understood"), Name);
+			}
+			// More buses, "ReceiveName=SendName[,connection]" each
+			pConf->SetPath(_T("/Settings/raymarine_autopilot_pi/Buses"));
+			for (bool More = pConf->GetFirstEntry(Name, Index); More; More = pConf->GetNextEntry(Name, Index))
+			{
+				pConf->Read(Name, &Text);
+				AutopilotBus *pBus = new AutopilotBus(this, (int)m_Buses.size());
+				pBus->Core.STALKReceiveName = Name.ToStdString();
+				pBus->Core.STALKSendName = Text.BeforeFirst(',').IsEmpty() ? pBus->Core.STALKReceiveName : Text.BeforeFirst(',').ToStdString();
+				pBus->ConnectionSpec = Text.AfterFirst(',');
+				m_Buses.push_back(pBus);
+			}
             return true;
       }
       else
@@ -365,21 +417,49 @@ bool raymarine_autopilot_pi::SaveConfig(void)
             pConf->Write ( _T ( "DialogPosX" ),   m_route_dialog_x );
             pConf->Write ( _T ( "DialogPosY" ),   m_route_dialog_y );
 			pConf->Write(_T("ShowParameters"), ShowParameters);
-			pConf->Write(_T("NewAutoWindCommand"), NewAutoWindCommand);
-			pConf->Write(_T("NewAutoOnStandby"), NewAutoOnStandby);
-			pConf->Write(_T("SendTrack"), SendTrack);
-			pConf->Write(_T("TimeToSendNewWaypiont"), TimeToSendNewWaypiont);
-			pConf->Write(_T("STALKSendName"), STALKSendName);
-			pConf->Write(_T("STALKReceiveName"), STALKReceiveName);
-			pConf->Write(_T("NewStandbyNoStandbyReceived"), NewStandbyNoStandbyReceived);
-			pConf->Write(_T("ChangeValueToLast"), ChangeValueToLast);
+			pConf->Write(_T("NewAutoWindCommand"), m_pCore->NewAutoWindCommand);
+			pConf->Write(_T("NewAutoOnStandby"), m_pCore->NewAutoOnStandby);
+			pConf->Write(_T("SendTrack"), m_pCore->SendTrack);
+			pConf->Write(_T("TimeToSendNewWaypiont"), m_pCore->TimeToSendNewWaypiont);
+			pConf->Write(_T("STALKSendName"), wxString(m_Buses[0]->Core.STALKSendName));
+			pConf->Write(_T("STALKReceiveName"), wxString(m_Buses[0]->Core.STALKReceiveName));
+			pConf->Write(_T("NewStandbyNoStandbyReceived"), m_pCore->NewStandbyNoStandbyReceived);
+			pConf->Write(_T("ChangeValueToLast"), m_pCore->ChangeValueToLast);
 			// will be set to 0 when plugin starts
-			//pConf->Write(_T("NoStandbyCounter"), NoStandbyCounter);
-			pConf->Write(_T("SelectCounterStandby"), SelectCounterStandby);
+			//pConf->Write(_T("NoStandbyCounter"), m_pCore->NoStandbyCounter);
+			pConf->Write(_T("SelectCounterStandby"), m_pCore->SelectCounterStandby);
             pConf->Write(_T("Skalefaktor"), (int)(Skalefaktor * 10));
-			pConf->Write(_T("WriteMessages"), WriteMessages);
-			pConf->Write(_T("WriteDebug"), WriteDebug);
-			pConf->Write(_T("ModyfyRMC"), ModyfyRMC);
+			pConf->Write(_T("WriteMessages"), m_pCore->WriteMessages);
+			pConf->Write(_T("WriteDebug"), m_pCore->WriteDebug);
+			pConf->Write(_T("ModyfyRMC"), m_Buses[0]->Core.ModyfyRMC);
+			pConf->Write(_T("CaptureSentences"), CaptureSentences);
+			pConf->Write(_T("CaptureFileSize"), CaptureFileSize);
+			pConf->Write(_T("DirectConnection"), DirectConnection);
+			pConf->Write(_T("ControlSocket"), ControlSocket);
+			pConf->Write(_T("DodgeChange"), DodgeChange);
+			pConf->Write(_T("DodgeSeconds"), DodgeSeconds);
+			pConf->Write(_T("EchoWindow"), m_pCore->EchoWindow);
+			pConf->Write(_T("CommandTimeout"), m_pCore->CommandTimeout);
+			pConf->Write(_T("ParameterMaxAge"), (long)m_pCore->Parameters.MaxAgeMs);
+			pConf->Write(_T("SeaStateControl"), m_pCore->SeaState.Enabled);
+			pConf->Write(_T("SeaStateInterval"), (long)(m_pCore->SeaState.MinIntervalMs / 60000));
+			pConf->Write(_T("VirtualTrack"), m_pCore->Track.Enabled);
+			pConf->Write(_T("VirtualTrackInterval"), (long)(m_pCore->Track.MinIntervalMs / 1000));
+			pConf->Write(_T("TargetTries"), m_pCore->TargetTries);
+			pConf->DeleteGroup(_T("Profiles"));
+			pConf->SetPath(_T("/Settings/raymarine_autopilot_pi/Profiles"));
+			for (size_t i = 0; i < Profiles.size(); i++)
+				pConf->Write(wxString(Profiles[i].Name), wxString(Profiles[i].Format()));
+			pConf->SetPath(_T("/Settings/raymarine_autopilot_pi"));
+			pConf->DeleteGroup(_T("Buses"));
+			pConf->SetPath(_T("/Settings/raymarine_autopilot_pi/Buses"));
+			for (size_t i = 1; i < m_Buses.size(); i++)
+			{
+				wxString Value(m_Buses[i]->Core.STALKSendName);
+				if (!m_Buses[i]->ConnectionSpec.IsEmpty())
+					Value += _T(",") + m_Buses[i]->ConnectionSpec;
+				pConf->Write(wxString(m_Buses[i]->Core.STALKReceiveName), Value);
+			}
             return true;
       }
       else
@@ -388,23 +468,30 @@ bool raymarine_autopilot_pi::SaveConfig(void)
 
 void raymarine_autopilot_pi::ShowPreferencesDialog(wxWindow* parent)
 {
-	ParameterDialog *dialog = new ParameterDialog(this, parent, wxID_ANY, _("Autopilot Preferences"), wxPoint(m_route_dialog_x, m_route_dialog_y), wxDefaultSize, wxDEFAULT_DIALOG_STYLE);
+	// The Seatalk names and ModyfyRMC are those of the first bus, like in
+	// SaveConfig(); the other buses are named in [Settings/.../Buses].
+	// The other settings are shared by all buses.
+	AutopilotCore &First = m_Buses[0]->Core;
+	wxString Title = _("Autopilot Preferences");
+	if (m_Buses.size() > 1)
+		Title += wxString::Format(_(" - names of the first bus %s"), wxString(First.STALKReceiveName));
+	ParameterDialog *dialog = new ParameterDialog(this, parent, wxID_ANY, Title, wxPoint(m_route_dialog_x, m_route_dialog_y), wxDefaultSize, wxDEFAULT_DIALOG_STYLE);
 	dialog->Fit();
 	wxColour cl;
 	DimeWindow(dialog);
 	dialog->m_checkParameters->SetValue(ShowParameters);
-	dialog->m_SendNewAutoWind->SetValue(NewAutoWindCommand);
-	dialog->m_SendNewAutoonStandby->SetValue(NewAutoOnStandby);
-	dialog->m_ChangeValueToLast->SetValue(ChangeValueToLast);
-	dialog->m_SendTrack->SetValue(SendTrack);
-	dialog->m_TimeToSendNewWaypiont->SetValue(wxString::Format(wxT("%i"), TimeToSendNewWaypiont));
-	dialog->m_WriteMessages->SetValue(WriteMessages);
-	dialog->m_WriteDebug->SetValue(WriteDebug);
-	dialog->m_ModyfyRMC->SetValue(ModyfyRMC);
-	dialog->m_STALKsendname->SetValue(STALKSendName);
-	dialog->m_STALKreceivename->SetValue(STALKReceiveName);
+	dialog->m_SendNewAutoWind->SetValue(m_pCore->NewAutoWindCommand);
+	dialog->m_SendNewAutoonStandby->SetValue(m_pCore->NewAutoOnStandby);
+	dialog->m_ChangeValueToLast->SetValue(m_pCore->ChangeValueToLast);
+	dialog->m_SendTrack->SetValue(m_pCore->SendTrack);
+	dialog->m_TimeToSendNewWaypiont->SetValue(wxString::Format(wxT("%i"), m_pCore->TimeToSendNewWaypiont));
+	dialog->m_WriteMessages->SetValue(m_pCore->WriteMessages);
+	dialog->m_WriteDebug->SetValue(m_pCore->WriteDebug);
+	dialog->m_ModyfyRMC->SetValue(First.ModyfyRMC);
+	dialog->m_STALKsendname->SetValue(wxString(First.STALKSendName));
+	dialog->m_STALKreceivename->SetValue(wxString(First.STALKReceiveName));
     dialog->m_Skalefaktor->SetValue(round((Skalefaktor - 1) * 10));
-	if (NewAutoOnStandby == TRUE)
+	if (m_pCore->NewAutoOnStandby == TRUE)
 	{
 		dialog->m_NewStandbyNoStandbyReceived->Enable(false);
 		dialog->m_NoStandbyCounter->Enable(false);
@@ -413,28 +500,30 @@ void raymarine_autopilot_pi::ShowPreferencesDialog(wxWindow* parent)
 		dialog->m_ResetStandbyCounter->Enable(false);
 		dialog->m_SelectCounterStandby->Enable(false);
 		dialog->m_Text->Enable(false);
-		NewStandbyNoStandbyReceived = FALSE;
+		m_pCore->NewStandbyNoStandbyReceived = FALSE;
 	}
-	dialog->m_NewStandbyNoStandbyReceived->SetValue(NewStandbyNoStandbyReceived);
-	dialog->m_NoStandbyCounter->SetValue(wxString::Format(wxT("%i"), NoStandbyCounter));
-	dialog->m_SelectCounterStandby->SetSelection(SelectCounterStandby);
+	dialog->m_NewStandbyNoStandbyReceived->SetValue(m_pCore->NewStandbyNoStandbyReceived);
+	dialog->m_NoStandbyCounter->SetValue(wxString::Format(wxT("%i"), m_pCore->NoStandbyCounter));
+	dialog->m_SelectCounterStandby->SetSelection(m_pCore->SelectCounterStandby);
 	if (dialog->ShowModal() == wxID_OK)
 	{
 		ShowParameters = dialog->m_checkParameters->GetValue();
-		NewAutoWindCommand = dialog->m_SendNewAutoWind->GetValue();
-		NewAutoOnStandby = dialog->m_SendNewAutoonStandby->GetValue();
-		ChangeValueToLast = dialog->m_ChangeValueToLast->GetValue();
-		SendTrack = dialog->m_SendTrack->GetValue();
-		TimeToSendNewWaypiont = atoi(dialog->m_TimeToSendNewWaypiont->GetValue());
-		WriteMessages = dialog->m_WriteMessages->GetValue();
-		WriteDebug = dialog->m_WriteDebug->GetValue();
-		ModyfyRMC = dialog->m_ModyfyRMC->GetValue();
-		STALKSendName = dialog->m_STALKsendname->GetValue();
-		STALKReceiveName = dialog->m_STALKreceivename->GetValue();
-		NewStandbyNoStandbyReceived = dialog->m_NewStandbyNoStandbyReceived->GetValue();
-		NoStandbyCounter = atoi(dialog->m_NoStandbyCounter->GetValue());
-		SelectCounterStandby = dialog->m_SelectCounterStandby->GetSelection();
+		m_pCore->NewAutoWindCommand = dialog->m_SendNewAutoWind->GetValue();
+		m_pCore->NewAutoOnStandby = dialog->m_SendNewAutoonStandby->GetValue();
+		m_pCore->ChangeValueToLast = dialog->m_ChangeValueToLast->GetValue();
+		m_pCore->SendTrack = dialog->m_SendTrack->GetValue();
+		m_pCore->TimeToSendNewWaypiont = atoi(dialog->m_TimeToSendNewWaypiont->GetValue());
+		m_pCore->WriteMessages = dialog->m_WriteMessages->GetValue();
+		m_pCore->WriteDebug = dialog->m_WriteDebug->GetValue();
+		First.ModyfyRMC = dialog->m_ModyfyRMC->GetValue();
+		First.STALKSendName = dialog->m_STALKsendname->GetValue().ToStdString();
+		First.STALKReceiveName = dialog->m_STALKreceivename->GetValue().ToStdString();
+		m_pCore->NewStandbyNoStandbyReceived = dialog->m_NewStandbyNoStandbyReceived->GetValue();
+		m_pCore->NoStandbyCounter = atoi(dialog->m_NoStandbyCounter->GetValue());
+		m_pCore->SelectCounterStandby = dialog->m_SelectCounterStandby->GetSelection();
         Skalefaktor = 1 + (double)((double)dialog->m_Skalefaktor->GetValue() / 10);
+		ShareSettings();
+		m_pCore->Redisplay();
 		if (NULL != m_pDialog)
 		{
 			wxPoint p = m_pDialog->GetPosition();
@@ -444,6 +533,8 @@ void raymarine_autopilot_pi::ShowPreferencesDialog(wxWindow* parent)
             delete m_pDialog;
 			m_pDialog = new Dlg(m_parent_window,Skalefaktor);
 			m_pDialog->plugin = this;
+			m_pDialog->ShowProfiles();
+			m_pDialog->EnableCommands(m_SelectedBus >= 0);
 			m_pDialog->Move(wxPoint(m_route_dialog_x, m_route_dialog_y));
 			if (m_bShowautopilot)
 				m_pDialog->Show();
@@ -481,1059 +572,521 @@ void raymarine_autopilot_pi::SetAutopilotparametersChangeable()
 	}
 }
 
-void raymarine_autopilot_pi::OnautopilotDialogClose()
+void raymarine_autopilot_pi::StartCapture()
 {
-    //m_bShowautopilot = false;
-    SetToolbarItemState( m_leftclick_tool_id, m_bShowautopilot );
-    m_pDialog->Hide();
-	SaveConfig();
-    RequestRefresh(m_parent_window); // refresh main window
+	// One file per session in the private data directory of OpenCPN.
+	wxString Path = *GetpPrivateApplicationDataLocation() + wxFileName::GetPathSeparator() + _T("raymarine_autopilot_pi");
+	if (!wxFileName::DirExists(Path))
+		wxFileName::Mkdir(Path, 0755, wxPATH_MKDIR_FULL);
+	Path += wxFileName::GetPathSeparator() + wxDateTime::Now().Format(_T("capture_%Y%m%d_%H%M%S.stc"));
+	if (CaptureFileSize < 1)
+		CaptureFileSize = 1;
+	if (m_Capture.Open(Path.mb_str(), (uint64_t)CaptureFileSize * 1024 * 1024))
+		wxLogMessage(("Raymarine Autopilot: Capture sentences to %s"), Path);
+	else
+		wxLogMessage(("Raymarine Autopilot: Could not open capture file %s"), Path);
 }
 
-//Demo implementation of response mechanism
+void raymarine_autopilot_pi::StopCapture()
+{
+	if (!m_Capture.IsOpen())
+		return;
+	if (m_Capture.Dropped() != 0)
+		wxLogMessage(("Raymarine Autopilot: Capture file was full, %llu sentences not written"), (unsigned long long)m_Capture.Dropped());
+	m_Capture.Close();
+}
 
-void raymarine_autopilot_pi::SetPluginMessage(wxString &message_id, wxString &message_body)
+void raymarine_autopilot_pi::StartConnection()
 {
-    if ((WMM_receive_count < 30 && BoatVariation != 0x01FF) || !ModyfyRMC)  // Do not need so often.
-        return;
-	if (message_id == _T("WMM_VARIATION_BOAT"))
+	// The I/O thread only posts, the sentences are handled in the main thread.
+	m_Connection.SetNotify([this]() { m_ConnectionEvents.CallAfter([this]() { ReceiveFromConnection(); }); });
+	if (m_Connection.Open(std::string(DirectConnection.mb_str()), m_Buses[0]->Core.STALKReceiveName))
+		wxLogMessage(("Raymarine Autopilot: Direct connection %s"), DirectConnection);
+	else
 	{
-		wxJSONReader r;
-		wxJSONValue v;
-		r.Parse(message_body, &v);
-		BoatVariation = v[_T("Decl")].AsDouble();
-        WMM_receive_count = 0;
-	}	
+		wxLogMessage(("Raymarine Autopilot: Could not open direct connection %s: %s"), DirectConnection, wxString::FromUTF8(m_Connection.Error().c_str()));
+		m_Buses[0]->ReconnectAt = m_Buses[0]->Core.NowMs() + m_Buses[0]->ReconnectMs;
+	}
 }
 
-void raymarine_autopilot_pi::SetNMEASentence(wxString &sentence_incomming)
+void raymarine_autopilot_pi::ReceiveFromConnection()
 {
-	// SS & 0x80 : Displays "Auto Rel" on 600R  this is Next Waypoint ist Bearing !!!
-	// 
-	wxString sentence = sentence_incomming;
-	int tmp;
-
-	sentence.Trim(); // entferne Spaces
-	if (m_pDialog == NULL)
-		return;
-	if (sentence.Mid(3, 3) == "RMB")
+	std::string sentence;
+	while (m_Connection.Receive(sentence))
 	{
-		GetWaypointBearing(sentence);
-		return;
+		if (m_Capture.IsOpen())
+			m_Capture.Append(CAPTURE_INBOUND, sentence.c_str(), sentence.length());
+		if (m_pDialog != NULL)
+			m_Buses[0]->Core.SetNMEASentence(sentence);
 	}
-	if (sentence.Mid(3, 3) == "RMC" && ModyfyRMC)
+	StartAnimation();
+}
+
+void raymarine_autopilot_pi::StartBusConnection(size_t Index)
+{
+	AutopilotBus *pBus = m_Buses[Index];
+	pBus->Connection.SetNotify([this, Index]() { m_ConnectionEvents.CallAfter([this, Index]() { ReceiveFromBus(Index); }); });
+	if (pBus->Connection.Open(std::string(pBus->ConnectionSpec.mb_str()), pBus->Core.STALKReceiveName))
+		wxLogMessage(("Raymarine Autopilot: Direct connection %s for %s"), pBus->ConnectionSpec, wxString(pBus->Core.STALKReceiveName));
+	else
 	{
-        if (BoatVariation != 0x01FF) // Variation is valid from WMM
-        {
-            WMM_receive_count++;
-            if (WMM_receive_count > 60) // 60 RMC Information
-                BoatVariation = 0x01FF; // set Variation to not avalibal
-        }
-		AddVariationToRMCanSendOut(sentence);
-		return;
+		wxLogMessage(("Raymarine Autopilot: Could not open direct connection %s: %s"), pBus->ConnectionSpec, wxString::FromUTF8(pBus->Connection.Error().c_str()));
+		pBus->ReconnectAt = pBus->Core.NowMs() + pBus->ReconnectMs;
 	}
-	wxString Lsentence = "$" + STALKReceiveName + ",84",
-		     Lsentence_Command = "$" + STALKReceiveName + ",86",
-	         Lsentence_Response = "$" + STALKReceiveName + ",87",
-		     Lsentence_Rudder = "$" + STALKReceiveName + ",91";
+}
+
+void raymarine_autopilot_pi::CheckConnections()
+{
+	if (!DirectConnection.IsEmpty())
+		CheckConnection(m_Connection, *m_Buses[0], DirectConnection);
+	for (size_t i = 1; i < m_Buses.size(); i++)
+		if (!m_Buses[i]->ConnectionSpec.IsEmpty())
+			CheckConnection(m_Buses[i]->Connection, *m_Buses[i], m_Buses[i]->ConnectionSpec);
+}
 
-	if (sentence.Left(9) == Lsentence_Response)
+void raymarine_autopilot_pi::CheckConnection(SeatalkConnection &Connection, AutopilotBus &Bus, const wxString &Spec)
+{
+	int64_t Now = Bus.Core.NowMs();
+	if (Connection.IsOpen())
 	{
-		if (WriteDebug) wxLogInfo(("Response %s"), sentence);
-		// Response Ermittlung.
-		m_pDialog->SetCopmpassTextColor(wxColour(0, 0, 64));
-		m_pDialog->SetTextStatusColor(wxColour(0, 0, 128));
-		m_pDialog->SetStatusText("Response");
-		m_pDialog->SetCompassText(sentence.Mid(13, 2));
-		ResponseLevel = atoi(sentence.Mid(13, 2));
-		m_pDialog->ParameterChoise->SetSelection(1);
-		m_pDialog->ParameterValue->SetSelection(ResponseLevel);
-		if (WriteMessages) wxLogMessage(("Get Responce"));
+		if (!Connection.Lost)
+			return;
+		// Closed, the sentences go through OpenCPN again until it is back
+		wxLogMessage(("Raymarine Autopilot: Direct connection %s lost, using OpenCPN"), Spec);
+		Connection.Close();
+		Bus.ReconnectMs = AUTOPILOT_RECONNECT_MS;
+		Bus.ReconnectAt = Now + Bus.ReconnectMs;
 		return;
 	}
-	if (sentence.Left(9) == Lsentence_Rudder)
-	{
-		if (WriteDebug) wxLogInfo(("Rudder %s"), sentence);
-		// Rudder Ermittlung. 
-		m_pDialog->SetCopmpassTextColor(wxColour(0, 0, 64));
-		m_pDialog->SetTextStatusColor(wxColour(0, 0, 128));
-		m_pDialog->SetStatusText("Rudder");
-		m_pDialog->SetCompassText(sentence.Mid(13, 2));
-		RudderLevel = atoi(sentence.Mid(13, 2));
-		m_pDialog->ParameterChoise->SetSelection(3);
-		m_pDialog->ParameterValue->SetSelection(RudderLevel);
-		if (WriteMessages) wxLogMessage((" Get Rudder Gain"));
+	if (Bus.ReconnectAt == 0 || Now < Bus.ReconnectAt)
 		return;
-	}
-	if (sentence.Left(9) == Lsentence_Command)
+	if (Connection.Open(std::string(Spec.mb_str()), Bus.Core.STALKReceiveName))
 	{
-		if (WriteDebug) wxLogInfo(("Keystroke %s"), sentence);
-		// Commandos von anderem St6002 erkennen
-		if (sentence.Mid(11, 7) == "1,02,FD" ||   // Standby pressed
-			sentence.Mid(11, 7) == "1,42,BD")    // Standby pressed longer ab Version 0.4
-		{
-			Standbycommandreceived = TRUE;
-			if (WriteMessages) wxLogMessage(("Received Standby Pressed from ST6001 %s"), sentence);
-			NeedCompassCorrection = false;
-		}
-		else
-		{
-			if (WriteMessages) wxLogMessage(("Received Button Pressed from ST6001 %s"), sentence);
-			NeedCompassCorrection = false;
-		}
+		wxLogMessage(("Raymarine Autopilot: Direct connection %s is back"), Spec);
+		Bus.ReconnectAt = 0;
+		Bus.ReconnectMs = AUTOPILOT_RECONNECT_MS;
 		return;
 	}
-	if (sentence.Left(9) != Lsentence) // Comes in 1 Second delay
-		return;    
-	if (NULL != p_Resettimer)
+	Bus.ReconnectMs = Bus.ReconnectMs * 2 > AUTOPILOT_RECONNECT_MAX_MS ? AUTOPILOT_RECONNECT_MAX_MS : Bus.ReconnectMs * 2;
+	Bus.ReconnectAt = Now + Bus.ReconnectMs;
+}
+
+void raymarine_autopilot_pi::ReceiveFromBus(size_t Index)
+{
+	if (Index >= m_Buses.size())
+		return;
+	std::string sentence;
+	while (m_Buses[Index]->Connection.Receive(sentence))
 	{
-		p_Resettimer->Stop();
-		p_Resettimer->Start(12000);
+		if (m_Capture.IsOpen())
+			m_Capture.Append(CAPTURE_INBOUND, sentence.c_str(), sentence.length());
+		if (m_pDialog != NULL)
+			m_Buses[Index]->Core.SetNMEASentence(sentence);
 	}
-	if (DisplayShow > 0)
+	StartAnimation();
+}
+
+void raymarine_autopilot_pi::StartControl()
+{
+	m_Control.SetNotify([this]() { m_ConnectionEvents.CallAfter([this]() { ReceiveFromControl(); }); });
+	if (m_Control.Open(std::string(ControlSocket.mb_str())))
 	{
-		DisplayShow--;
-		//return;
-	}
-	if (CounterStandbySentencesReceived == 0) // falls noch kein Kommando gekommen ist, bleibt der alte Status.
-		Autopilot_Status_Before = Autopilot_Status;
-	m_pDialog->SetCopmpassTextColor(wxColour(0, 0, 64));
-	m_pDialog->SetTextStatusColor(wxColour(0, 0, 128));
-	Autopilot_Status = GetAutopilotMode(sentence);
-	switch (Autopilot_Status)
-	{
-		case	AUTO:
-			if (WriteDebug) wxLogInfo(("Received Auto %s"), sentence);
-			if (Autopilot_Status_Before != Autopilot_Status)
-			{
-				// Nur fr Logging
-				if (WriteMessages) wxLogMessage("Auto-Status changed to AUTO");
-			}
-			if (StandbySelfPressed == TRUE)
-			{
-				if (WriteMessages) wxLogMessage(("Standby self Pressed detected in Auto Mode %s"), sentence);
-				NeedCompassCorrection = false;
-				// Soll nach Standby gehen ist aber noch in Auto mode.
-				DisplayShow = 2; // 2 Sequenzen abwarten
-				if (IS_standby < 2)
-				{
-					IS_standby++;
-					break;
-				}
-			} else
-			if (Standbycommandreceived == TRUE && Autopilot_Status_Before != UNKNOWN)
-			{
-				// Warten ob Der Autopilot noch in Standbymode geht, falls Dieses "Auto" Signal kurz hinter dem
-				// Drcken der Standbytaste noch kam, und dadurch den "Standbycommandreceived Status wieder nach
-				// FALSE setzt.
-				// Zwei Sequenzen abwarten.
-				if (WriteMessages) wxLogMessage(("Standby from St6001 detected in Auto Mode %s"), sentence);
-				NeedCompassCorrection = false;
-				if (IS_standby < 2)
-				{
-					IS_standby++;
-					break;
-				}
-			}
-			if (NeedCompassCorrection == true)
-			{
-				// Es wurde Automodus durch fehler aktivert, und es muss der Curse auf den alen gesetzt werden.
-				// Sende so lange Signale, bis der alte Compasskurs wider eingestellt ist.
-				if (LastCompassCourse < 0 || LastCompassCourse > 360)
-				{
-					// Noch nicht gesetzt
-					if (WriteMessages) wxLogMessage("No Last Compass Course");
-					NeedCompassCorrection = false;
-					break;
-				}
-				if (atoi(GetAutopilotCompassCourse(sentence)) == LastCompassCourse)
-				{
-					// Der alte Kurs ist eingestellt.
-					if (WriteMessages) wxLogMessage("Correct Compass ready");
-					NeedCompassCorrection = false;
-				}
-				else
-				{
-					// Korrectur durchfhren
-					// -------------------------------
-					tmp = atoi(GetAutopilotCompassCourse(sentence));
-					if (tmp < 0 || tmp > 360)
-					{
-						//Fehler
-						if (WriteMessages) wxLogMessage("Compass Error");
-						NeedCompassCorrection = false;
-						break;
-					}
-					if (180 > abs(tmp - LastCompassCourse) &&  30 < abs(tmp - LastCompassCourse))
-					{
-						// Nicht mehr als 30 Grad nderung !!
-						if (WriteMessages) wxLogMessage("No Correction more than 30 degree");
-						NeedCompassCorrection = false;
-						break;
-					}
-					if (WriteMessages) wxLogMessage(("Correct Compass course from %i to %i"),tmp, LastCompassCourse);
-					if (180 < abs(tmp - LastCompassCourse))
-					{
-						// ber Nodern ndern
-						if (tmp > LastCompassCourse)
-						{
-							// Compasskurs muss ber Norden mit PLus verndert werden. (bis 0 Grad.)
-							if ((tmp - LastCompassCourse) >= 10)
-							{
-								// Mehr als 10 Grad differenz !! also +10 Grad ndern.
-								if (WriteMessages) wxLogMessage("Over North + 10");
-								Lsentence = "$" + STALKSendName + ",86,21,08,F7";
-								SendNMEASentence(Lsentence);
-							}
-							else
-							{
-								// Weniger als 10 Grad ndern.
-								if (WriteMessages) wxLogMessage("Over North + 1");
-								Lsentence = "$" + STALKSendName + ",86,21,07,F8";
-								SendNMEASentence(Lsentence);
-							}
-						}
-						else
-						{
-							// Compasskurs von z.B. 5 nach 340 ... ndern mit Minus
-							if ((LastCompassCourse - tmp) >= 10)
-							{
-								// Mehr als 10 Grad differenz !! also +10 Grad ndern.
-								if (WriteMessages) wxLogMessage("Over North - 10");
-								Lsentence = "$" + STALKSendName + ",86,21,06,F9";
-								SendNMEASentence(Lsentence);
-							}
-							else
-							{
-								// Weniger als 10 Grad ndern.
-								if (WriteMessages) wxLogMessage("Over North - 1");
-								Lsentence = "$" + STALKSendName + ",86,21,05,FA";
-								SendNMEASentence(Lsentence);
-							}
-						}
-					}
-					else
-					{
-						// Normale nderung nicht ber Norden.
-						if (tmp > LastCompassCourse)
-						{
-							// Der Neue Compasskurs ist grsser als der alte also Verkleineren.
-							if ((tmp - LastCompassCourse) >= 10)
-							{
-								// Mehr als 10 Grad differenz !! also +10 Grad ndern.
-								if (WriteMessages) wxLogMessage("Korrectur - 10");
-								Lsentence = "$" + STALKSendName + ",86,21,06,F9";
-								SendNMEASentence(Lsentence);
-							}
-							else
-							{
-								// Weniger als 10 Grad ndern.
-								if (WriteMessages) wxLogMessage("Korrectur - 1");
-								Lsentence = "$" + STALKSendName + ",86,21,05,FA";
-								SendNMEASentence(Lsentence);
-							}
-						}
-						else
-						{
-							// Der neue Compass kurs ist kleiner als der alte. also Vergrssern.
-							if ((LastCompassCourse - tmp) >= 10)
-							{
-								// Mehr als 10 Grad differenz !! also +10 Grad ndern.
-								if (WriteMessages) wxLogMessage("Korrectur + 10");
-								Lsentence = "$" + STALKSendName + ",86,21,08,F7";
-								SendNMEASentence(Lsentence);
-							}
-							else
-							{
-								// Weniger als 10 Grad ndern.
-								if (WriteMessages) wxLogMessage("Korrectur + 1");
-								Lsentence = "$" + STALKSendName + ",86,21,07,F8";
-								SendNMEASentence(Lsentence);
-							}
-						}
-					}
-				}
-				if (m_pDialog != NULL && DisplayShow == 0)
-				{
-					m_pDialog->SetStatusText("Auto Correct");
-					m_pDialog->SetCompassText(GetAutopilotCompassCourse(sentence) + " ( " + GetAutopilotCompassDifferenz(sentence) + " )");
-				}
-			}
-			else
-			{
-				LastCompassCourse = atoi(GetAutopilotCompassCourse(sentence));
-				if (m_pDialog != NULL && DisplayShow == 0)
-				{
-					if (ConfirmNextWaypoint(sentence) == false) // Check if Print "NextWaypoint + Bearing"
-					{
-						m_pDialog->SetStatusText("Auto");
-						m_pDialog->SetCompassText(GetAutopilotCompassCourse(sentence) + " ( " + GetAutopilotCompassDifferenz(sentence) + " )");
-					}
-				}
-			}
-			if (IS_standby != 0)
-				if (WriteMessages) wxLogMessage(("No Standby Message comming don't know why. Say in Auto Mode. Sentence %s"), sentence);
-			IS_standby = 0;
-			Standbycommandreceived = FALSE;
-			StandbySelfPressed = FALSE;
-			CounterStandbySentencesReceived = 0;
-			break;
-		case AUTOTRACK :
-			if (WriteDebug) wxLogInfo(("Received Auto-Track %s"), sentence);
-			if (Autopilot_Status_Before != Autopilot_Status)
-			{
-				// Nur fr Logging
-				if (WriteMessages) wxLogMessage("Auto-Status changed to AUTO-TRACK");
-			}
-			if (StandbySelfPressed == TRUE)
-			{
-				if (WriteMessages) wxLogMessage(("Standby self Pressed detected in Auto-Track Mode %s"), sentence);
-				// Soll nach Standby gehen ist aber noch in Auto mode.
-				DisplayShow = 2; // 2 Sequenzen abwarten
-				if (IS_standby < 2)
-				{
-					IS_standby++;
-					break;
-				}
-			} else
-			if (Standbycommandreceived == TRUE && Autopilot_Status_Before != UNKNOWN)
-			{
-				// Warten ob Der Autopilot noch in Standbymode geht, falls Dieses "Auto" Signal kurz hinter dem
-				// Drcken der Standbytaste noch kam, und dadurch den "Standbycommandreceived Status wieder nach
-				// FALSE setzt.
-				// Zwei Sequenzen abwarten.
-				if (WriteMessages) wxLogMessage(("Standby from St6001 detected in Auto-Track Mode %s"), sentence);
-				if (IS_standby < 2)
-				{
-					IS_standby++;
-					break;
-				}
-			}
-			if (IS_standby != 0)
-				if (WriteMessages) wxLogMessage(("No Standby Message comming don't know why. Say in Auto-Track Mode. Sentence %s"), sentence);
-			IS_standby = 0;
-			Standbycommandreceived = FALSE;
-			StandbySelfPressed = FALSE;
-			CounterStandbySentencesReceived = 0;
-			if (m_pDialog != NULL && DisplayShow == 0)
-			{
-				if (ConfirmNextWaypoint(sentence) == false) // Check if Print "NextWaypoint + Bearing"
-				{
-					m_pDialog->SetStatusText("Auto-Track");
-					m_pDialog->SetCompassText(GetAutopilotCompassCourse(sentence) + " ( " + GetAutopilotCompassDifferenz(sentence) + " )");
-				}
-			}
-			break;
-		case	AUTOWIND:
-			if (WriteDebug) wxLogInfo(("Received Auto-Wind %s"), sentence);
-			if (Autopilot_Status_Before != Autopilot_Status)
-			{
-				// Nur fr Logging
-				if (WriteMessages) wxLogMessage("Auto-Status changed to AUTO-WIND");
-			}
-			if (StandbySelfPressed == TRUE)
-			{
-				if (WriteMessages) wxLogMessage(("Standby self Pressed detected in Auto-Wind Mode %s"), sentence);
-				// Soll nach Standby gehen ist aber noch in Auto mode.
-				DisplayShow = 2; // 2 Sequenzen abwarten
-				if (IS_standby < 2)
-				{
-					IS_standby++;
-					break;
-				}
-			} else
-			if (Standbycommandreceived == TRUE && Autopilot_Status_Before != UNKNOWN)
-			{
-				// Warten ob Der Autopilot noch in Standbymode geht, falls Dieses "Auto" Signal kurz hinter dem
-				// Drcken der Standbytaste noch kam, und dadurch den "Standbycommandreceived Status wieder nach
-				// FALSE setzt.
-				// Zwei Sequenzen abwarten.
-				if (WriteMessages) wxLogMessage(("Standby from St6001 detected in Auto-Wind Mode %s"), sentence);
-				if (IS_standby < 2)
-				{
-					IS_standby++;
-					break;
-				}
-			}
-			if (IS_standby != 0)
-				if (WriteMessages) wxLogMessage(("No Standby Message comming don't know why. Say in Auto-Wind Mode. Sentence %s"), sentence);
-			IS_standby = 0;
-			Standbycommandreceived = FALSE;
-			StandbySelfPressed = FALSE;
-			CounterStandbySentencesReceived = 0;
-			if (m_pDialog != NULL && DisplayShow == 0)
-			{
-				m_pDialog->SetStatusText("Auto-Wind");
-				m_pDialog->SetCompassText(GetAutopilotCompassCourse(sentence) + " ( " + GetAutopilotCompassDifferenz(sentence) + " )");
-			}
-			break;
-		case	WINDSHIFT:
-			if (WriteDebug) wxLogInfo(("Received Windshift %s"), sentence);
-			if (Autopilot_Status_Before != Autopilot_Status)
-			{
-				// Nur fr Logging
-				if (WriteMessages) wxLogMessage("Auto-Status .... Windshift received");
-			}
-			if (StandbySelfPressed == TRUE)
-			{
-				// Soll nach Standby gehen ist aber noch in Auto mode.
-				DisplayShow = 2; // 2 Sequenzen abwarten
-				if (IS_standby < 2)
-				{
-					IS_standby++;
-					break;
-				}
-			}
-			StandbySelfPressed = FALSE;
-			if (NewAutoWindCommand)
-			{
-				// Send New Sentence Auto-Wind
-				if (WriteMessages) wxLogMessage("Send New Auto-Wind Command");
-				Lsentence = "$" + STALKSendName + ",86,21,23,DC";
-				SendNMEASentence(Lsentence);
-			}
-			if (m_pDialog != NULL && DisplayShow == 0)
-			{
-				m_pDialog->SetStatusText("Wind-Shift");
-				m_pDialog->SetCompassText(GetAutopilotCompassCourse(sentence) + " ( " + GetAutopilotCompassDifferenz(sentence) + " )");
-				DisplayShow = 10;
-			}
-			break;
-		case	OFFCOURSE:
-			if (WriteDebug) wxLogInfo(("Received Off-Course %s"), sentence);
-			if (Autopilot_Status_Before != Autopilot_Status)
-			{
-				// Nur fr Logging
-				if (WriteMessages) wxLogMessage("Auto-Status .... Off-Course received");
-			}
-			if (StandbySelfPressed == TRUE)
-			{
-				// Soll nach Standby gehen ist aber noch in Auto mode.
-				DisplayShow = 2; // 2 Sequenzen abwarten
-				if (IS_standby < 2)
-				{
-					IS_standby++;
-					break;
-				}
-			}
-			StandbySelfPressed = FALSE;
-			if (m_pDialog != NULL && DisplayShow == 0)
-			{
-				m_pDialog->SetStatusText("Off-Course");
-				m_pDialog->SetCompassText(GetAutopilotCompassCourse(sentence) + " ( " + GetAutopilotCompassDifferenz(sentence) + " )");
-				DisplayShow = 10;
-			}
-			break;
-		case	STANDBY :
-			if (WriteDebug) wxLogInfo(("Received Standby %s"), sentence);
-			if (Autopilot_Status_Before != Autopilot_Status)
-			{
-				// Nur fr Logging
-				if (WriteMessages) wxLogMessage("Auto-Status changed to STANDBY");
-			}
-			if (Autopilot_Status_Before != STANDBY &&
-				NewStandbyNoStandbyReceived == TRUE &&  // Sool berhaupt ein Neues Standby gesendent werden ?
-				Standbycommandreceived == FALSE &&
-				NoStandbyCounter <= SelectCounterStandby &&  // Es soll StandbyCommando ausgewertet werden. Maximale Anzahl.
-				ConfirmNextWaypoint(sentence) == false) // Kein Fehler aufgetreten, sonst geht der Autopilot selber in Standby
-				
-			{
-				if (WriteMessages) wxLogMessage(("Standby received without StandbyCommand before %s"), sentence);
-				if (CounterStandbySentencesReceived < 3) // 4 Senteces warten, ob doch noch ein Commando kommt.
-				{
-					if (m_pDialog != NULL)
-					{
-						m_pDialog->SetStatusText("No Standby");
-						m_pDialog->SetCompassText("Error");
-					}
-					CounterStandbySentencesReceived++;
-					break;
-				}
-				else
-				{
-					// Kein Kommando gekommen sende nun Neues Auto Commando.
-					IS_standby = 0;
-					if (WriteMessages) wxLogMessage(("StandbyCommandreceived = False %s"), sentence);
-					CounterStandbySentencesReceived = 0;
-					Autopilot_Status = Autopilot_Status_Before; // Dadurch werden mehrere Seqnenzen gesendet, wenn ntig.
-					if (Autopilot_Status_Before == AUTO)
-					{
-						if (WriteMessages) wxLogMessage("---------------Send New Auto------------");
-						Lsentence = "$" + STALKSendName + ",86,21,01,FE";
-						if (ChangeValueToLast == true)
-						{
-							// Kurskorrectur durchfhren
-							if (WriteMessages) wxLogMessage("Course correction is enabled");
-							NeedCompassCorrection = true;
-						}
-						else
-						{
-							if (WriteMessages) wxLogMessage("Course correction is disabled using aktuell Compass-course");
-						}
-					}
-					if (Autopilot_Status_Before == AUTOWIND)
-					{
-						if (WriteMessages) wxLogMessage("-------------Send New Auto-Wind---------");
-						Lsentence = "$" + STALKSendName + ",86,21,23,DC";
-					}
-					if (Autopilot_Status_Before == AUTOTRACK)
-					{
-						if (WriteMessages) wxLogMessage("-------------Send New Auto-Track--------");
-						Lsentence = "$" + STALKSendName + ",86,21,03,FC";
-					}
-					SendNMEASentence(Lsentence);
-					// FehlerCounter hohchzhlen.
-					NoStandbyCounter++;
-					if (NoStandbyCounter > SelectCounterStandby)
-					{
-						if (WriteMessages) wxLogMessage("-------Last Time Sending new One--------");
-					}
-					if (m_pDialog != NULL)
-					{
-						// Rot
-						m_pDialog->SetBgTextStatusColor(wxColour(255, 128, 128));
-						m_pDialog->SetBgTextCompassColor(wxColour(255, 128, 128));
-					}
-				}
-				break;
-			}
-			else
-			{
-				if(CounterStandbySentencesReceived != 0)
-					if (WriteMessages) wxLogMessage("Standby Push Signal received now.");
-				CounterStandbySentencesReceived = 0;
-				NeedCompassCorrection = false;
-			}
-			if (Autopilot_Status_Before == AUTO || Autopilot_Status_Before == AUTOWIND) // Zustandnderung von Auto -> Standby
-			{
-				CounterStandbySentencesReceived = 0;
-				if (StandbySelfPressed == FALSE &&
-					NewAutoOnStandby == TRUE)  // Generell neues Auto Senden, wenn nicht von hier gesendet.
-					                           // Ignoriert St6001 Standby Signal !! Vorsiht.
-				{
-					// Standby not from here !! goto AUTO
-					//
-					if (WriteMessages) wxLogMessage(("Selfpressed = False, Auto-Status-before = Auto or Autowind %s"), sentence);
-					if (WriteMessages) wxLogMessage("---------------Send New Auto------------");
-					IS_standby = 0;
-					Standbycommandreceived = FALSE;
-					CounterStandbySentencesReceived = 0;
-					Lsentence = "$" + STALKSendName + ",86,21,01,FE";
-					SendNMEASentence(Lsentence);
-					if (ChangeValueToLast == true)
-					{
-						// Kurskorrectur durchfhren
-						if (WriteMessages) wxLogMessage("Course correction(2) is enabled");
-						NeedCompassCorrection = true;
-					}
-					else
-					{
-						if (WriteMessages) wxLogMessage("Course correction(2) is disabled using aktuell Compass-course");
-					}
-				}
-				StandbySelfPressed = FALSE;
-			}
-			if(Autopilot_Status_Before == STANDBY)
-			{
-				// War schon Standby nun Zur Sicherheit
-				StandbySelfPressed = FALSE;
-				Standbycommandreceived = FALSE;
-				IS_standby = 0;
-			}
-			if (m_pDialog != NULL && DisplayShow == 0)
-			{
-				if (ConfirmNextWaypoint(sentence) == false) // Check if Print "NextWaypoint + Bearing"
-				{
-					m_pDialog->SetStatusText("Standby");
-					m_pDialog->SetCompassText(GetAutopilotMAGCourse(sentence));
-				}
-			}
-			break;
-		case	UNKNOWN:
-			if (WriteDebug) wxLogInfo(("Received Unknown %s"), sentence);
-			if (m_pDialog != NULL && DisplayShow == 0)
-			{
-				m_pDialog->SetStatusText("----------");
-				m_pDialog->SetCompassText("---");
-			}
-			IS_standby = 0;
-			Standbycommandreceived = TRUE; // So when the Instruments are switched on again no Error !
-			CounterStandbySentencesReceived = 0;
-			NeedCompassCorrection = false;
-			break;
+		wxLogMessage(("Raymarine Autopilot: Control socket %s"), ControlSocket);
+		PublishState();		// "state" has a snapshot from the start
 	}
+	else
+		wxLogMessage(("Raymarine Autopilot: Could not open control socket %s: %s"), ControlSocket, wxString::FromUTF8(m_Control.Error().c_str()));
 }
 
-bool raymarine_autopilot_pi::ConfirmNextWaypoint(const wxString &sentence)
+// The commands of the remote clients go to the selected bus, like the buttons
+void raymarine_autopilot_pi::ReceiveFromControl()
 {
-	if (sentence.Mid(28, 2) == "02")
+	int Client;
+	RemoteCommand Command;
+	while (m_Control.Receive(Client, Command))
 	{
-		// Autopilot is in normal Mode
-		GoneTimeToSendNewWaypoint = 0;
-		return false;
+		std::string Error;
+		bool Ok = ExecuteRemote(Client, Command, Error);
+		if (Command.Id.empty())
+			continue;	// a notification is not answered
+		m_Control.Reply(Client, Ok ? Command.Reply() : Command.Reply(REMOTE_REFUSED, Error));
 	}
+	PublishState();		// the predicted state at once, not with the next localTimer
+}
 
-	char c,b;
+bool raymarine_autopilot_pi::ExecuteRemote(int Client, const RemoteCommand &Command, std::string &Error)
+{
+	if (m_SelectedBus < 0)
+		Error = "all buses shown, none selected";
+	else if (!m_Control.Arbitrate(Client, Command, m_pCore->NowMs()))
+		Error = "another client has control";
+	else
+		m_pCore->Execute(Command, Error);
+	return Error.empty();
+}
 
-	if (-1 == (c = GetHexValue((char)(sentence.Mid(28, 1)).GetChar(0))))
+void raymarine_autopilot_pi::PublishState()
+{
+	if (!m_Control.IsOpen() && !m_StateMessages)
+		return;
+	std::string State = m_pCore->StateJSON();
+	m_Control.Publish(State);
+	if (m_StateMessages && State != m_LastState)
 	{
-		return false;
+		m_LastState = State;
+		SendPluginMessage(_T("RAYMARINE_AP_STATE"), wxString::FromUTF8(("{\"state\":" + State + "}").c_str()));
 	}
-	if (-1 == (b = GetHexValue((char)(sentence.Mid(20, 1)).GetChar(0))))
+}
+
+void raymarine_autopilot_pi::CreateBuses()
+{
+	DeleteBuses();
+	m_Buses.push_back(new AutopilotBus(this, 0));
+	m_pCore = &m_Buses[0]->Core;
+	m_SelectedBus = 0;
+}
+
+void raymarine_autopilot_pi::DeleteBuses()
+{
+	for (size_t i = 0; i < m_Buses.size(); i++)
+		delete m_Buses[i];
+	m_Buses.clear();
+	m_Router.Clear();
+	m_pCore = NULL;
+}
+
+// The settings of the selected bus for all, the sentence names stay
+void raymarine_autopilot_pi::ShareSettings()
+{
+	m_Router.Clear();
+	for (size_t i = 0; i < m_Buses.size(); i++)
 	{
-		return false;
+		if (&m_Buses[i]->Core != m_pCore)
+			m_Buses[i]->Core.CopySettings(*m_pCore);
+		m_Router.Add(m_Buses[i]->Core.STALKReceiveName, (int)i);
 	}
+}
 
-	if ((c & 0x08) == 0x08 && (b & 0x02) == 0x02)  // Ist im AutoMode. und soll nach track
-	{ 
-		if (m_pDialog != NULL)
-		{
-			m_pDialog->SetStatusText("Next WayP.");
-			m_pDialog->SetCompassText(WayPointBearing);
-		}
-		if (SendTrack)
-		{
-			// Send Track automatisch. after TimeToSendNewWaypiont
-			if (TimeToSendNewWaypiont == GoneTimeToSendNewWaypoint)
-			{
-				wxString sentence = "$" + STALKSendName + ",86,21,03,FC";
-				SendNMEASentence(sentence);
-				if (WriteMessages) wxLogMessage(("Send Track automatic %s"), sentence);
-			}
-			GoneTimeToSendNewWaypoint++;  // Not set to 0 here, because don't send too sentences after the other
-		}		
-		return true;
-	}
-	if ((c & 0x01) == 0x01)
-	{   
-		if (m_pDialog != NULL)
-		{
-			m_pDialog->SetStatusText("WayPoint");
-			WayPointBearing = "large XTE";
-			m_pDialog->SetCompassText(WayPointBearing);
-		}
-		return true;
-	}
-	if (-1 == (c = GetHexValue((char)(sentence.Mid(29, 1)).GetChar(0))))
+void raymarine_autopilot_pi::SelectBus(int Index)
+{
+	if (Index >= (int)m_Buses.size())
+		return;
+	StopAnimation();
+	m_SelectedBus = Index;
+	m_pCore = &m_Buses[Index < 0 ? 0 : Index]->Core;
+	if (m_pDialog != NULL)
+		m_pDialog->EnableCommands(Index >= 0);
+	if (Index < 0)
 	{
-		return false;
+		ShowAllBuses();
+		return;
 	}
-	if ((c & 0x08) == 0x08)
+	// The last texts at once, everything again with the next 0x84
+	ShowStatus(m_Buses[Index]->Status);
+	ShowCompass(m_Buses[Index]->Compass);
+	m_pCore->Redisplay();
+}
+
+// "Auto | Standby" and "123 | 245", in the order of the buses
+void raymarine_autopilot_pi::ShowAllBuses()
+{
+	std::string Status, Compass;
+	for (size_t i = 0; i < m_Buses.size(); i++)
 	{
-		if (m_pDialog != NULL)
+		if (i > 0)
 		{
-			m_pDialog->SetStatusText("WayPoint");
-			WayPointBearing = "No Data";
-			m_pDialog->SetCompassText(WayPointBearing);
-			StandbySelfPressed = TRUE; // Autopilot geht von selbst auf AUTO
+			Status += " | ";
+			Compass += " | ";
 		}
-		return true;
+		Status += m_Buses[i]->Status;
+		Compass += m_Buses[i]->Compass;
 	}
-	GoneTimeToSendNewWaypoint = 0;
-	return false; // Autopilot is in normal Mode
+	ShowStatus(Status);
+	ShowCompass(Compass);
 }
 
-void raymarine_autopilot_pi::GetWaypointBearing(const wxString &sentence)
+void raymarine_autopilot_pi::StartAnimation()
 {
-	// Get from RMB Message
-	wxString s = sentence;
-	int sLenght = s.Length();
-	int i = 0;
+	if (m_pDialog == NULL || !m_pDialog->IsShown() || !m_pCore->IsTurning())
+		return;
+	if (NULL == p_Animationtimer)
+		p_Animationtimer = new animationTimer(this);
+	if (!p_Animationtimer->IsRunning())
+		p_Animationtimer->Start(AUTOPILOT_ANIMATION_MS);
+}
 
-	while (i < 11)
+void raymarine_autopilot_pi::StopAnimation()
+{
+	if (NULL != p_Animationtimer)
 	{
-		sLenght = sLenght - s.find(wxT(",")) - 1;
-		if (sLenght <= 0)
-		{
-			WayPointBearing = "error";
-			return;
-		}
-		s = s.Right(sLenght);
-		i++;
-		if (i == 11)
-		{
-			WayPointBearing = s.Left(s.find(wxT(",")));
-			if (WayPointBearing.find(wxT(".")) != -1)
-				WayPointBearing = WayPointBearing.Left(WayPointBearing.find(wxT(".")));
-			WayPointBearing += " ";
-			return;
-		}
+		p_Animationtimer->Stop();
+		delete p_Animationtimer;
+		p_Animationtimer = NULL;
 	}
-	WayPointBearing = "unknown";
-	return;
 }
 
-int raymarine_autopilot_pi::GetAutopilotMode(wxString &sentence)
+void raymarine_autopilot_pi::OnautopilotDialogClose()
+{
+    //m_bShowautopilot = false;
+    SetToolbarItemState( m_leftclick_tool_id, m_bShowautopilot );
+    m_pDialog->Hide();
+	SaveConfig();
+    RequestRefresh(m_parent_window); // refresh main window
+}
+
+//Demo implementation of response mechanism
+
+void raymarine_autopilot_pi::SetPluginMessage(wxString &message_id, wxString &message_body)
 {
-	wxString s = sentence, HexValue;
+	std::unordered_map<std::string, PluginMessageHandler>::const_iterator Handler =
+		m_MessageHandlers.find(std::string(message_id.mb_str()));
+	if (Handler != m_MessageHandlers.end())
+		(this->*Handler->second)(message_body);
+}
 
-	//s.Trim();
-	char c;
-	int sLenght = s.Length();
-	int i = 0, ReturnStatus = UNKNOWN;
-	
-	while (i < 7)
+// Answer with the steering statistics, see SteeringStatistics::ToJSON()
+void raymarine_autopilot_pi::OnStatisticsRequest(const wxString &Body)
+{
+	SendPluginMessage(_T("RAYMARINE_AP_STATISTICS"), wxString::FromUTF8(m_pCore->Statistics.ToJSON().c_str()));
+}
+
+// {"id":1,"command":"heading","heading":245}, see RemoteCommand. The answer
+// is RAYMARINE_AP_RESULT {"id":1,"result":"ok","state":{...}} or with
+// "error":"reason" instead of the result, not mixed with the state pushes.
+void raymarine_autopilot_pi::OnCommandMessage(const wxString &Body)
+{
+	wxCharBuffer Text = Body.ToUTF8();
+	RemoteCommand Command;
+	std::string Error;
+	if (!Command.Parse(Text.data(), Text.length()))
+		Error = Command.Error;
+	else if (Command.Method == REMOTE_SUBSCRIBE || Command.Method == REMOTE_UNSUBSCRIBE)
 	{
-		sLenght = sLenght - s.find(wxT(",")  ) - 1;
-		if (sLenght <= 0)
-		{
-			return UNKNOWN;
-		}
-		s = s.Right(sLenght);
-		i++;
-		if (i == 5)
+		m_StateMessages = Command.Method == REMOTE_SUBSCRIBE;
+		m_LastState.clear();
+	}
+	else if (Command.Method != REMOTE_STATE)
+		ExecuteRemote(0, Command, Error);
+	std::string Reply = Command.MessageReply(Error, m_pCore->StateJSON());
+	SendPluginMessage(_T("RAYMARINE_AP_RESULT"), wxString::FromUTF8(Reply.c_str()));
+	PublishState();
+}
+
+// {"Decl":2.1,...} of the WMM plugin, only "Decl" is read
+void raymarine_autopilot_pi::OnVariationMessage(const wxString &Body)
+{
+	AutopilotCore *pRMC = &m_Buses[0]->Core;
+    if ((pRMC->WMM_receive_count < 30 && pRMC->BoatVariation != 0x01FF) || !pRMC->ModyfyRMC)  // Do not need so often.
+        return;
+	wxCharBuffer Text = Body.ToUTF8();
+	JsonScanner Json(Text.data(), Text.length());
+	std::string Name;
+	if (!Json.Expect('{'))
+		return;
+	do
+	{
+		if (!Json.String(&Name) || !Json.Expect(':'))
+			return;
+		double Decl;
+		if (Name == "Decl")
 		{
-			HexValue = s.Left(s.find(wxT(",")));
-			if (HexValue.Length() != 2)
-			{
-				ReturnStatus = UNKNOWN;
-				break;
-			}
-			if (-1 == (c = GetHexValue((char)HexValue.GetChar(1))))
+			if (Json.Number(Decl))
 			{
-				ReturnStatus = UNKNOWN;
-				break;
+				pRMC->BoatVariation = Decl;
+				pRMC->WMM_receive_count = 0;
 			}
-		/*	if ((c & 0x08) == 0x08)
-				ReturnStatus = AUTOTRACK;
-			if ((c & 0x06) == 0x06 && ReturnStatus == UNKNOWN)
-				ReturnStatus = AUTOWIND;
-			if ((c & 0x02) == 0x02 && ReturnStatus == UNKNOWN)
-				ReturnStatus = AUTO;
-			if ((c & 0x02) == 0x00 && ReturnStatus == UNKNOWN)
-				ReturnStatus = STANDBY;  alte Version !! Fehler bei Standby und Autowind !   */
-			if ((c & 0x02) == 0x00) // Wenn Bit 2 = 0 auf jeden Fall Standby.
-				ReturnStatus = STANDBY;
-			// Wenn Bit 2 gesetzt ist, ist auf jeden Fall ein Auto Mode.
-			if ((c & 0x04) == 0x04 && ReturnStatus == UNKNOWN)
-				ReturnStatus = AUTOWIND;
-			if ((c & 0x08) == 0x08 && ReturnStatus == UNKNOWN)
-				ReturnStatus = AUTOTRACK;
-			if ((c & 0x02) == 0x02 && ReturnStatus == UNKNOWN)
-				ReturnStatus = AUTO;
-		}
-		if (i == 6 && ReturnStatus == AUTOWIND)
-		{
-			HexValue = s.Left(s.find(wxT(",")));
-			if (HexValue.Length() != 2)
-				return UNKNOWN;
-			if (-1 == (c = GetHexValue((char)HexValue.GetChar(1))))
-				return UNKNOWN;
-			if ((c & 0x08) == 0x08)
-				return WINDSHIFT;
-		}
-		if (i == 6 && (ReturnStatus == AUTO || ReturnStatus == AUTOTRACK))
-		{
-			HexValue = s.Left(s.find(wxT(",")));
-			if (HexValue.Length() != 2)
-				return UNKNOWN;
-			if (-1 == (c = GetHexValue((char)HexValue.GetChar(1))))
-				return UNKNOWN;
-			if ((c & 0x04) == 0x04)
-				return OFFCOURSE;
+			return;
 		}
-	}
-	return ReturnStatus; 
+		if (!Json.Skip(NULL))
+			return;
+	} while (Json.Expect(','));
 }
 
-char raymarine_autopilot_pi::GetHexValue(char AsChar)
+void raymarine_autopilot_pi::SetNMEASentence(wxString &sentence_incomming)
 {
-	char HexT[] = "0123456789ABCDEF";
-	char a = toupper(AsChar), i = 0;
+	wxScopedCharBuffer Raw = sentence_incomming.ToUTF8();
 
-	while(i <= 15)
+	if (m_Capture.IsOpen())
+		m_Capture.Append(CAPTURE_INBOUND, Raw.data(), Raw.length());
+	if (m_pDialog == NULL)
+		return;
+	std::string sentence(Raw.data(), Raw.length());
+	int Bus = m_Router.Route(sentence);
+	if (Bus < 0)
 	{
-		if (HexT[i] == a)
-			return i;
-		i++;
+		// RMB, RMC, ... for every bus
+		for (size_t i = 0; i < m_Buses.size(); i++)
+			m_Buses[i]->Core.SetNMEASentence(sentence);
+		return;
 	}
-	return -1;
+	// With an own connection the Seatalk sentences from OpenCPN are mirrors or doubles.
+	if ((Bus == 0 ? m_Connection : m_Buses[Bus]->Connection).IsOpen())
+		return;
+	m_Buses[Bus]->Core.SetNMEASentence(sentence);
+	StartAnimation();
 }
 
+// For the track control of every bus
+void raymarine_autopilot_pi::SetPositionFixEx(PlugIn_Position_Fix_Ex &pfix)
+{
+	for (size_t i = 0; i < m_Buses.size(); i++)
+		m_Buses[i]->Core.SetPositionFix(pfix.Lat, pfix.Lon, pfix.Cog, pfix.Sog);
+}
 
-wxString raymarine_autopilot_pi::GetAutopilotCompassCourse(wxString &sentence)
+void raymarine_autopilot_pi::SendNMEASentence(wxString sentence)
 {
-	
-	wxString s = sentence, HexValue;
+	wxScopedCharBuffer Raw = sentence.ToUTF8();
+	m_pCore->SendNMEASentence(std::string(Raw.data(), Raw.length()));
+}
 
-	s.Trim();
-	unsigned char parameter[3] = { 0x00, 0x00, 0x00 };
-	int sLenght = s.Length();
-	int i = 0, CompassValue = -1;
+void raymarine_autopilot_pi::PushSentence(const std::string &sentence)
+{
+	PushSentence(m_Connection, m_Buses[0]->Core.STALKSendName, sentence);
+}
 
-	while (i < 5)
-	{
-		sLenght = sLenght - s.find(wxT(",")) - 1;
-		if (sLenght <= 0)
-		{
-			return ("---");
-		}
-		s = s.Right(sLenght);
-		HexValue = s.Left(s.find(wxT(",")));
-		i++;        
-		if (i == 3) // High Bit
-		{
-			if (HexValue.Length() != 2)
-				return ("Err - 1");
-			if (-1 == (parameter[0] = GetHexValue((char)HexValue.GetChar(0))))
-				return ("Err - 2");
-		}
-		if (i == 4)
-		{
-			if (HexValue.Length() != 2)
-				return ("Err - 3");
-			if (-1 == (parameter[1] = GetHexValue((char)HexValue.GetChar(0))))
-				return ("Err - 4");
-			if (-1 == (parameter[2] = GetHexValue((char)HexValue.GetChar(1))))
-				return ("Err - 5");
-			parameter[1] = (parameter[1] << 4) | parameter[2];
-		    if (360 <= (CompassValue = (int)((parameter[0] & 0x0c) >> 2) * 90 + parameter[1] / 2 + parameter[1] % 2)) // Very good checked with St6002
-            {
-                CompassValue = 0;
-            }
-			return(wxString::Format(wxT("%i"), CompassValue));
-		}
-	} 
-	return ("---"); // Nicht def
+void raymarine_autopilot_pi::PushSentence(SeatalkConnection &Connection, const std::string &SendName, const std::string &sentence)
+{
+	if (m_Capture.IsOpen())
+		m_Capture.Append(CAPTURE_OUTBOUND, sentence.c_str(), sentence.length());
+	// $<SendName>,... only, the bridge has nothing to do with the RMC
+	bool Seatalk = sentence.length() > SendName.length() + 1 && sentence[0] == '$' &&
+		sentence.compare(1, SendName.length(), SendName) == 0 && sentence[SendName.length() + 1] == ',';
+	if (Seatalk && Connection.IsOpen())
+		Connection.Send(sentence); // paced in the I/O thread
+	else
+		PushNMEABuffer(wxString::FromUTF8(sentence.c_str()));
 }
 
-wxString raymarine_autopilot_pi::GetAutopilotMAGCourse(wxString &sentence)
+void raymarine_autopilot_pi::ShowStatus(const std::string &Text)
 {
+	if (m_pDialog != NULL)
+		m_pDialog->SetStatusText(wxString::FromUTF8(Text.c_str()));
+}
 
-	wxString s = sentence, HexValue;
+void raymarine_autopilot_pi::ShowCompass(const std::string &Text)
+{
+	if (m_pDialog != NULL)
+		m_pDialog->SetCompassText(wxString::FromUTF8(Text.c_str()));
+}
 
-	s.Trim();
-	unsigned char parameter[3] = { 0x00, 0x00, 0x00 };
-	int sLenght = s.Length();
-	int i = 0, CompassValue = -1;
+void raymarine_autopilot_pi::ShowNormalColours()
+{
+	if (m_pDialog == NULL)
+		return;
+	m_pDialog->SetCopmpassTextColor(wxColour(0, 0, 64));
+	m_pDialog->SetTextStatusColor(wxColour(0, 0, 128));
+}
 
-	while (i < 4)
-	{
-		sLenght = sLenght - s.find(wxT(",")) - 1;
-		if (sLenght <= 0)
-		{
-			return ("---");
-		}
-		s = s.Right(sLenght);
-		HexValue = s.Left(s.find(wxT(",")));
-		i++;
-		if (i == 2) // High Bit
-		{
-			if (HexValue.Length() != 2)
-				return ("Err - 7");
-			if (-1 == (parameter[0] = GetHexValue((char)HexValue.GetChar(0))))
-				return ("Err - 8");
-		}
-		if (i == 3)
-		{
-			if (HexValue.Length() != 2)
-				return ("Err - 9");
-			if (-1 == (parameter[1] = GetHexValue((char)HexValue.GetChar(0))))
-				return ("Err - 10");
-			if (-1 == (parameter[2] = GetHexValue((char)HexValue.GetChar(1))))
-				return ("Err - 11");
-			parameter[1] = (parameter[1] << 4) | parameter[2];
-            if (360 <= (CompassValue = (int)(((parameter[0] & 0x03) * 90)
-                + ((parameter[1] & 0x3F) * 2)
-                + (((parameter[0] >> 2) & 0x03) / 2) 
-				+ ((parameter[0] >> 2) & 0x01))))
-            {
-                CompassValue = 0;
-            }
-			return(wxString::Format(wxT("%i"), CompassValue));
-		}
-	}
-	return ("---"); // Nicht def
+void raymarine_autopilot_pi::ShowAlarmColours()
+{
+	if (m_pDialog == NULL)
+		return;
+	m_pDialog->SetBgTextStatusColor(wxColour(255, 128, 128));
+	m_pDialog->SetBgTextCompassColor(wxColour(255, 128, 128));
 }
 
-wxString raymarine_autopilot_pi::GetAutopilotCompassDifferenz(wxString &sentence)
+void raymarine_autopilot_pi::ShowParameter(int Parameter, int Value)
 {
+	if (m_pDialog == NULL)
+		return;
+	m_pDialog->SetParameter(Parameter, Value);
+}
 
-	wxString s = sentence, HexValue;
+void raymarine_autopilot_pi::LogMessage(const std::string &Text)
+{
+	wxLogMessage(wxT("%s"), wxString::FromUTF8(Text.c_str()));
+}
 
-	s.Trim();
-	unsigned char parameter[3] = { 0x00, 0x00, 0x00 };
-	int sLenght = s.Length();
-	int i = 0, CompassValue = -1, AutoValue = -1, ReturnCompassValue;
+void raymarine_autopilot_pi::LogInfo(const std::string &Text)
+{
+	wxLogInfo(wxT("%s"), wxString::FromUTF8(Text.c_str()));
+}
 
-	while (i < 5)
-	{
-		sLenght = sLenght - s.find(wxT(",")) - 1;
-		if (sLenght <= 0)
-		{
-			return ("-");
-		}
-		s = s.Right(sLenght);
-		HexValue = s.Left(s.find(wxT(",")));
-		i++;
-		if (i == 3) // High Bit
-		{
-			if (HexValue.Length() != 2)
-				return ("a1");
-			if (-1 == (parameter[0] = GetHexValue((char)HexValue.GetChar(0))))
-				return ("a2");
-		}
-		if (i == 4)
-		{
-			if (HexValue.Length() != 2)
-				return ("a3");
-			if (-1 == (parameter[1] = GetHexValue((char)HexValue.GetChar(0))))
-				return ("a4");
-			if (-1 == (parameter[2] = GetHexValue((char)HexValue.GetChar(1))))
-				return ("a5");
-			parameter[1] = (parameter[1] << 4) | parameter[2];
-			if (360 <= (CompassValue = (int)((parameter[0] & 0x0c) >> 2) * 90 + parameter[1] / 2 + parameter[1] % 2))
-            {
-                CompassValue = 0;
-            }
-		}
-	}
-	s = sentence;
-	s.Trim();
-	sLenght = s.Length();
-	i = 0;
-	while (i < 4)
-	{
-		sLenght = sLenght - s.find(wxT(",")) - 1;
-		if (sLenght <= 0)
-		{
-			return ("-");
-		}
-		s = s.Right(sLenght);
-		HexValue = s.Left(s.find(wxT(",")));
-		i++;
-		if (i == 2) // High Bit
-		{
-			if (HexValue.Length() != 2)
-				return ("x7");
-			if (-1 == (parameter[0] = GetHexValue((char)HexValue.GetChar(0))))
-				return ("x8");
-		}
-		if (i == 3)
-		{
-			if (HexValue.Length() != 2)
-				return ("x9");
-			if (-1 == (parameter[1] = GetHexValue((char)HexValue.GetChar(0))))
-				return ("x10");
-			if (-1 == (parameter[2] = GetHexValue((char)HexValue.GetChar(1))))
-				return ("x11");
-			parameter[1] = (parameter[1] << 4) | parameter[2];
-			if (360 <= (AutoValue = (int)(((parameter[0] & 0x03) * 90)
-                + ((parameter[1] & 0x3F) * 2)
-                + (((parameter[0] >> 2) & 0x03) / 2) 
-				+ ((parameter[0] >> 2) & 0x01))))
-            {
-                AutoValue = 0;
-            }
-			ReturnCompassValue = AutoValue - CompassValue;
-			if (ReturnCompassValue >= 180)
-				ReturnCompassValue -= 360;
-			if (ReturnCompassValue < -180)
-				ReturnCompassValue += 360;
-			return(wxString::Format(wxT("%i"), ReturnCompassValue));
-		}
-	}
-	return ("-"); // Nicht def
+localTimer::localTimer(raymarine_autopilot_pi *pAuto)
+{
+	pAutopilot = pAuto;
 }
 
-void  raymarine_autopilot_pi::AddVariationToRMCanSendOut(wxString &sentence_incomming)
+void localTimer::Notify()
 {
-	if (sentence_incomming.GetChar(1) == 'E' && sentence_incomming.GetChar(2) == 'C')
-		return; // is My sentence
-	wxString Newsentence = sentence_incomming.Left(sentence_incomming.find(wxT("*"))); // delete Checksumme
+	// Timeouts of the cores, "No Data from Autopilot Computer" after 12 s.
+	// Runs for the whole life of the plugin, not only with the dialog.
+	for (size_t i = 0; i < pAutopilot->BusCount(); i++)
+		pAutopilot->Bus(i).Core.Poll();
+	pAutopilot->CheckConnections();
+	pAutopilot->PublishState();
+}
 
-	Newsentence.SetChar(1, 'E'); // Set to comes from Electronic Charts
-	Newsentence.SetChar(2, 'C');
-	if (BoatVariation == 0x01FF)
-	{
-		SendNMEASentence(Newsentence);  // Send out the Sentence without new Variation. not avalibal do that $ECRMC is send the origianl will be filterd
-		return;
-	}
+AutopilotBus::AutopilotBus(raymarine_autopilot_pi *pPlugin, int Index) : Core(this)
+{
+	m_pPlugin = pPlugin;
+	m_Index = Index;
+	ReconnectAt = 0;
+	ReconnectMs = AUTOPILOT_RECONNECT_MS;
+}
 
-	int sLenght = Newsentence.Length();
-	int i = 0;
-	int LastKomma = 0; // Stelle 0
-	while (i < 10)
-	{
-		if (sLenght < LastKomma)
-		{
-			if (WriteMessages) wxLogMessage("Wrong RMC Message detected");
-			return; // error not the right
-		}
-		LastKomma += Newsentence.Right(sLenght - LastKomma).find(wxT(",")) + 1;
-		if (LastKomma == 0)
-		{
-			if (WriteMessages) wxLogMessage("Wrong RMC Message detected");
-			return; // error not the right
-		}
-		i++;
-	}
-	int Dummy = LastKomma;
-	wxString Appand = "";
-	// See if there is somthing after the NOT SET VAriation 'A' ...
-	if (sLenght >= Dummy)
-		Dummy += Newsentence.Right(sLenght - Dummy).find(wxT(",")) + 1;
-	if (sLenght >= Dummy)
-		Dummy += Newsentence.Right(sLenght - Dummy).find(wxT(",")) + 1;
-	if (sLenght >= Dummy)
-		Appand = Newsentence.Right(sLenght - Dummy);
-	Newsentence = Newsentence.Left(LastKomma);
-	if (abs(BoatVariation) < 100)
-		Newsentence.Append("0");
-	if (abs(BoatVariation) < 10)
-		Newsentence.Append("0");
-	Newsentence.Append(wxString::Format(_T("%3.1f"), abs(BoatVariation)));
-	Newsentence.Append(wxT(","));
-	if (BoatVariation > 0)
-		Newsentence.Append(wxT("E"));
+void AutopilotBus::PushSentence(const std::string &sentence)
+{
+	if (m_Index == 0)
+		m_pPlugin->PushSentence(sentence);
 	else
-		Newsentence.Append(wxT("W"));
-	if (Appand.Length() != 0)
-	{	
-		Newsentence.Append(wxT(","));
-		Newsentence.Append(Appand);
-	}
-	SendNMEASentence(Newsentence);
+		m_pPlugin->PushSentence(Connection, Core.STALKSendName, sentence);
 }
 
-void raymarine_autopilot_pi::SendNMEASentence(wxString sentence)
+void AutopilotBus::ShowStatus(const std::string &Text)
 {
-	wxString Checksum = ComputeChecksum(sentence);
-	sentence = sentence.Append(wxT("*"));
-	sentence = sentence.Append(Checksum);
-	sentence = sentence.Append(wxT("\r\n"));
-	PushNMEABuffer(sentence);
+	Status = Text;
+	if (m_pPlugin->SelectedBus() == m_Index)
+		m_pPlugin->ShowStatus(Text);
+	else if (m_pPlugin->SelectedBus() < 0)
+		m_pPlugin->ShowAllBuses();
 }
 
-wxString raymarine_autopilot_pi::ComputeChecksum(wxString sentence)
+void AutopilotBus::ShowCompass(const std::string &Text)
 {
-	unsigned char calculated_checksum = 0;
-	for (wxString::const_iterator i = sentence.begin() + 1; i != sentence.end() && *i != '*'; ++i)
-		calculated_checksum ^= static_cast<unsigned char> (*i);
+	Compass = Text;
+	if (m_pPlugin->SelectedBus() == m_Index)
+		m_pPlugin->ShowCompass(Text);
+	else if (m_pPlugin->SelectedBus() < 0)
+		m_pPlugin->ShowAllBuses();
+}
 
-	return(wxString::Format("%02X", calculated_checksum));
+void AutopilotBus::ShowNormalColours()
+{
+	if (m_pPlugin->SelectedBus() == m_Index || m_pPlugin->SelectedBus() < 0)
+		m_pPlugin->ShowNormalColours();
 }
 
-localTimer::localTimer(raymarine_autopilot_pi *pAuto)
+void AutopilotBus::ShowAlarmColours()
+{
+	if (m_pPlugin->SelectedBus() == m_Index || m_pPlugin->SelectedBus() < 0)
+		m_pPlugin->ShowAlarmColours();
+}
+
+void AutopilotBus::ShowParameter(int Parameter, int Value)
+{
+	if (m_pPlugin->SelectedBus() == m_Index)
+		m_pPlugin->ShowParameter(Parameter, Value);
+}
+
+void AutopilotBus::LogMessage(const std::string &Text)
+{
+	m_pPlugin->LogMessage(m_Index == 0 ? Text : Core.STALKReceiveName + ": " + Text);
+}
+
+void AutopilotBus::LogInfo(const std::string &Text)
+{
+	m_pPlugin->LogInfo(m_Index == 0 ? Text : Core.STALKReceiveName + ": " + Text);
+}
+
+animationTimer::animationTimer(raymarine_autopilot_pi *pAuto)
 {
 	pAutopilot = pAuto;
 }
 
-void localTimer::Notify()
+void animationTimer::Notify()
 {
-	// Keine Informationen vom Kurscomputer
-	if (pAutopilot->WriteMessages) wxLogInfo("No Data from Autopilot Computer");
-	pAutopilot->Autopilot_Status = UNKNOWN;
-	if (NULL != pAutopilot->m_pDialog)
-	{
-		pAutopilot->m_pDialog->SetCopmpassTextColor(wxColour(0, 0, 64));
-		pAutopilot->m_pDialog->SetTextStatusColor(wxColour(0, 0, 128));
-		pAutopilot->m_pDialog->SetStatusText("----------");
-		pAutopilot->m_pDialog->SetCompassText("---");
-		pAutopilot->WayPointBearing = "unknown";
-		pAutopilot->GoneTimeToSendNewWaypoint = 0;
-		pAutopilot->IS_standby = 0;
-		pAutopilot->Standbycommandreceived = TRUE; // So when the Instruments are switched on again no Error !
-		pAutopilot->CounterStandbySentencesReceived = 0;
-	}
+	// Stopped when steady, started again by the next 0x84 with a turn
+	if (!pAutopilot->m_pCore->Animate())
+		Stop();
 }
@@ -0,0 +1,2087 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl.Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *   eMail : Bernd.Cirotzki@t-online.de                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "autopilotcore.h"
+#include "headingtext.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// What the compass text of the display is
+#define COMPASS_OTHER		0
+#define COMPASS_COURSE		1	// "Course ( Difference )"
+#define COMPASS_HEADING		2
+
+#define ANIMATION_MIN_RATE	0.5		// degrees/s, slower is steady
+#define ANIMATION_MAX_RATE	15.0	// degrees/s, faster is a jump of the compass, not a turn
+#define ANIMATION_MAX_AGE	1500	// ms after the last 0x84
+
+// wxString like helpers, same behaviour for out of range positions.
+
+static std::string Left(const std::string &s, size_t Count)
+{
+	return s.substr(0, Count);
+}
+
+static std::string Right(const std::string &s, size_t Count)
+{
+	if (Count >= s.length())
+		return s;
+	return s.substr(s.length() - Count);
+}
+
+static std::string Mid(const std::string &s, size_t First, size_t Count)
+{
+	if (First >= s.length())
+		return std::string();
+	return s.substr(First, Count);
+}
+
+static char CharAt(const std::string &s, size_t Pos)
+{
+	if (Pos >= s.length())
+		return 0;
+	return s[Pos];
+}
+
+static void Trim(std::string &s)
+{
+	size_t End = s.find_last_not_of(" \t\r\n");
+	if (End == std::string::npos)
+		s.clear();
+	else
+		s.erase(End + 1);
+}
+
+static std::string IntToString(int Value)
+{
+	char Buffer[16];
+	snprintf(Buffer, sizeof(Buffer), "%i", Value);
+	return Buffer;
+}
+
+// Field Index of a sentence, 0 is the address, without the checksum
+static std::string Field(const std::string &s, int Index)
+{
+	size_t First = 0;
+	for (int i = 0; i < Index; i++)
+	{
+		First = s.find(',', First);
+		if (First == std::string::npos)
+			return std::string();
+		First++;
+	}
+	size_t End = s.find_first_of(",*", First);
+	return s.substr(First, End == std::string::npos ? std::string::npos : End - First);
+}
+
+// ddmm.mm or dddmm.mm and N, S, E or W in degrees, NaN if empty
+static double NMEADegrees(const std::string &Value, const std::string &Hemisphere)
+{
+	if (Value.empty())
+		return NAN;
+	double v = atof(Value.c_str());
+	double Degrees = floor(v / 100.0);
+	Degrees += (v - Degrees * 100.0) / 60.0;
+	return Hemisphere == "S" || Hemisphere == "W" ? -Degrees : Degrees;
+}
+
+static SteadyClock s_SteadyClock;
+
+AutopilotCore::AutopilotCore(AutopilotSink *pSink)
+{
+	m_pSink = pSink;
+	m_pClock = &s_SteadyClock;
+	m_TimeoutRunning = false;
+	m_TimeoutRepeat = false;
+	m_TimeoutStart = 0;
+	m_NextWaypointStart = -1;
+	m_TrackSent = false;
+
+	// Standardparameter settings
+	NewAutoWindCommand = false;
+	NewAutoOnStandby = false;
+	ChangeValueToLast = false;
+	SendTrack = false;
+	TimeToSendNewWaypiont = 10; // Default 10 Sekunden.
+	NoDataTimeout = 12000;
+	EchoWindow = 1000;
+	CommandTimeout = 3000;
+	TargetTries = 3;
+	WriteMessages = false;
+	WriteDebug = false;
+	ModyfyRMC = false;
+	NewStandbyNoStandbyReceived = false;
+	SelectCounterStandby = 0;
+	STALKSendName = "STALK";
+	STALKReceiveName = "STALK";
+
+	Autopilot_Status = UNKNOWN;
+	Autopilot_Status_Before = UNKNOWN;
+	DisplayShow = 0;
+	StandbySelfPressed = false;
+	Standbycommandreceived = true;
+	NeedCompassCorrection = false;
+	CounterStandbySentencesReceived = 0;
+	NoStandbyCounter = 0;
+	IS_standby = 0;
+	ResponseLevel = 0; // Unbekannter Responselevel.
+	RudderLevel = 0; // Unbekannt
+	LastCompassCourse = -1; // Nicht gültig
+	BoatVariation = 0x01FF;  // Not Avalibal
+	WMM_receive_count = 60; // set to No Information from WMM
+	WayPointBearing = "unknown";
+
+	EchoesSuppressed = 0;
+	StatusFrames = 0;
+	StatusRepeats = 0;
+	FailedCommands = 0;
+	m_Events = 0;
+	m_LastStatusEvents = 0;
+	m_StatusSteady = false;
+	m_LastSampleValid = false;
+	m_Predicted = false;
+	m_PredictedCourse = 0;
+	m_PredictedSince = 0;
+	m_HeldChange = 0;
+	m_TargetHeading = -1;
+	m_TargetTries = 0;
+	m_TargetKeys = 0;
+	m_DodgeCourse = -1;
+	m_DodgeOffset = 0;
+	m_DodgeUntil = 0;
+	m_ProfileSent = 0;
+	m_ProfileStart = 0;
+	m_NormalColoursShown = false;
+	m_CompassText.reserve(32);
+	m_AnimatedText.reserve(32);
+	m_ComposedKind = COMPASS_OTHER;
+	m_CompassKind = COMPASS_OTHER;
+}
+
+void AutopilotCore::CopySettings(const AutopilotCore &From)
+{
+	NewAutoWindCommand = From.NewAutoWindCommand;
+	NewAutoOnStandby = From.NewAutoOnStandby;
+	ChangeValueToLast = From.ChangeValueToLast;
+	SendTrack = From.SendTrack;
+	TimeToSendNewWaypiont = From.TimeToSendNewWaypiont;
+	NoDataTimeout = From.NoDataTimeout;
+	EchoWindow = From.EchoWindow;
+	CommandTimeout = From.CommandTimeout;
+	TargetTries = From.TargetTries;
+	WriteMessages = From.WriteMessages;
+	WriteDebug = From.WriteDebug;
+	NewStandbyNoStandbyReceived = From.NewStandbyNoStandbyReceived;
+	SelectCounterStandby = From.SelectCounterStandby;
+	Parameters.MaxAgeMs = From.Parameters.MaxAgeMs;
+	SeaState.Enabled = From.SeaState.Enabled;
+	SeaState.MinIntervalMs = From.SeaState.MinIntervalMs;
+	Track.Enabled = From.Track.Enabled;
+	Track.MinIntervalMs = From.Track.MinIntervalMs;
+}
+
+void AutopilotCore::Redisplay()
+{
+	m_Events++;
+	m_ShownStatus.clear();
+	m_ShownCompass.clear();
+	m_NormalColoursShown = false;
+}
+
+void AutopilotCore::ShowStatus(const std::string &Text)
+{
+	if (Text == m_ShownStatus)
+		return;
+	m_ShownStatus = Text;
+	m_pSink->ShowStatus(Text);
+}
+
+void AutopilotCore::ShowCompass(const std::string &Text, int Kind)
+{
+	// While the no standby error is shown, the dialog blinks "klick to reset" with every text.
+	m_CompassKind = Kind;
+	if (Text == m_ShownCompass && NoStandbyCounter == 0)
+		return;
+	m_ShownCompass = Text;
+	m_pSink->ShowCompass(Text);
+}
+
+void AutopilotCore::ShowNormalColours()
+{
+	if (m_NormalColoursShown)
+		return;
+	m_NormalColoursShown = true;
+	m_pSink->ShowNormalColours();
+}
+
+// m_ComposedKind is only known after the text is composed
+void AutopilotCore::ShowCourse(const std::string &sentence)
+{
+	const std::string &Text = CourseText(sentence);
+	ShowCompass(Text, m_ComposedKind);
+}
+
+void AutopilotCore::ShowMAGCourse(const std::string &sentence)
+{
+	const std::string &Text = MAGCourseText(sentence);
+	ShowCompass(Text, m_ComposedKind);
+}
+
+const std::string &AutopilotCore::CourseText(const std::string &sentence)
+{
+	if (!m_LastSampleValid) // the old way shows the errors
+	{
+		m_ComposedKind = COMPASS_OTHER;
+		return m_CompassText = GetAutopilotCompassCourse(sentence) + " ( " + GetAutopilotCompassDifferenz(sentence) + " )";
+	}
+	m_ComposedKind = COMPASS_COURSE;
+	ComposeCourse(m_CompassText, m_LastSample.Heading);
+	return m_CompassText;
+}
+
+// A predicted locked course is marked with '*'
+void AutopilotCore::ComposeCourse(std::string &Text, int Heading) const
+{
+	int LockedCourse = m_Predicted ? m_PredictedCourse : m_LastSample.LockedCourse;
+	int Difference = Heading - LockedCourse;
+	if (Difference >= 180)
+		Difference -= 360;
+	if (Difference < -180)
+		Difference += 360;
+	Text.assign(HeadingText::Degrees(LockedCourse));
+	if (m_Predicted)
+		Text.append("*");
+	Text.append(" ( ");
+	Text.append(HeadingText::Difference(Difference));
+	Text.append(" )");
+}
+
+const std::string &AutopilotCore::MAGCourseText(const std::string &sentence)
+{
+	if (!m_LastSampleValid)
+	{
+		m_ComposedKind = COMPASS_OTHER;
+		return m_CompassText = GetAutopilotMAGCourse(sentence);
+	}
+	m_ComposedKind = COMPASS_HEADING;
+	m_CompassText.assign(HeadingText::Degrees(m_LastSample.Heading));
+	return m_CompassText;
+}
+
+static int HeadingChange(int From, int To)
+{
+	int Change = (To - From) % 360;
+	if (Change >= 180)
+		Change -= 360;
+	if (Change < -180)
+		Change += 360;
+	return Change;
+}
+
+// Over the last three samples, the headings are whole degrees. Both steps
+// must turn the same way, a jump of the compass is not extrapolated.
+bool AutopilotCore::TurnRate(double &DegreesPerSecond) const
+{
+	size_t Size = Telemetry.Size(0);
+	if (Size < 3)
+		return false;
+	const TelemetryBucket &Last = Telemetry.At(0, Size - 1);
+	const TelemetryBucket &Before = Telemetry.At(0, Size - 2);
+	const TelemetryBucket &First = Telemetry.At(0, Size - 3);
+	int64_t Time1 = Before.TimeLast - First.TimeLast;
+	int64_t Time2 = Last.TimeLast - Before.TimeLast;
+	if (Time1 <= 0 || Time2 <= 0 || Time1 + Time2 > 4 * ANIMATION_MAX_AGE)
+		return false;
+	int Change1 = HeadingChange(First.Heading, Before.Heading);
+	int Change2 = HeadingChange(Before.Heading, Last.Heading);
+	if ((Change1 < 0 && Change2 > 0) || (Change1 > 0 && Change2 < 0) ||
+		abs(Change1) * 1000.0 / Time1 > ANIMATION_MAX_RATE || abs(Change2) * 1000.0 / Time2 > ANIMATION_MAX_RATE)
+		return false;
+	DegreesPerSecond = (Change1 + Change2) * 1000.0 / (Time1 + Time2);
+	return true;
+}
+
+bool AutopilotCore::IsTurning() const
+{
+	double Rate;
+	// Not while a message is held (DisplayShow) or the display blinks
+	if (m_CompassKind == COMPASS_OTHER || DisplayShow != 0 || NoStandbyCounter != 0)
+		return false;
+	return TurnRate(Rate) && fabs(Rate) >= ANIMATION_MIN_RATE && fabs(Rate) <= ANIMATION_MAX_RATE;
+}
+
+bool AutopilotCore::Animate()
+{
+	if (!IsTurning())
+		return false;
+	double Rate;
+	TurnRate(Rate);
+	const TelemetryBucket &Last = Telemetry.At(0, Telemetry.Size(0) - 1);
+	int64_t Age = m_pClock->NowMs() - Last.TimeLast;
+	if (Age < 0 || Age > ANIMATION_MAX_AGE)
+		return false;
+	int Heading = (int)floor(Last.Heading + Rate * Age / 1000.0 + 0.5) % 360;
+	if (Heading < 0)
+		Heading += 360;
+	if (m_CompassKind == COMPASS_COURSE)
+		ComposeCourse(m_AnimatedText, Heading);
+	else
+		m_AnimatedText.assign(HeadingText::Degrees(Heading));
+	// Only a new whole degree is drawn
+	if (m_AnimatedText != m_ShownCompass)
+	{
+		m_ShownCompass = m_AnimatedText;
+		m_pSink->ShowCompass(m_AnimatedText);
+	}
+	return true;
+}
+
+void AutopilotCore::SetNMEASentence(const std::string &sentence_incomming)
+{
+	std::string sentence = sentence_incomming;
+
+	Trim(sentence); // entferne Spaces
+	if (EchoWindow > 0 && m_Echoes.IsEcho(EchoFilter::Fingerprint(sentence), m_pClock->NowMs()))
+	{
+		// Our own sentence back from the multiplexer, not from a ST6001
+		EchoesSuppressed++;
+		if (WriteDebug) Info("Echo %s", sentence.c_str());
+		return;
+	}
+	if (Mid(sentence, 3, 3) == "RMB")
+	{
+		GetWaypointBearing(sentence);
+		m_Events++;
+		return;
+	}
+	if (Mid(sentence, 3, 3) == "RMC" && ModyfyRMC)
+	{
+        if (BoatVariation != 0x01FF) // Variation is valid from WMM
+        {
+            WMM_receive_count++;
+            if (WMM_receive_count > 60) // 60 RMC Information
+                BoatVariation = 0x01FF; // set Variation to not avalibal
+        }
+		AddVariationToRMCanSendOut(sentence);
+		return;
+	}
+	std::string Lsentence_Command = "$" + STALKReceiveName + ",86",
+		Lsentence_Response = "$" + STALKReceiveName + ",87",
+		Lsentence_Rudder = "$" + STALKReceiveName + ",91";
+
+	if (Left(sentence, 9) == Lsentence_Response)
+	{
+		m_Events++;
+		if (WriteDebug) Info("Response %s", sentence.c_str());
+		// Response Ermittlung.
+		ResponseLevel = atoi(Mid(sentence, 13, 2).c_str());
+		bool Asked = Parameters.Received(PARAMETER_RESPONSE, ResponseLevel, m_pClock->NowMs());
+		if (ProfileReceived(PARAMETER_RESPONSE) || Asked)
+			return; // asked in Poll() or for a profile, not by the user
+		ShowNormalColours();
+		ShowStatus("Response");
+		ShowCompass(Mid(sentence, 13, 2));
+		m_pSink->ShowParameter(PARAMETER_RESPONSE, ResponseLevel);
+		if (WriteMessages) Message("Get Responce");
+		return;
+	}
+	if (Left(sentence, 9) == Lsentence_Rudder)
+	{
+		m_Events++;
+		if (WriteDebug) Info("Rudder %s", sentence.c_str());
+		// Rudder Ermittlung. 
+		RudderLevel = atoi(Mid(sentence, 13, 2).c_str());
+		bool Asked = Parameters.Received(PARAMETER_RUDDERGAIN, RudderLevel, m_pClock->NowMs());
+		if (ProfileReceived(PARAMETER_RUDDERGAIN) || Asked)
+			return;
+		ShowNormalColours();
+		ShowStatus("Rudder");
+		ShowCompass(Mid(sentence, 13, 2));
+		m_pSink->ShowParameter(PARAMETER_RUDDERGAIN, RudderLevel);
+		if (WriteMessages) Message(" Get Rudder Gain");
+		return;
+	}
+	if (Left(sentence, 9) == Lsentence_Command)
+	{
+		m_Events++;
+		if (WriteDebug) Info("Keystroke %s", sentence.c_str());
+		// Commandos von anderem St6002 erkennen
+		if (Mid(sentence, 11, 7) == "1,02,FD" ||   // Standby pressed
+			Mid(sentence, 11, 7) == "1,42,BD")    // Standby pressed longer ab Version 0.4
+		{
+			Standbycommandreceived = true;
+			if (WriteMessages) Message("Received Standby Pressed from ST6001 %s", sentence.c_str());
+			NeedCompassCorrection = false;
+		}
+		else
+		{
+			if (WriteMessages) Message("Received Button Pressed from ST6001 %s", sentence.c_str());
+			NeedCompassCorrection = false;
+		}
+		return;
+	}
+	if (Left(sentence, 9) == "$" + STALKReceiveName + ",84") // Comes in 1 Second delay
+	{
+		StatusFrames++;
+		bool Repeat = IsStatusRepeat(sentence);
+		if (!Repeat || !m_LastSampleValid)
+		{
+			StatusDatagram Status;
+			m_LastSampleValid = GetAutopilotStatus(sentence, Status);
+			if (m_LastSampleValid)
+			{
+				m_LastSample.Heading = (int16_t)Status.Heading;
+				m_LastSample.LockedCourse = (int16_t)Status.LockedCourse;
+				m_LastSample.Rudder = (int8_t)Status.Rudder;
+				m_LastSample.Flags = 0;
+				if (Status.Mode & 0x02) m_LastSample.Flags |= TELEMETRY_AUTO;
+				if (Status.Mode & 0x04) m_LastSample.Flags |= TELEMETRY_VANE;
+				if (Status.Mode & 0x08) m_LastSample.Flags |= TELEMETRY_TRACK;
+				if (Status.TurningRight) m_LastSample.Flags |= TELEMETRY_TURNING_RIGHT;
+				if (Status.Alarms & 0x04) m_LastSample.Flags |= TELEMETRY_OFFCOURSE;
+				if (Status.Alarms & 0x08) m_LastSample.Flags |= TELEMETRY_WINDSHIFT;
+				if (Status.Display & 0x10) m_LastSample.Flags |= TELEMETRY_LARGE_XTE;
+			}
+		}
+		if (m_LastSampleValid)
+		{
+			m_LastSample.Time = m_pClock->NowMs();
+			Telemetry.Add(m_LastSample);
+			Statistics.Add(m_LastSample);
+			AdaptResponse();
+			if (Reconcile())
+				Repeat = false;
+			CheckTarget();
+			FollowTrack();
+		}
+		if (Repeat)
+		{
+			// Comes every second while steady on course, the last one was the same.
+			StatusRepeats++;
+			if (WriteDebug) Info("Repeat %s", sentence.c_str());
+			StatusReceived();
+			return;
+		}
+		StatusState Before = GetStatusState();
+		uint64_t Events = m_Events;
+		HandleStatus(sentence);
+		m_LastStatus = sentence;
+		m_LastStatusState = GetStatusState();
+		m_LastStatusEvents = m_Events;
+		m_StatusSteady = m_Events == Events && m_LastStatusState == Before;
+	}
+}
+
+bool AutopilotCore::StatusState::operator==(const StatusState &s) const
+{
+	return Autopilot_Status == s.Autopilot_Status &&
+		Autopilot_Status_Before == s.Autopilot_Status_Before &&
+		DisplayShow == s.DisplayShow &&
+		StandbySelfPressed == s.StandbySelfPressed &&
+		Standbycommandreceived == s.Standbycommandreceived &&
+		NeedCompassCorrection == s.NeedCompassCorrection &&
+		CounterStandbySentencesReceived == s.CounterStandbySentencesReceived &&
+		NoStandbyCounter == s.NoStandbyCounter &&
+		IS_standby == s.IS_standby &&
+		LastCompassCourse == s.LastCompassCourse &&
+		NextWaypointStart == s.NextWaypointStart &&
+		TrackSent == s.TrackSent;
+}
+
+AutopilotCore::StatusState AutopilotCore::GetStatusState() const
+{
+	StatusState s;
+	s.Autopilot_Status = Autopilot_Status;
+	s.Autopilot_Status_Before = Autopilot_Status_Before;
+	s.DisplayShow = DisplayShow;
+	s.StandbySelfPressed = StandbySelfPressed;
+	s.Standbycommandreceived = Standbycommandreceived;
+	s.NeedCompassCorrection = NeedCompassCorrection;
+	s.CounterStandbySentencesReceived = CounterStandbySentencesReceived;
+	s.NoStandbyCounter = NoStandbyCounter;
+	s.IS_standby = IS_standby;
+	s.LastCompassCourse = LastCompassCourse;
+	s.NextWaypointStart = m_NextWaypointStart;
+	s.TrackSent = m_TrackSent;
+	return s;
+}
+
+// The same 0x84 as the last one needs nothing, if handling the last one did
+// not change the state, and nothing happened since (keys, sent sentences,
+// changes from the dialog) and no track is waiting to be sent.
+bool AutopilotCore::IsStatusRepeat(const std::string &sentence) const
+{
+	return m_StatusSteady &&
+		m_LastStatusEvents == m_Events &&
+		NoStandbyCounter == 0 &&	// the dialog blinks with every 0x84
+		(m_NextWaypointStart < 0 || m_TrackSent) &&
+		sentence == m_LastStatus &&
+		GetStatusState() == m_LastStatusState;
+}
+
+void AutopilotCore::StatusReceived()
+{
+	if (m_TimeoutRunning)
+	{
+		m_TimeoutStart = m_pClock->NowMs();
+		m_TimeoutRepeat = true;
+	}
+}
+
+// Binary datagrams take the same way as the ones from a NMEA <-> Seatalk converter.
+void AutopilotCore::SetDatagram(const SeatalkDatagram &Datagram)
+{
+	SetNMEASentence(SeatalkSentence(STALKReceiveName, Datagram));
+}
+
+void AutopilotCore::HandleStatus(const std::string &sentence)
+{
+	// SS & 0x80 : Displays "Auto Rel" on 600R  this is Next Waypoint ist Bearing !!!
+	// 
+	int tmp, Key;
+
+	StatusReceived();
+	if (DisplayShow > 0)
+	{
+		DisplayShow--;
+		//return;
+	}
+	if (CounterStandbySentencesReceived == 0) // falls noch kein Kommando gekommen ist, bleibt der alte Status.
+		Autopilot_Status_Before = Autopilot_Status;
+	ShowNormalColours();
+	Autopilot_Status = GetAutopilotMode(sentence);
+	switch (Autopilot_Status)
+	{
+		case	AUTO:
+			if (WriteDebug) Info("Received Auto %s", sentence.c_str());
+			if (Autopilot_Status_Before != Autopilot_Status)
+			{
+				// Nur für Logging
+				if (WriteMessages) Message("Auto-Status changed to AUTO");
+			}
+			if (StandbySelfPressed == true)
+			{
+				if (WriteMessages) Message("Standby self Pressed detected in Auto Mode %s", sentence.c_str());
+				NeedCompassCorrection = false;
+				// Soll nach Standby gehen ist aber noch in Auto mode.
+				DisplayShow = 2; // 2 Sequenzen abwarten
+				if (IS_standby < 2)
+				{
+					IS_standby++;
+					break;
+				}
+			} else
+			if (Standbycommandreceived == true && Autopilot_Status_Before != UNKNOWN)
+			{
+				// Warten ob Der Autopilot noch in Standbymode geht, falls Dieses "Auto" Signal kurz hinter dem
+				// Drücken der Standbytaste noch kam, und dadurch den "Standbycommandreceived Status wieder nach
+				// false setzt.
+				// Zwei Sequenzen abwarten.
+				if (WriteMessages) Message("Standby from St6001 detected in Auto Mode %s", sentence.c_str());
+				NeedCompassCorrection = false;
+				if (IS_standby < 2)
+				{
+					IS_standby++;
+					break;
+				}
+			}
+			if (NeedCompassCorrection == true)
+			{
+				// Es wurde Automodus durch fehler aktivert, und es muss der Curse auf den alen gesetzt werden.
+				// Sende so lange Signale, bis der alte Compasskurs wider eingestellt ist.
+				if (LastCompassCourse < 0 || LastCompassCourse > 360)
+				{
+					// Noch nicht gesetzt
+					if (WriteMessages) Message("No Last Compass Course");
+					NeedCompassCorrection = false;
+					break;
+				}
+				if (atoi(GetAutopilotCompassCourse(sentence).c_str()) == LastCompassCourse)
+				{
+					// Der alte Kurs ist eingestellt.
+					if (WriteMessages) Message("Correct Compass ready");
+					NeedCompassCorrection = false;
+				}
+				else
+				{
+					// Korrectur durchführen
+					// -------------------------------
+					tmp = atoi(GetAutopilotCompassCourse(sentence).c_str());
+					if (tmp < 0 || tmp > 360)
+					{
+						//Fehler
+						if (WriteMessages) Message("Compass Error");
+						NeedCompassCorrection = false;
+						break;
+					}
+					if (180 > abs(tmp - LastCompassCourse) &&  30 < abs(tmp - LastCompassCourse))
+					{
+						// Nicht mehr als 30 Grad Änderung !!
+						if (WriteMessages) Message("No Correction more than 30 degree");
+						NeedCompassCorrection = false;
+						break;
+					}
+					if (WriteMessages) Message("Correct Compass course from %i to %i", tmp, LastCompassCourse);
+					if (180 < abs(tmp - LastCompassCourse))
+					{
+						// Über Nodern ändern
+						if (tmp > LastCompassCourse)
+						{
+							// Compasskurs muss über Norden mit PLus verändert werden. (bis 0 Grad.)
+							if ((tmp - LastCompassCourse) >= 10)
+							{
+								// Mehr als 10 Grad differenz !! also +10 Grad ändern.
+								if (WriteMessages) Message("Over North + 10");
+								SendKeystroke(KEY_PLUS_10);
+							}
+							else
+							{
+								// Weniger als 10 Grad ändern.
+								if (WriteMessages) Message("Over North + 1");
+								SendKeystroke(KEY_PLUS_1);
+							}
+						}
+						else
+						{
+							// Compasskurs von z.B. 5 nach 340 ... ändern mit Minus
+							if ((LastCompassCourse - tmp) >= 10)
+							{
+								// Mehr als 10 Grad differenz !! also +10 Grad ändern.
+								if (WriteMessages) Message("Over North - 10");
+								SendKeystroke(KEY_MINUS_10);
+							}
+							else
+							{
+								// Weniger als 10 Grad ändern.
+								if (WriteMessages) Message("Over North - 1");
+								SendKeystroke(KEY_MINUS_1);
+							}
+						}
+					}
+					else
+					{
+						// Normale Änderung nicht über Norden.
+						if (tmp > LastCompassCourse)
+						{
+							// Der Neue Compasskurs ist grösser als der alte also Verkleineren.
+							if ((tmp - LastCompassCourse) >= 10)
+							{
+								// Mehr als 10 Grad differenz !! also +10 Grad ändern.
+								if (WriteMessages) Message("Korrectur - 10");
+								SendKeystroke(KEY_MINUS_10);
+							}
+							else
+							{
+								// Weniger als 10 Grad ändern.
+								if (WriteMessages) Message("Korrectur - 1");
+								SendKeystroke(KEY_MINUS_1);
+							}
+						}
+						else
+						{
+							// Der neue Compass kurs ist kleiner als der alte. also Vergrössern.
+							if ((LastCompassCourse - tmp) >= 10)
+							{
+								// Mehr als 10 Grad differenz !! also +10 Grad ändern.
+								if (WriteMessages) Message("Korrectur + 10");
+								SendKeystroke(KEY_PLUS_10);
+							}
+							else
+							{
+								// Weniger als 10 Grad ändern.
+								if (WriteMessages) Message("Korrectur + 1");
+								SendKeystroke(KEY_PLUS_1);
+							}
+						}
+					}
+				}
+				if (DisplayShow == 0)
+				{
+					ShowStatus("Auto Correct");
+					ShowCourse(sentence);
+				}
+			}
+			else
+			{
+				LastCompassCourse = atoi(GetAutopilotCompassCourse(sentence).c_str());
+				if (DisplayShow == 0)
+				{
+					if (ConfirmNextWaypoint(sentence) == false) // Check if Print "NextWaypoint + Bearing"
+					{
+						ShowStatus("Auto");
+						ShowCourse(sentence);
+					}
+				}
+			}
+			if (IS_standby != 0)
+				if (WriteMessages) Message("No Standby Message comming don't know why. Say in Auto Mode. Sentence %s", sentence.c_str());
+			IS_standby = 0;
+			Standbycommandreceived = false;
+			StandbySelfPressed = false;
+			CounterStandbySentencesReceived = 0;
+			break;
+		case AUTOTRACK :
+			if (WriteDebug) Info("Received Auto-Track %s", sentence.c_str());
+			if (Autopilot_Status_Before != Autopilot_Status)
+			{
+				// Nur für Logging
+				if (WriteMessages) Message("Auto-Status changed to AUTO-TRACK");
+			}
+			if (StandbySelfPressed == true)
+			{
+				if (WriteMessages) Message("Standby self Pressed detected in Auto-Track Mode %s", sentence.c_str());
+				// Soll nach Standby gehen ist aber noch in Auto mode.
+				DisplayShow = 2; // 2 Sequenzen abwarten
+				if (IS_standby < 2)
+				{
+					IS_standby++;
+					break;
+				}
+			} else
+			if (Standbycommandreceived == true && Autopilot_Status_Before != UNKNOWN)
+			{
+				// Warten ob Der Autopilot noch in Standbymode geht, falls Dieses "Auto" Signal kurz hinter dem
+				// Drücken der Standbytaste noch kam, und dadurch den "Standbycommandreceived Status wieder nach
+				// false setzt.
+				// Zwei Sequenzen abwarten.
+				if (WriteMessages) Message("Standby from St6001 detected in Auto-Track Mode %s", sentence.c_str());
+				if (IS_standby < 2)
+				{
+					IS_standby++;
+					break;
+				}
+			}
+			if (IS_standby != 0)
+				if (WriteMessages) Message("No Standby Message comming don't know why. Say in Auto-Track Mode. Sentence %s", sentence.c_str());
+			IS_standby = 0;
+			Standbycommandreceived = false;
+			StandbySelfPressed = false;
+			CounterStandbySentencesReceived = 0;
+			if (DisplayShow == 0)
+			{
+				if (ConfirmNextWaypoint(sentence) == false) // Check if Print "NextWaypoint + Bearing"
+				{
+					ShowStatus("Auto-Track");
+					ShowCourse(sentence);
+				}
+			}
+			break;
+		case	AUTOWIND:
+			if (WriteDebug) Info("Received Auto-Wind %s", sentence.c_str());
+			if (Autopilot_Status_Before != Autopilot_Status)
+			{
+				// Nur für Logging
+				if (WriteMessages) Message("Auto-Status changed to AUTO-WIND");
+			}
+			if (StandbySelfPressed == true)
+			{
+				if (WriteMessages) Message("Standby self Pressed detected in Auto-Wind Mode %s", sentence.c_str());
+				// Soll nach Standby gehen ist aber noch in Auto mode.
+				DisplayShow = 2; // 2 Sequenzen abwarten
+				if (IS_standby < 2)
+				{
+					IS_standby++;
+					break;
+				}
+			} else
+			if (Standbycommandreceived == true && Autopilot_Status_Before != UNKNOWN)
+			{
+				// Warten ob Der Autopilot noch in Standbymode geht, falls Dieses "Auto" Signal kurz hinter dem
+				// Drücken der Standbytaste noch kam, und dadurch den "Standbycommandreceived Status wieder nach
+				// false setzt.
+				// Zwei Sequenzen abwarten.
+				if (WriteMessages) Message("Standby from St6001 detected in Auto-Wind Mode %s", sentence.c_str());
+				if (IS_standby < 2)
+				{
+					IS_standby++;
+					break;
+				}
+			}
+			if (IS_standby != 0)
+				if (WriteMessages) Message("No Standby Message comming don't know why. Say in Auto-Wind Mode. Sentence %s", sentence.c_str());
+			IS_standby = 0;
+			Standbycommandreceived = false;
+			StandbySelfPressed = false;
+			CounterStandbySentencesReceived = 0;
+			if (DisplayShow == 0)
+			{
+				ShowStatus("Auto-Wind");
+				ShowCourse(sentence);
+			}
+			break;
+		case	WINDSHIFT:
+			if (WriteDebug) Info("Received Windshift %s", sentence.c_str());
+			if (Autopilot_Status_Before != Autopilot_Status)
+			{
+				// Nur für Logging
+				if (WriteMessages) Message("Auto-Status .... Windshift received");
+			}
+			if (StandbySelfPressed == true)
+			{
+				// Soll nach Standby gehen ist aber noch in Auto mode.
+				DisplayShow = 2; // 2 Sequenzen abwarten
+				if (IS_standby < 2)
+				{
+					IS_standby++;
+					break;
+				}
+			}
+			StandbySelfPressed = false;
+			if (NewAutoWindCommand)
+			{
+				// Send New Sentence Auto-Wind
+				if (WriteMessages) Message("Send New Auto-Wind Command");
+				SendKeystroke(KEY_AUTOWIND);
+			}
+			if (DisplayShow == 0)
+			{
+				ShowStatus("Wind-Shift");
+				ShowCourse(sentence);
+				DisplayShow = 10;
+			}
+			break;
+		case	OFFCOURSE:
+			if (WriteDebug) Info("Received Off-Course %s", sentence.c_str());
+			if (Autopilot_Status_Before != Autopilot_Status)
+			{
+				// Nur für Logging
+				if (WriteMessages) Message("Auto-Status .... Off-Course received");
+			}
+			if (StandbySelfPressed == true)
+			{
+				// Soll nach Standby gehen ist aber noch in Auto mode.
+				DisplayShow = 2; // 2 Sequenzen abwarten
+				if (IS_standby < 2)
+				{
+					IS_standby++;
+					break;
+				}
+			}
+			StandbySelfPressed = false;
+			if (DisplayShow == 0)
+			{
+				ShowStatus("Off-Course");
+				ShowCourse(sentence);
+				DisplayShow = 10;
+			}
+			break;
+		case	STANDBY :
+			if (WriteDebug) Info("Received Standby %s", sentence.c_str());
+			if (Autopilot_Status_Before != Autopilot_Status)
+			{
+				// Nur für Logging
+				if (WriteMessages) Message("Auto-Status changed to STANDBY");
+			}
+			if (Autopilot_Status_Before != STANDBY && Autopilot_Status_Before != UNKNOWN &&
+				CounterStandbySentencesReceived == 0 &&
+				StandbySelfPressed == false && Standbycommandreceived == false)
+				Statistics.StandbyDrop(); // Not from here and not from a ST6001
+			if (Autopilot_Status_Before != STANDBY &&
+				NewStandbyNoStandbyReceived == true &&  // Sool Überhaupt ein Neues Standby gesendent werden ?
+				Standbycommandreceived == false &&
+				NoStandbyCounter <= SelectCounterStandby &&  // Es soll StandbyCommando ausgewertet werden. Maximale Anzahl.
+				ConfirmNextWaypoint(sentence) == false) // Kein Fehler aufgetreten, sonst geht der Autopilot selber in Standby
+				
+			{
+				if (WriteMessages) Message("Standby received without StandbyCommand before %s", sentence.c_str());
+				if (CounterStandbySentencesReceived < 3) // 4 Senteces warten, ob doch noch ein Commando kommt.
+				{
+					ShowStatus("No Standby");
+					ShowCompass("Error");
+					CounterStandbySentencesReceived++;
+					break;
+				}
+				else
+				{
+					// Kein Kommando gekommen sende nun Neues Auto Commando.
+					IS_standby = 0;
+					if (WriteMessages) Message("StandbyCommandreceived = False %s", sentence.c_str());
+					CounterStandbySentencesReceived = 0;
+					Autopilot_Status = Autopilot_Status_Before; // Dadurch werden mehrere Seqnenzen gesendet, wenn nötig.
+					Key = 0;
+					if (Autopilot_Status_Before == AUTO)
+					{
+						if (WriteMessages) Message("---------------Send New Auto------------");
+						Key = KEY_AUTO;
+						if (ChangeValueToLast == true)
+						{
+							// Kurskorrectur durchführen
+							if (WriteMessages) Message("Course correction is enabled");
+							NeedCompassCorrection = true;
+						}
+						else
+						{
+							if (WriteMessages) Message("Course correction is disabled using aktuell Compass-course");
+						}
+					}
+					if (Autopilot_Status_Before == AUTOWIND)
+					{
+						if (WriteMessages) Message("-------------Send New Auto-Wind---------");
+						Key = KEY_AUTOWIND;
+					}
+					if (Autopilot_Status_Before == AUTOTRACK)
+					{
+						if (WriteMessages) Message("-------------Send New Auto-Track--------");
+						Key = KEY_TRACK;
+					}
+					if (Key != 0)
+						SendKeystroke(Key);
+					// FehlerCounter hohchzählen.
+					NoStandbyCounter++;
+					if (NoStandbyCounter > SelectCounterStandby)
+					{
+						if (WriteMessages) Message("-------Last Time Sending new One--------");
+					}
+					// Rot
+					m_pSink->ShowAlarmColours();
+				}
+				break;
+			}
+			else
+			{
+				if(CounterStandbySentencesReceived != 0)
+					if (WriteMessages) Message("Standby Push Signal received now.");
+				CounterStandbySentencesReceived = 0;
+				NeedCompassCorrection = false;
+			}
+			if (Autopilot_Status_Before == AUTO || Autopilot_Status_Before == AUTOWIND) // Zustandänderung von Auto -> Standby
+			{
+				CounterStandbySentencesReceived = 0;
+				if (StandbySelfPressed == false &&
+					NewAutoOnStandby == true)  // Generell neues Auto Senden, wenn nicht von hier gesendet.
+					                           // Ignoriert St6001 Standby Signal !! Vorsiht.
+				{
+					// Standby not from here !! goto AUTO
+					//
+					if (WriteMessages) Message("Selfpressed = False, Auto-Status-before = Auto or Autowind %s", sentence.c_str());
+					if (WriteMessages) Message("---------------Send New Auto------------");
+					IS_standby = 0;
+					Standbycommandreceived = false;
+					CounterStandbySentencesReceived = 0;
+					SendKeystroke(KEY_AUTO);
+					if (ChangeValueToLast == true)
+					{
+						// Kurskorrectur durchführen
+						if (WriteMessages) Message("Course correction(2) is enabled");
+						NeedCompassCorrection = true;
+					}
+					else
+					{
+						if (WriteMessages) Message("Course correction(2) is disabled using aktuell Compass-course");
+					}
+				}
+				StandbySelfPressed = false;
+			}
+			if(Autopilot_Status_Before == STANDBY)
+			{
+				// War schon Standby nun Zur Sicherheit
+				StandbySelfPressed = false;
+				Standbycommandreceived = false;
+				IS_standby = 0;
+			}
+			if (DisplayShow == 0)
+			{
+				if (ConfirmNextWaypoint(sentence) == false) // Check if Print "NextWaypoint + Bearing"
+				{
+					ShowStatus("Standby");
+					ShowMAGCourse(sentence);
+				}
+			}
+			break;
+		case	UNKNOWN:
+			if (WriteDebug) Info("Received Unknown %s", sentence.c_str());
+			if (DisplayShow == 0)
+			{
+				ShowStatus("----------");
+				ShowCompass("---");
+			}
+			IS_standby = 0;
+			Standbycommandreceived = true; // So when the Instruments are switched on again no Error !
+			CounterStandbySentencesReceived = 0;
+			NeedCompassCorrection = false;
+			break;
+	}
+}
+
+bool AutopilotCore::ConfirmNextWaypoint(const std::string &sentence)
+{
+	if (Mid(sentence, 28, 2) == "02")
+	{
+		// Autopilot is in normal Mode
+		m_NextWaypointStart = -1;
+		return false;
+	}
+
+	int c,b;
+
+	if (-1 == (c = GetHexValue(CharAt(sentence, 28))))
+	{
+		return false;
+	}
+	if (-1 == (b = GetHexValue(CharAt(sentence, 20))))
+	{
+		return false;
+	}
+
+	if ((c & 0x08) == 0x08 && (b & 0x02) == 0x02)  // Ist im AutoMode. und soll nach track
+	{ 
+		ShowStatus("Next WayP.");
+		ShowCompass(WayPointBearing);
+		if (SendTrack)
+		{
+			// Send Track automatisch. after TimeToSendNewWaypiont
+			int64_t Now = m_pClock->NowMs();
+			if (m_NextWaypointStart < 0)
+			{
+				m_NextWaypointStart = Now;
+				m_TrackSent = false;
+			}
+			// Only once, because don't send too sentences after the other
+			if (!m_TrackSent && Now - m_NextWaypointStart >= (int64_t)TimeToSendNewWaypiont * 1000)
+			{
+				SendKeystroke(KEY_TRACK);
+				m_TrackSent = true;
+				if (WriteMessages) Message("Send Track automatic %s", KeystrokeSentence(KEY_TRACK).c_str());
+			}
+		}		
+		return true;
+	}
+	if ((c & 0x01) == 0x01)
+	{   
+		ShowStatus("WayPoint");
+		WayPointBearing = "large XTE";
+		ShowCompass(WayPointBearing);
+		return true;
+	}
+	if (-1 == (c = GetHexValue(CharAt(sentence, 29))))
+	{
+		return false;
+	}
+	if ((c & 0x08) == 0x08)
+	{
+		ShowStatus("WayPoint");
+		WayPointBearing = "No Data";
+		ShowCompass(WayPointBearing);
+		StandbySelfPressed = true; // Autopilot geht von selbst auf AUTO
+		return true;
+	}
+	m_NextWaypointStart = -1;
+	return false; // Autopilot is in normal Mode
+}
+
+void AutopilotCore::GetWaypointBearing(const std::string &sentence)
+{
+	// Get from RMB Message
+	if (Field(sentence, 1) == "A")
+		Track.Destination(Field(sentence, 5), NMEADegrees(Field(sentence, 6), Field(sentence, 7)),
+			NMEADegrees(Field(sentence, 8), Field(sentence, 9)), m_pClock->NowMs());
+	std::string s = sentence;
+	int sLenght = s.length();
+	int i = 0;
+
+	while (i < 11)
+	{
+		sLenght = sLenght - s.find(",") - 1;
+		if (sLenght <= 0)
+		{
+			WayPointBearing = "error";
+			return;
+		}
+		s = Right(s, sLenght);
+		i++;
+		if (i == 5)
+		{
+			std::string Destination = Left(s, s.find(","));
+			if (Destination != DestinationWaypoint)
+			{
+				DestinationWaypoint = Destination;
+				Statistics.NewLeg(Destination);
+			}
+		}
+		if (i == 11)
+		{
+			WayPointBearing = Left(s, s.find(","));
+			if (WayPointBearing.find(".") != std::string::npos)
+				WayPointBearing = Left(WayPointBearing, WayPointBearing.find("."));
+			WayPointBearing += " \xC2\xB0"; // UTF-8 degree sign
+			return;
+		}
+	}
+	WayPointBearing = "unknown";
+	return;
+}
+
+int AutopilotCore::GetAutopilotMode(const std::string &sentence) const
+{
+	std::string s = sentence, HexValue;
+
+	//Trim(s);
+	int c;
+	int sLenght = s.length();
+	int i = 0, ReturnStatus = UNKNOWN;
+	
+	while (i < 7)
+	{
+		sLenght = sLenght - s.find(","  ) - 1;
+		if (sLenght <= 0)
+		{
+			return UNKNOWN;
+		}
+		s = Right(s, sLenght);
+		i++;
+		if (i == 5)
+		{
+			HexValue = Left(s, s.find(","));
+			if (HexValue.length() != 2)
+			{
+				ReturnStatus = UNKNOWN;
+				break;
+			}
+			if (-1 == (c = GetHexValue(HexValue[1])))
+			{
+				ReturnStatus = UNKNOWN;
+				break;
+			}
+		/*	if ((c & 0x08) == 0x08)
+				ReturnStatus = AUTOTRACK;
+			if ((c & 0x06) == 0x06 && ReturnStatus == UNKNOWN)
+				ReturnStatus = AUTOWIND;
+			if ((c & 0x02) == 0x02 && ReturnStatus == UNKNOWN)
+				ReturnStatus = AUTO;
+			if ((c & 0x02) == 0x00 && ReturnStatus == UNKNOWN)
+				ReturnStatus = STANDBY;  alte Version !! Fehler bei Standby und Autowind !   */
+			if ((c & 0x02) == 0x00) // Wenn Bit 2 = 0 auf jeden Fall Standby.
+				ReturnStatus = STANDBY;
+			// Wenn Bit 2 gesetzt ist, ist auf jeden Fall ein Auto Mode.
+			if ((c & 0x04) == 0x04 && ReturnStatus == UNKNOWN)
+				ReturnStatus = AUTOWIND;
+			if ((c & 0x08) == 0x08 && ReturnStatus == UNKNOWN)
+				ReturnStatus = AUTOTRACK;
+			if ((c & 0x02) == 0x02 && ReturnStatus == UNKNOWN)
+				ReturnStatus = AUTO;
+		}
+		if (i == 6 && ReturnStatus == AUTOWIND)
+		{
+			HexValue = Left(s, s.find(","));
+			if (HexValue.length() != 2)
+				return UNKNOWN;
+			if (-1 == (c = GetHexValue(HexValue[1])))
+				return UNKNOWN;
+			if ((c & 0x08) == 0x08)
+				return WINDSHIFT;
+		}
+		if (i == 6 && (ReturnStatus == AUTO || ReturnStatus == AUTOTRACK))
+		{
+			HexValue = Left(s, s.find(","));
+			if (HexValue.length() != 2)
+				return UNKNOWN;
+			if (-1 == (c = GetHexValue(HexValue[1])))
+				return UNKNOWN;
+			if ((c & 0x04) == 0x04)
+				return OFFCOURSE;
+		}
+	}
+	return ReturnStatus; 
+}
+
+// All bytes at once, the Get...Course() above give the values for the display.
+bool AutopilotCore::GetAutopilotStatus(const std::string &sentence, StatusDatagram &Status) const
+{
+	int Byte[9];	// 84,U6,VW,XY,0Z,0M,RR,SS,TT
+	size_t Pos = sentence.find(',');
+	int Count = 0;
+	while (Count < 9 && Pos != std::string::npos && Pos + 2 < sentence.length())
+	{
+		int High = GetHexValue(sentence[Pos + 1]), Low = GetHexValue(sentence[Pos + 2]);
+		if (High < 0 || Low < 0)
+			return false;
+		Byte[Count++] = (High << 4) | Low;
+		Pos += 3;
+		if (Pos < sentence.length() && sentence[Pos] != ',')
+			break;
+	}
+	if (Count < 8 || Byte[0] != 0x84)	// TT is not sent by every converter
+		return false;
+
+	int U = Byte[1] >> 4, VW = Byte[2], V = Byte[2] >> 4, XY = Byte[3];
+	Status.Heading = (U & 0x03) * 90 + (VW & 0x3F) * 2 + ((U >> 2) & 0x03) / 2 + ((U >> 2) & 0x01);
+	if (Status.Heading >= 360)
+		Status.Heading = 0;
+	Status.LockedCourse = ((V & 0x0C) >> 2) * 90 + XY / 2 + XY % 2;
+	if (Status.LockedCourse >= 360)
+		Status.LockedCourse = 0;
+	Status.Rudder = Byte[6] >= 0x80 ? Byte[6] - 0x100 : Byte[6];
+	Status.Mode = Byte[4] & 0x0F;
+	Status.Alarms = Byte[5] & 0x0F;
+	Status.Display = Byte[7];
+	Status.TurningRight = (U & 0x08) != 0;
+	return true;
+}
+
+int AutopilotCore::GetHexValue(char AsChar)
+{
+	char HexT[] = "0123456789ABCDEF";
+	char a = toupper((unsigned char)AsChar);
+	int i = 0;
+
+	while(i <= 15)
+	{
+		if (HexT[i] == a)
+			return i;
+		i++;
+	}
+	return -1;
+}
+
+
+std::string AutopilotCore::GetAutopilotCompassCourse(const std::string &sentence) const
+{
+	
+	std::string s = sentence, HexValue;
+
+	Trim(s);
+	int parameter[3] = { 0x00, 0x00, 0x00 };
+	int sLenght = s.length();
+	int i = 0, CompassValue = -1;
+
+	while (i < 5)
+	{
+		sLenght = sLenght - s.find(",") - 1;
+		if (sLenght <= 0)
+		{
+			return ("---");
+		}
+		s = Right(s, sLenght);
+		HexValue = Left(s, s.find(","));
+		i++;        
+		if (i == 3) // High Bit
+		{
+			if (HexValue.length() != 2)
+				return ("Err - 1");
+			if (-1 == (parameter[0] = GetHexValue(HexValue[0])))
+				return ("Err - 2");
+		}
+		if (i == 4)
+		{
+			if (HexValue.length() != 2)
+				return ("Err - 3");
+			if (-1 == (parameter[1] = GetHexValue(HexValue[0])))
+				return ("Err - 4");
+			if (-1 == (parameter[2] = GetHexValue(HexValue[1])))
+				return ("Err - 5");
+			parameter[1] = (parameter[1] << 4) | parameter[2];
+		    if (360 <= (CompassValue = (int)((parameter[0] & 0x0c) >> 2) * 90 + parameter[1] / 2 + parameter[1] % 2)) // Very good checked with St6002
+            {
+                CompassValue = 0;
+            }
+			return(IntToString(CompassValue));
+		}
+	} 
+	return ("---"); // Nicht def
+}
+
+std::string AutopilotCore::GetAutopilotMAGCourse(const std::string &sentence) const
+{
+
+	std::string s = sentence, HexValue;
+
+	Trim(s);
+	int parameter[3] = { 0x00, 0x00, 0x00 };
+	int sLenght = s.length();
+	int i = 0, CompassValue = -1;
+
+	while (i < 4)
+	{
+		sLenght = sLenght - s.find(",") - 1;
+		if (sLenght <= 0)
+		{
+			return ("---");
+		}
+		s = Right(s, sLenght);
+		HexValue = Left(s, s.find(","));
+		i++;
+		if (i == 2) // High Bit
+		{
+			if (HexValue.length() != 2)
+				return ("Err - 7");
+			if (-1 == (parameter[0] = GetHexValue(HexValue[0])))
+				return ("Err - 8");
+		}
+		if (i == 3)
+		{
+			if (HexValue.length() != 2)
+				return ("Err - 9");
+			if (-1 == (parameter[1] = GetHexValue(HexValue[0])))
+				return ("Err - 10");
+			if (-1 == (parameter[2] = GetHexValue(HexValue[1])))
+				return ("Err - 11");
+			parameter[1] = (parameter[1] << 4) | parameter[2];
+            if (360 <= (CompassValue = (int)(((parameter[0] & 0x03) * 90)
+                + ((parameter[1] & 0x3F) * 2)
+                + (((parameter[0] >> 2) & 0x03) / 2) 
+				+ ((parameter[0] >> 2) & 0x01))))
+            {
+                CompassValue = 0;
+            }
+			return(IntToString(CompassValue));
+		}
+	}
+	return ("---"); // Nicht def
+}
+
+std::string AutopilotCore::GetAutopilotCompassDifferenz(const std::string &sentence) const
+{
+
+	std::string s = sentence, HexValue;
+
+	Trim(s);
+	int parameter[3] = { 0x00, 0x00, 0x00 };
+	int sLenght = s.length();
+	int i = 0, CompassValue = -1, AutoValue = -1, ReturnCompassValue;
+
+	while (i < 5)
+	{
+		sLenght = sLenght - s.find(",") - 1;
+		if (sLenght <= 0)
+		{
+			return ("-");
+		}
+		s = Right(s, sLenght);
+		HexValue = Left(s, s.find(","));
+		i++;
+		if (i == 3) // High Bit
+		{
+			if (HexValue.length() != 2)
+				return ("a1");
+			if (-1 == (parameter[0] = GetHexValue(HexValue[0])))
+				return ("a2");
+		}
+		if (i == 4)
+		{
+			if (HexValue.length() != 2)
+				return ("a3");
+			if (-1 == (parameter[1] = GetHexValue(HexValue[0])))
+				return ("a4");
+			if (-1 == (parameter[2] = GetHexValue(HexValue[1])))
+				return ("a5");
+			parameter[1] = (parameter[1] << 4) | parameter[2];
+			if (360 <= (CompassValue = (int)((parameter[0] & 0x0c) >> 2) * 90 + parameter[1] / 2 + parameter[1] % 2))
+            {
+                CompassValue = 0;
+            }
+		}
+	}
+	s = sentence;
+	Trim(s);
+	sLenght = s.length();
+	i = 0;
+	while (i < 4)
+	{
+		sLenght = sLenght - s.find(",") - 1;
+		if (sLenght <= 0)
+		{
+			return ("-");
+		}
+		s = Right(s, sLenght);
+		HexValue = Left(s, s.find(","));
+		i++;
+		if (i == 2) // High Bit
+		{
+			if (HexValue.length() != 2)
+				return ("x7");
+			if (-1 == (parameter[0] = GetHexValue(HexValue[0])))
+				return ("x8");
+		}
+		if (i == 3)
+		{
+			if (HexValue.length() != 2)
+				return ("x9");
+			if (-1 == (parameter[1] = GetHexValue(HexValue[0])))
+				return ("x10");
+			if (-1 == (parameter[2] = GetHexValue(HexValue[1])))
+				return ("x11");
+			parameter[1] = (parameter[1] << 4) | parameter[2];
+			if (360 <= (AutoValue = (int)(((parameter[0] & 0x03) * 90)
+                + ((parameter[1] & 0x3F) * 2)
+                + (((parameter[0] >> 2) & 0x03) / 2) 
+				+ ((parameter[0] >> 2) & 0x01))))
+            {
+                AutoValue = 0;
+            }
+			ReturnCompassValue = AutoValue - CompassValue;
+			if (ReturnCompassValue >= 180)
+				ReturnCompassValue -= 360;
+			if (ReturnCompassValue < -180)
+				ReturnCompassValue += 360;
+			return(IntToString(ReturnCompassValue));
+		}
+	}
+	return ("-"); // Nicht def
+}
+
+void  AutopilotCore::AddVariationToRMCanSendOut(const std::string &sentence_incomming)
+{
+	if (CharAt(sentence_incomming, 1) == 'E' && CharAt(sentence_incomming, 2) == 'C')
+		return; // is My sentence
+	std::string Newsentence = Left(sentence_incomming, sentence_incomming.find("*")); // delete Checksumme
+
+	if (Newsentence.length() < 3)
+		return;
+	Newsentence[1] = 'E'; // Set to comes from Electronic Charts
+	Newsentence[2] = 'C';
+	if (BoatVariation == 0x01FF)
+	{
+		SendNMEASentence(Newsentence);  // Send out the Sentence without new Variation. not avalibal do that $ECRMC is send the origianl will be filterd
+		return;
+	}
+
+	int sLenght = Newsentence.length();
+	int i = 0;
+	int LastKomma = 0; // Stelle 0
+	while (i < 10)
+	{
+		if (sLenght < LastKomma)
+		{
+			if (WriteMessages) Message("Wrong RMC Message detected");
+			return; // error not the right
+		}
+		LastKomma += Right(Newsentence, sLenght - LastKomma).find(",") + 1;
+		if (LastKomma == 0)
+		{
+			if (WriteMessages) Message("Wrong RMC Message detected");
+			return; // error not the right
+		}
+		i++;
+	}
+	int Dummy = LastKomma;
+	std::string Appand = "";
+	// See if there is somthing after the NOT SET VAriation 'A' ...
+	if (sLenght >= Dummy)
+		Dummy += Right(Newsentence, sLenght - Dummy).find(",") + 1;
+	if (sLenght >= Dummy)
+		Dummy += Right(Newsentence, sLenght - Dummy).find(",") + 1;
+	if (sLenght >= Dummy)
+		Appand = Right(Newsentence, sLenght - Dummy);
+	Newsentence = Left(Newsentence, LastKomma);
+	if (fabs(BoatVariation) < 100)
+		Newsentence.append("0");
+	if (fabs(BoatVariation) < 10)
+		Newsentence.append("0");
+	char Variation[16];
+	snprintf(Variation, sizeof(Variation), "%3.1f", fabs(BoatVariation));
+	Newsentence.append(Variation);
+	Newsentence.append(",");
+	if (BoatVariation > 0)
+		Newsentence.append("E");
+	else
+		Newsentence.append("W");
+	if (Appand.length() != 0)
+	{	
+		Newsentence.append(",");
+		Newsentence.append(Appand);
+	}
+	SendNMEASentence(Newsentence);
+}
+
+void AutopilotCore::SendNMEASentence(const std::string &sentence)
+{
+	std::string Complete = sentence;
+	Complete.append("*");
+	Complete.append(ComputeChecksum(sentence));
+	if (EchoWindow > 0)
+	{
+		m_Echoes.WindowMs = EchoWindow;
+		m_Echoes.Sent(EchoFilter::Fingerprint(Complete), m_pClock->NowMs());
+	}
+	Complete.append("\r\n");
+	m_Events++;
+	m_pSink->PushSentence(Complete);
+}
+
+std::string AutopilotCore::KeystrokeSentence(int Key) const
+{
+	char Buffer[16];
+	snprintf(Buffer, sizeof(Buffer), ",86,21,%02X,%02X", Key & 0xFF, ~Key & 0xFF);
+	return "$" + STALKSendName + Buffer;
+}
+
+void AutopilotCore::SendKeystroke(int Key)
+{
+	SendNMEASentence(KeystrokeSentence(Key));
+	Predict(Key);
+}
+
+bool AutopilotCore::WriteParameter(int Parameter, int Value)
+{
+	if (!SendParameter(Parameter, Value))
+		return false;
+	// Display on ST6002 for 5 seconds
+	int DisplayKey = ParameterTable::Get(Parameter).DisplayKey;
+	if (DisplayKey)
+		SendKeystroke(DisplayKey);
+	return true;
+}
+
+bool AutopilotCore::Execute(const RemoteCommand &Command, std::string &Error)
+{
+	switch (Command.Method)
+	{
+	case REMOTE_STANDBY:
+		StandbySelfPressed = true;
+		Standbycommandreceived = true;
+		SendKeystroke(KEY_STANDBY);
+		break;
+	case REMOTE_AUTO:
+		SendKeystroke(KEY_AUTO);
+		break;
+	case REMOTE_AUTOWIND:
+		SendKeystroke(KEY_AUTOWIND);
+		break;
+	case REMOTE_TRACK:
+		if (Autopilot_Status == STANDBY)
+		{
+			Error = "not in auto";
+			return false;
+		}
+		SendKeystroke(KEY_TRACK);
+		break;
+	case REMOTE_COURSE:
+		if (Autopilot_Status != AUTO && Autopilot_Status != AUTOWIND)
+		{
+			Error = "not in auto";
+			return false;
+		}
+		AddCourseChange(Command.Change);
+		SendCourseChange();
+		break;
+	case REMOTE_HEADING:
+		if (!SteerTo(Command.Heading))
+		{
+			Error = "not in auto";
+			return false;
+		}
+		break;
+	case REMOTE_DODGE:
+		if (!Dodge(Command.Change, Command.Seconds))
+		{
+			Error = "not in auto";
+			return false;
+		}
+		break;
+	case REMOTE_RESUME:
+		if (!IsDodging())
+		{
+			Error = "no dodge";
+			return false;
+		}
+		if (!EndDodge())
+		{
+			Error = "not in auto";
+			return false;
+		}
+		break;
+	case REMOTE_SET:
+		if (IsApplyingProfile())
+		{
+			Error = "a profile is being applied";
+			return false;
+		}
+		if (!WriteParameter(Command.Parameter, Command.Value))
+		{
+			Error = "parameter not sent";
+			return false;
+		}
+		break;
+	default:
+		Error = "not a command";
+		return false;
+	}
+	NeedCompassCorrection = false;
+	if (WriteMessages) Message("Remote %s", RemoteCommand::MethodName(Command.Method));
+	return true;
+}
+
+std::string AutopilotCore::StateJSON() const
+{
+	static const char *Modes[] = { "unknown", "auto", "standby", "autowind", "track", "windshift", "autotrack", "offcourse" };
+	char Buffer[160];
+	std::string Json = "{\"bus\":\"" + STALKReceiveName + "\",\"mode\":\"";
+	Json += Autopilot_Status >= 0 && Autopilot_Status <= OFFCOURSE ? Modes[Autopilot_Status] : "unknown";
+	if (m_LastSampleValid)
+		snprintf(Buffer, sizeof(Buffer), "\",\"heading\":%d,\"locked_course\":%d,\"target_course\":%d,\"rudder\":%d,\"off_course\":%s",
+			m_LastSample.Heading, m_LastSample.LockedCourse, TargetCourse(), m_LastSample.Rudder, (m_LastSample.Flags & TELEMETRY_OFFCOURSE) ? "true" : "false");
+	else
+		snprintf(Buffer, sizeof(Buffer), "\",\"heading\":null,\"locked_course\":null,\"target_course\":null,\"rudder\":null,\"off_course\":false");
+	Json += Buffer;
+	if (m_DodgeCourse >= 0)
+	{
+		// The course to go back to and the seconds until then, null until "resume"
+		int64_t Remaining = m_DodgeUntil - m_pClock->NowMs();
+		snprintf(Buffer, sizeof(Buffer), ",\"dodge\":{\"course\":%d,\"change\":%d,\"seconds\":", m_DodgeCourse, m_DodgeOffset);
+		Json += Buffer;
+		Json += m_DodgeUntil != 0 ? IntToString(Remaining > 0 ? (int)((Remaining + 999) / 1000) : 0) : "null";
+		Json += "}";
+	}
+	else
+		Json += ",\"dodge\":null";
+	Json += ",\"parameters\":{";
+	bool First = true;
+	for (int i = 1; i < PARAMETER_COUNT; i++)
+	{
+		int Value;
+		if (!Parameters.Get(i, Value))
+			continue;
+		snprintf(Buffer, sizeof(Buffer), "%s\"%s\":%d", First ? "" : ",", ParameterTable::Get(i).Name, Value);
+		Json += Buffer;
+		First = false;
+	}
+	Json += "}}";
+	return Json;
+}
+
+// One step of the response level when the sea state asks for it, not while
+// the user or a profile changes something
+void AutopilotCore::AdaptResponse()
+{
+	if (!SeaState.Enabled)
+		return;
+	int Response = 0;
+	if (m_HeldChange != 0 || m_ProfileSent != 0 || !Parameters.Get(PARAMETER_RESPONSE, Response) ||
+		Parameters.Entry(PARAMETER_RESPONSE).Pending)
+		Response = 0;
+	int New = SeaState.Add(m_LastSample, Response);
+	if (New == 0)
+		return;
+	if (WriteMessages) Message("Sea state: heading error sd %.1f, rudder %.1f / sample, response %d -> %d",
+		SeaState.ChangeErrorSd, SeaState.ChangeRudderWork, Response, New);
+	WriteParameter(PARAMETER_RESPONSE, New);
+}
+
+// Only the 0x92, see WriteParameter()
+bool AutopilotCore::SendParameter(int Parameter, int Value)
+{
+	const ParameterInfo &Info = ParameterTable::Get(Parameter);
+	if (Info.Code == 0 || Value < Info.Min || Value > Info.Max)
+	{
+		if (WriteMessages) Message("Parameter %d value %d not sent", Parameter, Value);
+		return false;
+	}
+	char Buffer[32];
+	snprintf(Buffer, sizeof(Buffer), ",92,02,%02X,%02X,00", Info.Code, Value & 0xFF);
+	SendNMEASentence("$" + STALKSendName + Buffer);
+	Parameters.Written(Parameter, Value, m_pClock->NowMs());
+	return true;
+}
+
+int AutopilotCore::ApplyProfile(const SteeringProfile &Profile)
+{
+	int64_t Now = m_pClock->NowMs();
+	m_Profile = Profile;
+	m_ProfileSent = 0;
+	m_ProfileStart = Now;
+	int Sent = 0;
+	for (int i = 1; i < PARAMETER_COUNT; i++)
+	{
+		const ParameterEntry &e = Parameters.Entry(i);
+		if (Profile.Values[i] < 0)
+			continue;
+		// Already set and not too old, costs no bus time
+		if (e.Source != PARAMETER_NONE && !e.Pending && e.Value == Profile.Values[i] && !Parameters.IsStale(i, Now))
+			continue;
+		if (!SendParameter(i, Profile.Values[i]))
+			continue;
+		m_ProfileSent |= 1u << i;
+		Sent++;
+	}
+	// The display keys after all 0x92, each one confirms its value
+	for (int i = 1; i < PARAMETER_COUNT; i++)
+		if ((m_ProfileSent & (1u << i)) && ParameterTable::Get(i).DisplayKey)
+			SendNMEASentence(KeystrokeSentence(ParameterTable::Get(i).DisplayKey));
+	if (WriteMessages) Message("Profile %s: %d of %d values sent", Profile.Name.c_str(), Sent, Profile.Count());
+	if (m_ProfileSent == 0)
+	{
+		ShowStatus(Profile.Name);
+		ShowCompass("is set");
+		DisplayShow = 2;
+	}
+	else
+		CheckProfile();
+	return Sent;
+}
+
+// A 0x87 / 0x91 for the profile being applied
+bool AutopilotCore::ProfileReceived(int Parameter)
+{
+	if (!(m_ProfileSent & (1u << Parameter)))
+		return false;
+	CheckProfile();
+	return true;
+}
+
+// Done when no value of the profile waits for its confirmation any more
+void AutopilotCore::CheckProfile()
+{
+	if (m_ProfileSent == 0)
+		return;
+	int64_t Now = m_pClock->NowMs();
+	int Confirmed = 0, Written = 0, Failed = 0;
+	for (int i = 1; i < PARAMETER_COUNT; i++)
+	{
+		if (!(m_ProfileSent & (1u << i)))
+			continue;
+		const ParameterEntry &e = Parameters.Entry(i);
+		if (e.Pending)
+		{
+			if (Now - m_ProfileStart < Parameters.ConfirmMs)
+				return;
+			Failed++;
+		}
+		else if (e.Value != m_Profile.Values[i])
+			Failed++;
+		else if (e.Source == PARAMETER_WRITTEN)
+			Written++;	// cannot be confirmed
+		else
+			Confirmed++;
+	}
+	m_ProfileSent = 0;
+	char Text[32];
+	if (Failed)
+		snprintf(Text, sizeof(Text), "%d failed", Failed);
+	else
+		snprintf(Text, sizeof(Text), "is set");
+	ShowStatus(m_Profile.Name);
+	ShowCompass(Text);
+	if (Failed)
+	{
+		m_pSink->ShowAlarmColours();
+		m_NormalColoursShown = false;
+	}
+	else
+		ShowNormalColours();
+	DisplayShow = 2;
+	if (WriteMessages || Failed)
+		Message("Profile %s: %d confirmed, %d written, %d failed in %d ms", m_Profile.Name.c_str(),
+			Confirmed, Written, Failed, (int)(Now - m_ProfileStart));
+}
+
+// Nothing changes on the bus, only the display does not wait for the next 0x84.
+void AutopilotCore::Predict(int Key)
+{
+	int Change;
+	switch (Key)
+	{
+	case KEY_MINUS_1:	Change = -1; break;
+	case KEY_MINUS_10:	Change = -10; break;
+	case KEY_PLUS_1:	Change = 1; break;
+	case KEY_PLUS_10:	Change = 10; break;
+	case KEY_AUTO:
+	case KEY_STANDBY:
+	case KEY_TRACK:
+	case KEY_AUTOWIND:
+		m_TargetHeading = -1;
+		m_DodgeCourse = -1;
+		m_Predicted = false;	// a new mode has an own course
+		m_HeldChange = 0;
+		return;
+	default:
+		return;
+	}
+	m_TargetHeading = -1;
+	PredictChange(Change);
+}
+
+bool AutopilotCore::PredictChange(int Change)
+{
+	// Auto and Auto-Wind change the locked course with the keys
+	if (!m_LastSampleValid || !(m_LastSample.Flags & TELEMETRY_AUTO) || (m_LastSample.Flags & TELEMETRY_TRACK))
+		return false;
+	int Course = m_Predicted ? m_PredictedCourse : m_LastSample.LockedCourse;
+	m_PredictedCourse = ((Course + Change) % 360 + 360) % 360;
+	m_Predicted = true;
+	m_PredictedSince = m_pClock->NowMs();
+	if (DisplayShow == 0 && m_CompassKind == COMPASS_COURSE)
+		ShowCourse(m_LastStatus);
+	return true;
+}
+
+void AutopilotCore::AddCourseChange(int Change)
+{
+	m_TargetHeading = -1;
+	PredictChange(Change);
+	m_HeldChange += Change;
+}
+
+// Tens keys of +-10 and Ones keys of +-1 for Change, returns the number of keys.
+int AutopilotCore::CourseKeys(int Change, int &Tens, int &Ones)
+{
+	Tens = Change / 10;			// towards 0
+	Ones = Change - 10 * Tens;
+	if (Ones > 5)
+	{
+		Tens++;
+		Ones -= 10;
+	}
+	else if (Ones < -5)
+	{
+		Tens--;
+		Ones += 10;
+	}
+	return abs(Tens) + abs(Ones);
+}
+
+// The prediction is made, the keys only go to the bus (paced with an own connection).
+int AutopilotCore::SendCourseChange()
+{
+	int Tens, Ones;
+	int Keys = CourseKeys(m_HeldChange, Tens, Ones);
+	m_HeldChange = 0;
+	for (int i = 0; i < abs(Tens); i++)
+		SendNMEASentence(KeystrokeSentence(Tens > 0 ? KEY_PLUS_10 : KEY_MINUS_10));
+	for (int i = 0; i < abs(Ones); i++)
+		SendNMEASentence(KeystrokeSentence(Ones > 0 ? KEY_PLUS_1 : KEY_MINUS_1));
+	if (Keys > 0)
+		m_PredictedSince = m_pClock->NowMs();
+	return Keys;
+}
+
+// With the 0x84 just decoded, true if the prediction ended.
+bool AutopilotCore::SteerTo(int Heading)
+{
+	// Auto by the 0x84, also with the off course alarm
+	int Course = TargetCourse();
+	if (Course < 0 || !(m_LastSample.Flags & TELEMETRY_AUTO) || (m_LastSample.Flags & (TELEMETRY_VANE | TELEMETRY_TRACK)) ||
+		Heading < 0 || Heading > 359)
+		return false;
+	AddCourseChange(((Heading - Course) % 360 + 540) % 360 - 180);
+	int Keys = SendCourseChange();
+	m_TargetHeading = Heading;
+	m_TargetTries = 1;
+	m_TargetKeys = Keys;
+	if (WriteMessages) Message("Steer to %d from %d with %d keys", Heading, Course, Keys);
+	return true;
+}
+
+bool AutopilotCore::Dodge(int Offset, int Seconds)
+{
+	// The course before, also if a SteerTo() or a dodge is on the way
+	int Course = m_DodgeCourse >= 0 ? m_DodgeCourse : m_TargetHeading >= 0 ? m_TargetHeading : TargetCourse();
+	if (Offset == 0 || Seconds < 0 || Course < 0 || !SteerTo(((Course + Offset) % 360 + 360) % 360))
+		return false;
+	m_DodgeCourse = Course;
+	m_DodgeOffset = Offset;
+	m_DodgeUntil = Seconds > 0 ? m_pClock->NowMs() + Seconds * 1000LL : 0;
+	if (WriteMessages) Message(Seconds > 0 ? "Dodge %+d from %d for %d s" : "Dodge %+d from %d until resumed", Offset, Course, Seconds);
+	return true;
+}
+
+bool AutopilotCore::EndDodge()
+{
+	if (m_DodgeCourse < 0)
+		return false;
+	int Course = m_DodgeCourse;
+	m_DodgeCourse = -1;
+	bool Back = SteerTo(Course);
+	if (WriteMessages) Message(Back ? "Dodge ended, back to %d" : "Dodge ended, not in auto, %d not steered", Course);
+	return Back;
+}
+
+// In Poll(): the time of the dodge is over or the autopilot left auto
+void AutopilotCore::CheckDodge()
+{
+	if (m_DodgeCourse < 0)
+		return;
+	if (m_LastSampleValid && (!(m_LastSample.Flags & TELEMETRY_AUTO) || (m_LastSample.Flags & (TELEMETRY_VANE | TELEMETRY_TRACK))))
+	{
+		if (WriteMessages) Message("Dodge ended, not in auto, %d not steered", m_DodgeCourse);
+		m_DodgeCourse = -1;
+	}
+	else if (m_DodgeUntil != 0 && m_pClock->NowMs() >= m_DodgeUntil)
+		EndDodge();
+}
+
+int AutopilotCore::TargetCourse() const
+{
+	if (!m_LastSampleValid)
+		return -1;
+	return m_Predicted ? m_PredictedCourse : m_LastSample.LockedCourse;
+}
+
+// With every 0x84, after Reconcile(): the keys of SteerTo() are in the locked
+// course or have failed, what is still missing is planned again
+void AutopilotCore::CheckTarget()
+{
+	if (m_TargetHeading < 0 || m_Predicted || m_HeldChange != 0)
+		return;
+	int Heading = m_TargetHeading;
+	if (!(m_LastSample.Flags & TELEMETRY_AUTO) || (m_LastSample.Flags & (TELEMETRY_VANE | TELEMETRY_TRACK)))
+	{
+		m_TargetHeading = -1;
+		if (WriteMessages) Message("Steer to %d ended, not in auto", Heading);
+		return;
+	}
+	int Missing = ((Heading - m_LastSample.LockedCourse) % 360 + 540) % 360 - 180;
+	if (Missing == 0)
+	{
+		m_TargetHeading = -1;
+		if (WriteMessages) Message("Steer to %d: locked with %d keys in %d plans", Heading, m_TargetKeys, m_TargetTries);
+		return;
+	}
+	if (m_TargetTries >= TargetTries)
+	{
+		m_TargetHeading = -1;
+		if (WriteMessages) Message("Steer to %d failed, autopilot holds %d", Heading, (int)m_LastSample.LockedCourse);
+		return;
+	}
+	int Tries = m_TargetTries + 1, Keys = m_TargetKeys;
+	AddCourseChange(Missing);
+	Keys += SendCourseChange();
+	m_TargetHeading = Heading;
+	m_TargetTries = Tries;
+	m_TargetKeys = Keys;
+	if (WriteMessages) Message("Steer to %d: %d missing, planned again", Heading, Missing);
+}
+
+// With every 0x84: the change of Track, when the autopilot is in auto and
+// nothing else is on the way
+void AutopilotCore::FollowTrack()
+{
+	if (!Track.Enabled || m_Predicted || m_HeldChange != 0 || m_TargetHeading >= 0 || m_DodgeCourse >= 0 || m_ProfileSent != 0 ||
+		!(m_LastSample.Flags & TELEMETRY_AUTO) || (m_LastSample.Flags & (TELEMETRY_VANE | TELEMETRY_TRACK)))
+		return;
+	int Change = Track.Correction(m_pClock->NowMs());
+	if (Change == 0)
+		return;
+	AddCourseChange(Change);
+	int Keys = SendCourseChange();
+	if (WriteMessages) Message("Track to %s: XTE %.3f nm, course to make good %.0f, %+d with %d keys",
+		Track.Leg().c_str(), Track.CorrectionXte, Track.CorrectionCog, Change, Keys);
+}
+
+bool AutopilotCore::Reconcile()
+{
+	if (!m_Predicted || m_HeldChange != 0)
+		return false;
+	if ((m_LastSample.Flags & TELEMETRY_AUTO) && !(m_LastSample.Flags & TELEMETRY_TRACK))
+	{
+		if (m_LastSample.LockedCourse != m_PredictedCourse)
+		{
+			if (m_pClock->NowMs() - m_PredictedSince < CommandTimeout)
+				return false;	// on the way, the course computer takes a second
+			FailedCommands++;
+			if (WriteMessages) Message("Locked course %d expected, autopilot holds %d", m_PredictedCourse, (int)m_LastSample.LockedCourse);
+		}
+	}
+	m_Predicted = false;
+	m_Events++;
+	return true;
+}
+
+std::string AutopilotCore::ComputeChecksum(const std::string &sentence) const
+{
+	unsigned char calculated_checksum = 0;
+	for (std::string::const_iterator i = sentence.begin() + 1; i != sentence.end() && *i != '*'; ++i)
+		calculated_checksum ^= static_cast<unsigned char> (*i);
+
+	char Buffer[4];
+	snprintf(Buffer, sizeof(Buffer), "%02X", calculated_checksum);
+	return Buffer;
+}
+
+void AutopilotCore::NoDataReceived()
+{
+	// Keine Informationen vom Kurscomputer
+	if (WriteMessages) Info("No Data from Autopilot Computer");
+	m_Events++;
+	m_Predicted = false;
+	m_HeldChange = 0;
+	m_TargetHeading = -1;
+	m_DodgeCourse = -1;
+	Autopilot_Status = UNKNOWN;
+	ShowNormalColours();
+	ShowStatus("----------");
+	ShowCompass("---");
+	WayPointBearing = "unknown";
+	m_NextWaypointStart = -1;
+	IS_standby = 0;
+	Standbycommandreceived = true; // So when the Instruments are switched on again no Error !
+	CounterStandbySentencesReceived = 0;
+}
+
+void AutopilotCore::StartNoDataTimeout()
+{
+	m_TimeoutRunning = true;
+	m_TimeoutRepeat = false;
+	m_TimeoutStart = m_pClock->NowMs();
+}
+
+void AutopilotCore::StopNoDataTimeout()
+{
+	m_TimeoutRunning = false;
+}
+
+void AutopilotCore::Poll()
+{
+	CheckProfile();
+	CheckDodge();
+	// Stale parameters, one question at a time and not while a text is held
+	if (Autopilot_Status != UNKNOWN && DisplayShow == 0 && m_HeldChange == 0 && m_ProfileSent == 0)
+	{
+		int Parameter = Parameters.Ask(m_pClock->NowMs());
+		if (Parameter != 0)
+		{
+			if (WriteDebug) Info("Ask for parameter %d", Parameter);
+			SendKeystroke(ParameterTable::Get(Parameter).DisplayKey);
+		}
+	}
+	if (!m_TimeoutRunning || m_pClock->NowMs() - m_TimeoutStart < NoDataTimeout)
+		return;
+	if (m_TimeoutRepeat)
+		m_TimeoutStart += NoDataTimeout;
+	else
+		m_TimeoutRunning = false;
+	NoDataReceived();
+}
+
+void AutopilotCore::Message(const char *Format, ...)
+{
+	char Buffer[512];
+	va_list Args;
+	va_start(Args, Format);
+	vsnprintf(Buffer, sizeof(Buffer), Format, Args);
+	va_end(Args);
+	m_pSink->LogMessage(Buffer);
+}
+
+void AutopilotCore::Info(const char *Format, ...)
+{
+	char Buffer[512];
+	va_list Args;
+	va_start(Args, Format);
+	vsnprintf(Buffer, sizeof(Buffer), Format, Args);
+	va_end(Args);
+	m_pSink->LogInfo(Buffer);
+}
@@ -26,6 +26,7 @@
 
 #include "autopilotgui_impl.h"
 #include <wx/progdlg.h>
+#include <wx/numdlg.h>
 #include <wx/wx.h>
 #include "wx/dir.h"
 #include <list>
@@ -45,10 +46,10 @@ ParameterDialog::ParameterDialog(raymarine_autopilot_pi* p, wxWindow* parent, wx
 void ParameterDialog::OnStandbyCounterReset(wxCommandEvent& event)
 {
 	m_NoStandbyCounter->SetValue(wxString::Format(wxT("%i"), 0));
-	ptoPlugin->NoStandbyCounter = 0;
+	ptoPlugin->m_pCore->NoStandbyCounter = 0;
 	if(ptoPlugin->m_pDialog != NULL)
 		ptoPlugin->m_pDialog->SetBackgroundColour(wxColour(255,255,225));
-	ptoPlugin->Standbycommandreceived = TRUE;
+	ptoPlugin->m_pCore->Standbycommandreceived = TRUE;
 }
 
 void ParameterDialog::OnNewAuto(wxCommandEvent& event)
@@ -62,7 +63,7 @@ void ParameterDialog::OnNewAuto(wxCommandEvent& event)
 		m_ResetStandbyCounter->Enable(false);
 		m_SelectCounterStandby->Enable(false);
 		m_Text->Enable(false);
-		ptoPlugin->NewStandbyNoStandbyReceived = FALSE;
+		ptoPlugin->m_pCore->NewStandbyNoStandbyReceived = FALSE;
 	}
 	else
 	{
@@ -81,6 +82,33 @@ Dlg::Dlg( wxWindow* parent, double Skalefaktor, wxWindowID id, const wxString& t
     this->Fit();
 	SetToggel = 0;
     dbg=false; //for debug output set to true
+	TextStatus->Bind(wxEVT_ENTER_WINDOW, &Dlg::OnEnterDisplay, this);
+	TextCompass->Bind(wxEVT_ENTER_WINDOW, &Dlg::OnEnterDisplay, this);
+	TextStatus->Bind(wxEVT_RIGHT_DOWN, &Dlg::OnBusMenu, this);
+	TextCompass->Bind(wxEVT_RIGHT_DOWN, &Dlg::OnBusMenu, this);
+	TextCompass->Bind(wxEVT_LEFT_DCLICK, &Dlg::OnSteerTo, this);
+	// The parameters come from ParameterTable, 1 .. 9 of autopilotgui.cpp is the
+	// range of RudderGain, which is selected there
+	int Selected = ParameterChoise->GetSelection();
+	ParameterChoise->Clear();
+	for (int i = 0; i < PARAMETER_COUNT; i++)
+		ParameterChoise->Append(wxString::FromUTF8(ParameterTable::Get(i).Name));
+	ParameterChoise->SetSelection(Selected);
+	m_ValuesOf = PARAMETER_RUDDERGAIN;
+	m_HeldStep = 0;
+	m_HeldRepeats = 0;
+	m_HeldClick = false;
+	m_RepeatTimer.SetOwner(this);
+	Bind(wxEVT_TIMER, &Dlg::OnRepeatTimer, this, m_RepeatTimer.GetId());
+	wxButton *CourseButtons[] = { buttonDecOne, buttonDecTen, buttonIncTen, buttonIncOne };
+	for (size_t i = 0; i < sizeof(CourseButtons) / sizeof(CourseButtons[0]); i++)
+	{
+		CourseButtons[i]->Bind(wxEVT_LEFT_DOWN, &Dlg::OnCourseButtonDown, this);
+		CourseButtons[i]->Bind(wxEVT_LEFT_UP, &Dlg::OnCourseButtonUp, this);
+		CourseButtons[i]->Bind(wxEVT_LEAVE_WINDOW, &Dlg::OnCourseButtonUp, this);
+	}
+	buttonDecTen->Bind(wxEVT_RIGHT_DOWN, &Dlg::OnDodge, this);
+	buttonIncTen->Bind(wxEVT_RIGHT_DOWN, &Dlg::OnDodge, this);
 }
 
 void Dlg::SetStatusText(wxString Text)
@@ -89,7 +117,7 @@ void Dlg::SetStatusText(wxString Text)
 }
 void Dlg::SetCompassText(wxString Text)
 {
-	if (plugin->NoStandbyCounter != 0)
+	if (plugin->m_pCore->NoStandbyCounter != 0)
 	{
 		// No Standby Fehler ist aktiv
 		SetToggel++;
@@ -135,131 +163,296 @@ void Dlg::OnCloseApp(wxCloseEvent& event)
 	plugin->OnautopilotDialogClose();
 }
 
+// Steering statistics as tooltip, only made when the mouse comes.
+void Dlg::OnEnterDisplay(wxMouseEvent& event)
+{
+	const SteeringStatistics &Statistics = plugin->m_pCore->Statistics;
+	const wxString ModeNames[STEERING_MODES] = { _("Auto"), _("Auto-Wind"), _("Auto-Track") };
+	wxString Text;
+
+	for (int m = -1; m < STEERING_MODES; m++)
+	{
+		const SteeringStats &s = m < 0 ? Statistics.Leg() : Statistics.Mode(m);
+		if (s.HeadingError.Count == 0)
+			continue;
+		if (!Text.IsEmpty())
+			Text += _T("\n");
+		if (m < 0)
+			Text += _("Leg to ") + wxString::FromUTF8(Statistics.LegName().c_str());
+		else
+			Text += ModeNames[m];
+		Text += wxString::Format(_(": error %.1f sd %.1f, rudder %.0f, off course %.0f s, standby %i"),
+			s.HeadingError.Mean, s.HeadingError.StdDev(), s.RudderActivity, s.OffCourseMs / 1000.0, s.StandbyDrops);
+	}
+	if (Text.IsEmpty())
+		Text = _("No steering statistics yet");
+	TextStatus->SetToolTip(Text);
+	TextCompass->SetToolTip(Text);
+	event.Skip();
+}
+
 void Dlg::OnKlickInDisplay(wxMouseEvent& event)
 {
-	if(plugin->Autopilot_Status == UNKNOWN)
+	if(plugin->m_pCore->Autopilot_Status == UNKNOWN)
 		this->TextCompass->SetValue("---");
+	plugin->m_pCore->Redisplay();
 	SetBgTextCompassColor(wxColour(255, 255, 225));
 	SetBgTextStatusColor(wxColour(255, 255, 225));
 	TextStatus->Refresh();
 	TextCompass->Refresh();
-	plugin->NoStandbyCounter = 0;
-	plugin->Standbycommandreceived = TRUE;
-	plugin->NeedCompassCorrection = false;
+	plugin->m_pCore->NoStandbyCounter = 0;
+	plugin->m_pCore->Standbycommandreceived = TRUE;
+	plugin->m_pCore->NeedCompassCorrection = false;
+}
+
+// More than one bus: the right mouse button chooses the one to show and steer, or all
+void Dlg::OnBusMenu(wxMouseEvent& event)
+{
+	if (plugin->BusCount() < 2)
+	{
+		event.Skip();
+		return;
+	}
+	wxMenu Menu;
+	for (size_t i = 0; i < plugin->BusCount(); i++)
+		Menu.AppendRadioItem(AUTOPILOT_BUS_MENU + i, wxString::FromUTF8(plugin->Bus(i).Core.STALKReceiveName.c_str()))->Check(plugin->SelectedBus() == (int)i);
+	Menu.AppendRadioItem(AUTOPILOT_BUS_MENU + plugin->BusCount(), _("All"))->Check(plugin->SelectedBus() < 0);
+	int Id = GetPopupMenuSelectionFromUser(Menu);
+	if (Id == wxID_NONE)
+		return;
+	Id -= AUTOPILOT_BUS_MENU;
+	plugin->SelectBus(Id == (int)plugin->BusCount() ? -1 : Id);
+}
+
+// Double click on the compass in auto: steer to the heading typed in, with the fewest keys
+void Dlg::OnSteerTo(wxMouseEvent& event)
+{
+	AutopilotCore *pCore = plugin->m_pCore;
+	if (plugin->SelectedBus() < 0 || pCore->Autopilot_Status != AUTO || pCore->TargetCourse() < 0)
+	{
+		event.Skip();
+		return;
+	}
+	long Heading = wxGetNumberFromUser(_("The locked course is changed with the fewest keys."), _("Heading"),
+		_("Steer to"), pCore->TargetCourse(), 0, 359, this);
+	if (Heading < 0)
+		return;	// cancelled
+	pCore->NeedCompassCorrection = false;
+	if (!pCore->SteerTo((int)Heading))
+		wxMessageBox(_("Not in Auto"));
+}
+
+// Right click on -10/+10: DodgeChange that way for DodgeSeconds, then back.
+// While dodging the right click goes back at once.
+void Dlg::OnDodge(wxMouseEvent& event)
+{
+	AutopilotCore *pCore = plugin->m_pCore;
+	if (plugin->SelectedBus() < 0)
+		return;
+	pCore->NeedCompassCorrection = false;
+	if (pCore->IsDodging())
+		pCore->EndDodge();
+	else if (!pCore->Dodge(event.GetEventObject() == buttonDecTen ? -plugin->DodgeChange : plugin->DodgeChange, plugin->DodgeSeconds))
+		wxMessageBox(_("Not in Auto"));
+}
+
+// All buses are only shown, the buttons would not know which one to steer
+void Dlg::EnableCommands(bool Enable)
+{
+	wxButton *Buttons[] = { buttonAuto, buttonStandby, buttonAutoWind, buttonTrack,
+		buttonDecOne, buttonDecTen, buttonIncTen, buttonIncOne, buttonSet };
+	for (size_t i = 0; i < sizeof(Buttons) / sizeof(Buttons[0]); i++)
+		Buttons[i]->Enable(Enable);
 }
 
 void Dlg::OnAuto(wxCommandEvent& event)
 {
-	wxString sentence = "$" + plugin->STALKSendName + ",86,21,01,FE";
-	plugin->SendNMEASentence(sentence);
-	if (plugin->WriteMessages) wxLogMessage((" Pushed Auto %s"), sentence);
-	plugin->NeedCompassCorrection = false;
+	wxString sentence = plugin->m_pCore->KeystrokeSentence(KEY_AUTO);
+	plugin->m_pCore->SendKeystroke(KEY_AUTO); // a mode key ends a dodge or steer to
+	if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pushed Auto %s"), sentence);
+	plugin->m_pCore->NeedCompassCorrection = false;
 }
 
 void Dlg::OnAutoWind(wxCommandEvent& event)
 {
-	wxString sentence = "$" + plugin->STALKSendName + ",86,21,23,DC";
-	plugin->SendNMEASentence(sentence);
-	if (plugin->WriteMessages) wxLogMessage((" Pushed Autowind %s"), sentence);
-	plugin->NeedCompassCorrection = false;
+	wxString sentence = plugin->m_pCore->KeystrokeSentence(KEY_AUTOWIND);
+	plugin->m_pCore->SendKeystroke(KEY_AUTOWIND);
+	if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pushed Autowind %s"), sentence);
+	plugin->m_pCore->NeedCompassCorrection = false;
 }
 
 void Dlg::OnTrack(wxCommandEvent& event)
 {
-	if (plugin->Autopilot_Status == STANDBY)
+	if (plugin->m_pCore->Autopilot_Status == STANDBY)
 	{
-		plugin->DisplayShow = 1;
+		plugin->m_pCore->DisplayShow = 1;
 		this->TextStatus->SetForegroundColour(wxColour(255, 0, 0));
 		this->TextStatus->SetValue("Not in Auto");
+		plugin->m_pCore->Redisplay();	// the next status and the normal colours are shown again
 		return;
 	}
-	wxString sentence = "$" + plugin->STALKSendName + ",86,21,03,FC";
-	plugin->SendNMEASentence(sentence);
-	if (plugin->WriteMessages) wxLogMessage((" Pushed Track %s"), sentence);
-	plugin->NeedCompassCorrection = false;
+	wxString sentence = plugin->m_pCore->KeystrokeSentence(KEY_TRACK);
+	plugin->m_pCore->SendKeystroke(KEY_TRACK);
+	if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pushed Track %s"), sentence);
+	plugin->m_pCore->NeedCompassCorrection = false;
 }
 
 void Dlg::OnStandby(wxCommandEvent& event)
 {
 	wxString sentence;
-	plugin->StandbySelfPressed = TRUE;
-	plugin->Standbycommandreceived = TRUE;
-	plugin->NeedCompassCorrection = false;
+	plugin->m_pCore->StandbySelfPressed = TRUE;
+	plugin->m_pCore->Standbycommandreceived = TRUE;
+	plugin->m_pCore->NeedCompassCorrection = false;
 	// Das ist vermutlich Quatsch
-	/*if (plugin->Autopilot_Status == AUTOWIND || plugin->Autopilot_Status == AUTOTRACK)
+	/*if (plugin->m_pCore->Autopilot_Status == AUTOWIND || plugin->m_pCore->Autopilot_Status == AUTOTRACK)
 	{
 		// Muss erst nach AUTO gehen. sonst funktioniert es nicht.
-		sentence = "$" + plugin->STALKSendName + ",86,21,01,FE";
+		sentence = plugin->m_pCore->KeystrokeSentence(KEY_AUTO);
 		plugin->SendNMEASentence(sentence);
-		if (plugin->WriteMessages) wxLogMessage((" Pushed Standby in Autowind-Mode goto Auto %s"), sentence);
+		if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pushed Standby in Autowind-Mode goto Auto %s"), sentence);
 	}*/
-	sentence = "$" + plugin->STALKSendName + ",86,21,02,FD";
-	plugin->SendNMEASentence(sentence);
-	if (plugin->Autopilot_Status == STANDBY)
+	sentence = plugin->m_pCore->KeystrokeSentence(KEY_STANDBY);
+	plugin->m_pCore->SendKeystroke(KEY_STANDBY);
+	if (plugin->m_pCore->Autopilot_Status == STANDBY)
 	{
-		if (plugin->WriteMessages) wxLogMessage((" Pushed Standby in Standby-Mode %s"), sentence);
+		if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pushed Standby in Standby-Mode %s"), sentence);
 	}
 	else
 	{
-		if (plugin->WriteMessages) wxLogMessage((" Pushed Standby %s"), sentence);
+		if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pushed Standby %s"), sentence);
 	}
 }
 
 void Dlg::OnDecrementOne(wxCommandEvent& event)
 {
-	wxString sentence = "$" + plugin->STALKSendName + ",86,21,05,FA";
-	if (plugin->Autopilot_Status == AUTO ||
-		plugin->Autopilot_Status == AUTOWIND)
-		plugin->SendNMEASentence(sentence);
-	plugin->NeedCompassCorrection = false;
-	if (plugin->WriteMessages) wxLogMessage((" Pushed -1 %s"), sentence);
+	if (m_HeldClick)
+	{
+		m_HeldClick = false; // sent on the press, see OnCourseButtonDown()
+		return;
+	}
+	wxString sentence = plugin->m_pCore->KeystrokeSentence(KEY_MINUS_1);
+	if (plugin->m_pCore->Autopilot_Status == AUTO ||
+		plugin->m_pCore->Autopilot_Status == AUTOWIND)
+		plugin->m_pCore->SendKeystroke(KEY_MINUS_1); // shows the new locked course at once
+	plugin->m_pCore->NeedCompassCorrection = false;
+	if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pushed -1 %s"), sentence);
 }
 
 void Dlg::OnDecrementTen(wxCommandEvent& event)
 {
-	wxString sentence = "$" + plugin->STALKSendName + ",86,21,06,F9";
-	if (plugin->Autopilot_Status == AUTO ||
-		plugin->Autopilot_Status == AUTOWIND)
-		plugin->SendNMEASentence(sentence);
-	plugin->NeedCompassCorrection = false;
-	if (plugin->WriteMessages) wxLogMessage((" Pushed -10 %s"), sentence);
+	if (m_HeldClick)
+	{
+		m_HeldClick = false; // sent on the press, see OnCourseButtonDown()
+		return;
+	}
+	wxString sentence = plugin->m_pCore->KeystrokeSentence(KEY_MINUS_10);
+	if (plugin->m_pCore->Autopilot_Status == AUTO ||
+		plugin->m_pCore->Autopilot_Status == AUTOWIND)
+		plugin->m_pCore->SendKeystroke(KEY_MINUS_10); // shows the new locked course at once
+	plugin->m_pCore->NeedCompassCorrection = false;
+	if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pushed -10 %s"), sentence);
 }
 
 void Dlg::OnIncrementTen(wxCommandEvent& event)
 {
-	wxString sentence = "$" + plugin->STALKSendName + ",86,21,08,F7";
-	if (plugin->Autopilot_Status == AUTO ||
-		plugin->Autopilot_Status == AUTOWIND)
-		plugin->SendNMEASentence(sentence);
-	plugin->NeedCompassCorrection = false;
-	if (plugin->WriteMessages) wxLogMessage((" Pushed +10 %s"), sentence);
+	if (m_HeldClick)
+	{
+		m_HeldClick = false; // sent on the press, see OnCourseButtonDown()
+		return;
+	}
+	wxString sentence = plugin->m_pCore->KeystrokeSentence(KEY_PLUS_10);
+	if (plugin->m_pCore->Autopilot_Status == AUTO ||
+		plugin->m_pCore->Autopilot_Status == AUTOWIND)
+		plugin->m_pCore->SendKeystroke(KEY_PLUS_10); // shows the new locked course at once
+	plugin->m_pCore->NeedCompassCorrection = false;
+	if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pushed +10 %s"), sentence);
 }
 
 void Dlg::OnIncrementOne(wxCommandEvent& event)
 {
-	wxString sentence = "$" + plugin->STALKSendName + ",86,21,07,F8";
-	if (plugin->Autopilot_Status == AUTO ||
-		plugin->Autopilot_Status == AUTOWIND)
-		plugin->SendNMEASentence(sentence);
-	plugin->NeedCompassCorrection = false;
-	if (plugin->WriteMessages) wxLogMessage((" Pushed +1 %s"), sentence);
+	if (m_HeldClick)
+	{
+		m_HeldClick = false; // sent on the press, see OnCourseButtonDown()
+		return;
+	}
+	wxString sentence = plugin->m_pCore->KeystrokeSentence(KEY_PLUS_1);
+	if (plugin->m_pCore->Autopilot_Status == AUTO ||
+		plugin->m_pCore->Autopilot_Status == AUTOWIND)
+		plugin->m_pCore->SendKeystroke(KEY_PLUS_1); // shows the new locked course at once
+	plugin->m_pCore->NeedCompassCorrection = false;
+	if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pushed +1 %s"), sentence);
+}
+
+// Press and hold of +-1/+-10: one key at once, after AUTOPILOT_REPEAT_DELAY_MS
+// the button repeats. The display shows every repeat, the autopilot gets the
+// sum every AUTOPILOT_REPEAT_SEND_MS and at the release, with the fewest keys.
+void Dlg::OnCourseButtonDown(wxMouseEvent& event)
+{
+	event.Skip();
+	wxObject *pButton = event.GetEventObject();
+	if (plugin->m_pCore->Autopilot_Status != AUTO &&
+		plugin->m_pCore->Autopilot_Status != AUTOWIND)
+		return;
+	m_HeldStep = pButton == buttonDecOne ? -1 : pButton == buttonDecTen ? -10 : pButton == buttonIncTen ? 10 : 1;
+	m_HeldRepeats = 0;
+	m_HeldClick = true;
+	plugin->m_pCore->NeedCompassCorrection = false;
+	plugin->m_pCore->AddCourseChange(m_HeldStep);
+	plugin->m_pCore->SendCourseChange();
+	m_RepeatTimer.Start(AUTOPILOT_REPEAT_DELAY_MS, wxTIMER_ONE_SHOT);
+	if (plugin->m_pCore->WriteMessages) wxLogMessage((" Pressed %+d"), m_HeldStep);
+}
+
+void Dlg::OnCourseButtonUp(wxMouseEvent& event)
+{
+	event.Skip();
+	if (m_HeldStep == 0)
+		return;
+	m_RepeatTimer.Stop();
+	if (event.GetEventType() != wxEVT_LEFT_UP)
+		m_HeldClick = false; // released outside, no click comes
+	int Keys = plugin->m_pCore->SendCourseChange();
+	if (plugin->m_pCore->WriteMessages && m_HeldRepeats > 0)
+		wxLogMessage((" Released %+d after %d repeats, %d keys"), m_HeldStep, m_HeldRepeats, Keys);
+	m_HeldStep = 0;
+}
+
+void Dlg::OnRepeatTimer(wxTimerEvent& event)
+{
+	if (m_HeldStep == 0)
+		return;
+	if (plugin->m_pCore->Autopilot_Status != AUTO &&
+		plugin->m_pCore->Autopilot_Status != AUTOWIND)
+	{
+		m_RepeatTimer.Stop();
+		plugin->m_pCore->SendCourseChange();
+		m_HeldStep = 0;
+		return;
+	}
+	if (m_HeldRepeats == 0)
+		m_RepeatTimer.Start(AUTOPILOT_REPEAT_MS);
+	m_HeldRepeats++;
+	plugin->m_pCore->AddCourseChange(m_HeldStep);
+	if (m_HeldRepeats % (AUTOPILOT_REPEAT_SEND_MS / AUTOPILOT_REPEAT_MS) == 0)
+		plugin->m_pCore->SendCourseChange();
 }
 
 void Dlg::OnActiveApp(wxCommandEvent& event)
 {
 	this->TextStatus->SetValue("----");
+	plugin->m_pCore->Redisplay();
 }
 
 void Dlg::OnSetParameterValue(wxCommandEvent& event)
 {
 	int Value;
 
-	if (plugin->DisplayShow > 0)   // Es wurde gerade ein Parameter gesetzt.
+	if (plugin->m_pCore->DisplayShow > 0)   // Es wurde gerade ein Parameter gesetzt.
 	{
-		plugin->DisplayShow--;   // trotdem einen weniger !!
+		plugin->m_pCore->DisplayShow--;   // trotdem einen weniger !!
 		return;
 	}
-	if (0 >= (Value = this->ParameterValue->GetSelection()))
+	if (0 >= this->ParameterValue->GetSelection())
 	{
 		wxMessageBox(_("No Value selected"));
 		return;
@@ -269,60 +462,79 @@ void Dlg::OnSetParameterValue(wxCommandEvent& event)
 		wxMessageBox(_("No Parameter selected"));
 		return;
 	}
-	wxString i = _("is set to  "), Sentence;
+	wxString i = _("is set to  ");
 
 	this->TextStatus->SetValue(this->ParameterChoise->GetString(this->ParameterChoise->GetSelection()));
 	i = i + this->ParameterValue->GetString(this->ParameterValue->GetSelection());
 	this->TextCompass->SetValue(i);
 	this->TextCompass->SetForegroundColour(wxColour(255, 0, 0));
 	this->TextStatus->SetForegroundColour(wxColour(255, 0, 0));
+	plugin->m_pCore->Redisplay();	// written here, past the core
 
-	switch (this->ParameterChoise->GetSelection())
+	// A profile after the parameters, all its values in one batch
+	if (this->ParameterChoise->GetSelection() >= PARAMETER_COUNT)
 	{
-	case	1:	// Response
-		Sentence = "$" + plugin->STALKSendName + ",92,02,12,0" + wxString::Format(wxT("%i"), Value) + ",00";
-		plugin->SendNMEASentence(Sentence);
-		// Anzeige auf ST6002 Display fr 5 Sekunden
-		Sentence = "$" + plugin->STALKSendName + ",86,21,2E,D1";
-		plugin->SendNMEASentence(Sentence);
-		break;
-	case	2:	// WindTrim
-		Sentence = "$" + plugin->STALKSendName + ",92,02,11,0" + wxString::Format(wxT("%i"), Value) + ",00";
-		plugin->SendNMEASentence(Sentence);
-		break;
-	case	3:  // Ruddergain
-		Sentence = "$" + plugin->STALKSendName + ",92,02,01,0" + wxString::Format(wxT("%i"), Value) + ",00";
-		plugin->SendNMEASentence(Sentence);
-		// Anzeige auf ST6002 Display fr 5 Sekunden
-		Sentence = "$" + plugin->STALKSendName + ",86,21,6E,91";
-		plugin->SendNMEASentence(Sentence);
-		break;
+		this->TextCompass->SetValue(_("is sent"));
+		plugin->m_pCore->ApplyProfile(plugin->Profiles[this->ParameterChoise->GetSelection() - PARAMETER_COUNT]);
+		return;
 	}
+	// 0x92, Response and Ruddergain are confirmed by the 0x87 / 0x91 of the display key
+	Value = ParameterTable::Get(this->ParameterChoise->GetSelection()).Min + this->ParameterValue->GetSelection() - 1;
+	plugin->m_pCore->WriteParameter(this->ParameterChoise->GetSelection(), Value);
 }
 
 void Dlg::OnSelectParameter(wxCommandEvent& event)
 {
-	wxString Sentence;
+	int Parameter = this->ParameterChoise->GetSelection(), Value;
+	const ParameterInfo &Info = ParameterTable::Get(Parameter);
+	if (Parameter >= PARAMETER_COUNT)
+	{
+		// A profile, "Set" applies it
+		m_ValuesOf = -1;
+		this->ParameterValue->Clear();
+		this->ParameterValue->Append(_T("-"));
+		this->ParameterValue->Append(_T(">"));
+		this->ParameterValue->SetSelection(1);
+		return;
+	}
+	// Known and not too old: from the cache, nothing is sent
+	if (Parameter > 0 && plugin->m_pCore->Parameters.Get(Parameter, Value) &&
+		!plugin->m_pCore->Parameters.IsStale(Parameter, plugin->m_pCore->NowMs()))
+	{
+		SetParameter(Parameter, Value);
+		return;
+	}
 	// Set To DefaultValue because the aktive is not konwn.
-	switch (this->ParameterChoise->GetSelection())
+	SetParameter(Parameter, Info.Default);
+	if (Info.DisplayKey)
 	{
-	case	0:
-		this->ParameterValue->SetSelection(0);
-		break;
-	case	1:	// Response
-		// old : this->ParameterValue->SetSelection(plugin->ResponseLevel);
-		// Anzeige auf ST6002 Display fr 5 Sekunden
-		Sentence = "$" + plugin->STALKSendName + ",86,21,2E,D1"; // (Response Display)
-		plugin->SendNMEASentence(Sentence);
-		break;
-	case	2:	// WindTrim
-		this->ParameterValue->SetSelection(5);
-		break;
-	case	3:  // Ruddergain
-		// old : this->ParameterValue->SetSelection(2);
-		// Anzeige auf ST6002 Display fr 5 Sekunden
-		Sentence = "$" + plugin->STALKSendName + ",86,21,6E,91"; // (Rudder Gain Display)
-		plugin->SendNMEASentence(Sentence);
-		break;
+		// Anzeige auf ST6002 Display fr 5 Sekunden, the 0x87 / 0x91 sets the value
+		plugin->m_pCore->SendKeystroke(Info.DisplayKey);
 	}
 }
+
+// The values of Parameter in ParameterValue, "-" and Min .. Max
+void Dlg::SetParameter(int Parameter, int Value)
+{
+	const ParameterInfo &Info = ParameterTable::Get(Parameter);
+	if (Parameter != m_ValuesOf)
+	{
+		m_ValuesOf = Parameter;
+		this->ParameterValue->Clear();
+		this->ParameterValue->Append(_T("-"));
+		for (int i = Info.Min; Parameter > 0 && i <= Info.Max; i++)
+			this->ParameterValue->Append(wxString::Format(wxT("%i"), i));
+	}
+	this->ParameterChoise->SetSelection(Parameter);
+	if (Parameter > 0 && Value >= Info.Min && Value <= Info.Max)
+		this->ParameterValue->SetSelection(Value - Info.Min + 1);
+	else
+		this->ParameterValue->SetSelection(0);
+}
+
+// The steering profiles of the config after the parameters
+void Dlg::ShowProfiles()
+{
+	for (size_t i = 0; i < plugin->Profiles.size(); i++)
+		ParameterChoise->Append(wxString::FromUTF8(plugin->Profiles[i].Name.c_str()));
+}
@@ -0,0 +1,512 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "controlserver.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0
+#endif
+
+#define MAX_REQUEST		1024		// longer lines are thrown away
+#define MAX_OUT			65536		// a client with more replies waiting is closed
+#define STATE_PREFIX	"{\"jsonrpc\":\"2.0\",\"method\":\"state\",\"params\":"
+
+ControlServer::ControlServer()
+	: Requests(0), RateLimited(0), m_Stop(false), m_NotifyPending(false)
+{
+	RatePerSecond = 2;
+	Burst = 5;
+	HoldMs = 10000;
+	MaxClients = 8;
+	Refused = 0;
+	m_fd = -1;
+	m_Wake[0] = m_Wake[1] = -1;
+	m_NextId = 1;
+	m_Owner = -1;
+	m_OwnerTime = 0;
+}
+
+ControlServer::~ControlServer()
+{
+	Close();
+}
+
+static std::string Field(const std::string &Spec, size_t Index)
+{
+	size_t First = 0;
+	for (size_t i = 0; i < Index; i++)
+	{
+		First = Spec.find(':', First);
+		if (First == std::string::npos)
+			return std::string();
+		First++;
+	}
+	size_t End = Spec.find(':', First);
+	return Spec.substr(First, End == std::string::npos ? std::string::npos : End - First);
+}
+
+bool ControlServer::Receive(int &Client, RemoteCommand &Command)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (m_Requests.empty())
+	{
+		m_NotifyPending = false;	// the I/O thread pushes with the lock held
+		return false;
+	}
+	Client = m_Requests.front().Client;
+	Command = m_Requests.front().Command;
+	m_Requests.pop_front();
+	return true;
+}
+
+bool ControlServer::Arbitrate(int Client, const RemoteCommand &Command, int64_t Now)
+{
+	if (Command.Method == REMOTE_STANDBY)
+	{
+		m_Owner = -1;
+		return true;
+	}
+	if (m_Owner >= 0 && m_Owner != Client && Now - m_OwnerTime < HoldMs)
+	{
+		Refused++;
+		return false;
+	}
+	m_Owner = Client;
+	m_OwnerTime = Now;
+	return true;
+}
+
+#ifdef _WIN32
+
+bool ControlServer::Open(const std::string &)
+{
+	m_Error = "control socket is not available on Windows";
+	return false;
+}
+
+void ControlServer::Close()
+{
+}
+
+void ControlServer::Reply(int, const std::string &)
+{
+}
+
+void ControlServer::Publish(const std::string &)
+{
+}
+
+#else
+
+bool ControlServer::Open(const std::string &Spec)
+{
+	Close();
+	m_Error.clear();
+	std::string Type = Field(Spec, 0);
+	if (Type == "unix")
+		m_fd = OpenUnix(Spec.substr(5));
+	else if (Type == "tcp")
+	{
+		std::string Port = Field(Spec, 2);
+		m_fd = Port.empty() ? OpenTcp("127.0.0.1", Field(Spec, 1)) : OpenTcp(Field(Spec, 1), Port);
+	}
+	else
+		m_Error = "unknown control socket type " + Type;
+	if (m_fd < 0)
+		return false;
+
+	if (pipe(m_Wake) != 0)
+	{
+		m_Error = strerror(errno);
+		Close();
+		return false;
+	}
+	fcntl(m_Wake[0], F_SETFL, O_NONBLOCK);
+	fcntl(m_Wake[1], F_SETFL, O_NONBLOCK);
+	m_Stop = false;
+	m_NotifyPending = false;
+	m_Owner = -1;
+	m_Thread = std::thread(&ControlServer::Run, this);
+	return true;
+}
+
+void ControlServer::Close()
+{
+	if (m_Thread.joinable())
+	{
+		m_Stop = true;
+		Wake();
+		m_Thread.join();
+	}
+	for (size_t i = 0; i < m_Clients.size(); i++)
+		close(m_Clients[i].fd);
+	m_Clients.clear();
+	if (m_fd >= 0)
+		close(m_fd);
+	if (!m_Path.empty())
+		unlink(m_Path.c_str());
+	if (m_Wake[0] >= 0)
+		close(m_Wake[0]);
+	if (m_Wake[1] >= 0)
+		close(m_Wake[1]);
+	m_fd = -1;
+	m_Wake[0] = m_Wake[1] = -1;
+	m_Path.clear();
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	m_Requests.clear();
+	m_Replies.clear();
+}
+
+void ControlServer::Wake()
+{
+	char c = 0;
+	if (m_Wake[1] >= 0 && write(m_Wake[1], &c, 1) < 0)
+	{
+		// pipe full, the I/O thread is awake already
+	}
+}
+
+void ControlServer::Reply(int Client, const std::string &Line)
+{
+	if (m_fd < 0)
+		return;
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Replies.push_back(std::make_pair(Client, Line));
+	}
+	Wake();
+}
+
+void ControlServer::Publish(const std::string &State)
+{
+	if (m_fd < 0 || State == m_State)
+		return;
+	m_State = State;
+	std::shared_ptr<const std::string> Snapshot = std::make_shared<const std::string>(STATE_PREFIX + State + "}\n");
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Snapshot.swap(Snapshot);
+	}
+	Wake();
+}
+
+int ControlServer::OpenUnix(const std::string &Path)
+{
+	struct sockaddr_un Address;
+	memset(&Address, 0, sizeof(Address));
+	Address.sun_family = AF_UNIX;
+	if (Path.empty() || Path.length() >= sizeof(Address.sun_path))
+	{
+		m_Error = "unix:" + Path + ": path empty or too long";
+		return -1;
+	}
+	strncpy(Address.sun_path, Path.c_str(), sizeof(Address.sun_path) - 1);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		m_Error = strerror(errno);
+		return -1;
+	}
+	unlink(Path.c_str());	// left over from a crash
+	if (bind(fd, (struct sockaddr *)&Address, sizeof(Address)) != 0 || listen(fd, 4) != 0)
+	{
+		m_Error = Path + ": " + strerror(errno);
+		close(fd);
+		return -1;
+	}
+	m_Path = Path;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+int ControlServer::OpenTcp(const std::string &Host, const std::string &Port)
+{
+	struct addrinfo Hints, *pResult = NULL;
+	memset(&Hints, 0, sizeof(Hints));
+	Hints.ai_family = AF_UNSPEC;
+	Hints.ai_socktype = SOCK_STREAM;
+	Hints.ai_flags = AI_PASSIVE;
+	int Result = getaddrinfo(Host.c_str(), Port.c_str(), &Hints, &pResult);
+	if (Result != 0 || pResult == NULL)
+	{
+		m_Error = Host + ":" + Port + ": " + gai_strerror(Result);
+		return -1;
+	}
+	int fd = socket(pResult->ai_family, pResult->ai_socktype, pResult->ai_protocol);
+	if (fd < 0)
+	{
+		m_Error = strerror(errno);
+		freeaddrinfo(pResult);
+		return -1;
+	}
+	int One = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &One, sizeof(One));
+	bool Ok = bind(fd, pResult->ai_addr, pResult->ai_addrlen) == 0 && listen(fd, 4) == 0;
+	freeaddrinfo(pResult);
+	if (!Ok)
+	{
+		m_Error = Host + ":" + Port + ": " + strerror(errno);
+		close(fd);
+		return -1;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+void ControlServer::Run()
+{
+	std::vector<struct pollfd> Fds;
+	std::shared_ptr<const std::string> Latest;
+	while (!m_Stop)
+	{
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			Latest = m_Snapshot;
+			for (size_t r = 0; r < m_Replies.size(); r++)
+				for (size_t i = 0; i < m_Clients.size(); i++)
+					if (m_Clients[i].Id == m_Replies[r].first)
+						m_Clients[i].Out += m_Replies[r].second;
+			m_Replies.clear();
+		}
+		// Write what can go out now, then wait for the rest
+		for (size_t i = 0; i < m_Clients.size(); )
+		{
+			ClientState &c = m_Clients[i];
+			if (c.Subscribed && Latest && c.Snapshot != Latest && c.Out.empty()
+				&& (!c.Snapshot || c.SnapshotSent == c.Snapshot->length()))
+			{
+				c.Snapshot = Latest;
+				c.SnapshotSent = 0;
+			}
+			if (!Write(c))
+			{
+				close(c.fd);
+				m_Clients.erase(m_Clients.begin() + i);
+			}
+			else
+				i++;
+		}
+
+		Fds.resize(2 + m_Clients.size());
+		Fds[0].fd = m_fd;
+		Fds[0].events = POLLIN;
+		Fds[1].fd = m_Wake[0];
+		Fds[1].events = POLLIN;
+		for (size_t i = 0; i < m_Clients.size(); i++)
+		{
+			const ClientState &c = m_Clients[i];
+			Fds[2 + i].fd = c.fd;
+			Fds[2 + i].events = POLLIN;
+			if (!c.Out.empty() || (c.Snapshot && c.SnapshotSent < c.Snapshot->length()))
+				Fds[2 + i].events |= POLLOUT;
+		}
+		for (size_t i = 0; i < Fds.size(); i++)
+			Fds[i].revents = 0;
+		int Result = poll(&Fds[0], Fds.size(), -1);
+		if (Result < 0 && errno != EINTR)
+			break;
+		if (Fds[1].revents & POLLIN)
+		{
+			char Buffer[64];
+			while (read(m_Wake[0], Buffer, sizeof(Buffer)) > 0)
+				;
+		}
+		// Backwards, a closed client is removed from the vector
+		for (size_t i = m_Clients.size(); i-- > 0; )
+		{
+			if (!(Fds[2 + i].revents & (POLLIN | POLLERR | POLLHUP)))
+				continue;
+			if (!Read(m_Clients[i]))
+			{
+				close(m_Clients[i].fd);
+				m_Clients.erase(m_Clients.begin() + i);
+			}
+		}
+		if (Fds[0].revents & POLLIN)
+			Accept();
+	}
+}
+
+void ControlServer::Accept()
+{
+	int fd = accept(m_fd, NULL, NULL);
+	if (fd < 0)
+		return;
+	if (m_Clients.size() >= MaxClients)
+	{
+		close(fd);
+		return;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	ClientState c;
+	c.fd = fd;
+	c.Id = m_NextId++;
+	c.SnapshotSent = 0;
+	c.Subscribed = false;
+	c.Tokens = Burst;
+	c.TokenTime = m_Clock.NowMs();
+	m_Clients.push_back(c);
+}
+
+bool ControlServer::Read(ClientState &c)
+{
+	char Buffer[1024];
+	ssize_t Count = recv(c.fd, Buffer, sizeof(Buffer), 0);
+	if (Count <= 0)
+		return Count < 0 && (errno == EAGAIN || errno == EINTR);
+	for (ssize_t i = 0; i < Count; i++)
+	{
+		char ch = Buffer[i];
+		if (ch == '\n')
+		{
+			if (c.In.length() <= MAX_REQUEST)
+				Handle(c, c.In);
+			c.In.clear();
+		}
+		else if (c.In.length() <= MAX_REQUEST)
+			c.In += ch;
+	}
+	return c.Out.length() < MAX_OUT;
+}
+
+void ControlServer::Handle(ClientState &c, const std::string &Line)
+{
+	size_t First = Line.find_first_not_of(" \t\r");
+	if (First == std::string::npos)
+		return;
+	Requests++;
+	RemoteCommand Command;
+	bool Ok = Command.Parse(Line.c_str() + First, Line.length() - First);
+	// A notification (no id) is not answered, only a line that is no JSON
+	// at all or has an invalid id gets the error with "id":null
+	bool Answer = !Command.Id.empty() || (!Ok && (Command.ErrorCode == REMOTE_PARSE_ERROR || Command.ErrorCode == REMOTE_INVALID_REQUEST));
+	if (!Ok)
+	{
+		if (Answer)
+			c.Out += Command.Reply(Command.ErrorCode, Command.Error);
+		return;
+	}
+	switch (Command.Method)
+	{
+		case REMOTE_SUBSCRIBE:
+			c.Subscribed = true;	// the last snapshot follows
+			if (Answer)
+				c.Out += Command.Reply();
+			return;
+		case REMOTE_UNSUBSCRIBE:
+			c.Subscribed = false;
+			if (Answer)
+				c.Out += Command.Reply();
+			return;
+		case REMOTE_STATE:
+		{
+			if (!Answer)
+				return;
+			std::shared_ptr<const std::string> Snapshot;
+			{
+				std::lock_guard<std::mutex> Lock(m_Mutex);
+				Snapshot = m_Snapshot;
+			}
+			size_t Prefix = sizeof(STATE_PREFIX) - 1;
+			c.Out += "{\"jsonrpc\":\"2.0\",\"id\":" + Command.Id + ",\"result\":";
+			if (Snapshot)
+				c.Out.append(*Snapshot, Prefix, Snapshot->length() - Prefix - 2);	// without "}\n"
+			else
+				c.Out += "null";
+			c.Out += "}\n";
+			return;
+		}
+	}
+	if (!Admit(c))
+	{
+		RateLimited++;
+		if (Answer)
+			c.Out += Command.Reply(REMOTE_REFUSED, "rate limit");
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Requests.push_back(Request());
+		m_Requests.back().Client = c.Id;
+		m_Requests.back().Command = Command;
+	}
+	if (!m_NotifyPending.exchange(true) && m_Notify)
+		m_Notify();
+}
+
+// Token bucket: RatePerSecond, up to Burst at once
+bool ControlServer::Admit(ClientState &c)
+{
+	int64_t Now = m_Clock.NowMs();
+	c.Tokens += (Now - c.TokenTime) * RatePerSecond / 1000.0;
+	if (c.Tokens > Burst)
+		c.Tokens = Burst;
+	c.TokenTime = Now;
+	if (c.Tokens < 1)
+		return false;
+	c.Tokens -= 1;
+	return true;
+}
+
+bool ControlServer::Write(ClientState &c)
+{
+	for (;;)
+	{
+		const char *pData;
+		size_t Length;
+		bool Snapshot = c.Snapshot && c.SnapshotSent < c.Snapshot->length();
+		if (Snapshot)
+		{
+			pData = c.Snapshot->data() + c.SnapshotSent;
+			Length = c.Snapshot->length() - c.SnapshotSent;
+		}
+		else if (!c.Out.empty())
+		{
+			pData = c.Out.data();
+			Length = c.Out.length();
+		}
+		else
+			return true;
+		ssize_t Count = send(c.fd, pData, Length, MSG_NOSIGNAL);
+		if (Count < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		if (Snapshot)
+			c.SnapshotSent += Count;
+		else
+			c.Out.erase(0, Count);
+	}
+}
+
+#endif
@@ -0,0 +1,59 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "headingtext.h"
+
+#include <stdio.h>
+
+struct HeadingTable
+{
+	char	Degrees[360][4];
+	char	Difference[361][5];
+
+	HeadingTable()
+	{
+		for (int i = 0; i < 360; i++)
+			snprintf(Degrees[i], sizeof(Degrees[i]), "%i", i);
+		for (int i = 0; i <= 360; i++)
+			snprintf(Difference[i], sizeof(Difference[i]), "%i", i - 180);
+	}
+};
+
+static const HeadingTable &GetTable()
+{
+	static const HeadingTable s_Table;
+	return s_Table;
+}
+
+const char *HeadingText::Degrees(int Value)
+{
+	if (Value < 0 || Value >= 360)
+		return "---";
+	return GetTable().Degrees[Value];
+}
+
+const char *HeadingText::Difference(int Value)
+{
+	if (Value < -180 || Value > 180)
+		return "-";
+	return GetTable().Difference[Value + 180];
+}
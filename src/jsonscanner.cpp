@@ -0,0 +1,192 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "jsonscanner.h"
+
+#include <stdlib.h>
+
+static int HexDigit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+static bool IsNumberChar(char c)
+{
+	return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+void JsonScanner::Space()
+{
+	while (p < End && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+		p++;
+}
+
+bool JsonScanner::Peek(char c)
+{
+	Space();
+	return p < End && *p == c;
+}
+
+bool JsonScanner::Expect(char c)
+{
+	if (!Peek(c))
+		return false;
+	p++;
+	return true;
+}
+
+bool JsonScanner::AtEnd()
+{
+	Space();
+	return p >= End;
+}
+
+bool JsonScanner::String(std::string *Text)
+{
+	if (!Expect('"'))
+		return false;
+	if (Text)
+		Text->clear();
+	while (p < End && *p != '"')
+	{
+		char c = *p++;
+		if (c == '\\')
+		{
+			if (p >= End)
+				return false;
+			c = *p++;
+			if (c == 'n')
+				c = '\n';
+			else if (c == 't')
+				c = '\t';
+			else if (c == 'r')
+				c = '\r';
+			else if (c == 'b')
+				c = '\b';
+			else if (c == 'f')
+				c = '\f';
+			else if (c == 'u')
+			{
+				int Code = 0;
+				for (int i = 0; i < 4; i++)
+				{
+					int Digit = p < End ? HexDigit(*p++) : -1;
+					if (Digit < 0)
+						return false;
+					Code = Code * 16 + Digit;
+				}
+				c = Code < 0x80 ? (char)Code : '?';
+			}
+		}
+		if (Text)
+			*Text += c;
+	}
+	return Expect('"');
+}
+
+bool JsonScanner::Integer(int &Value)
+{
+	Space();
+	bool Negative = p < End && *p == '-';
+	if (Negative)
+		p++;
+	if (p >= End || *p < '0' || *p > '9')
+		return false;
+	long Result = 0;
+	while (p < End && *p >= '0' && *p <= '9')
+	{
+		if (Result < 100000000)
+			Result = Result * 10 + (*p - '0');
+		p++;
+	}
+	while (p < End && IsNumberChar(*p))
+		p++;
+	Value = (int)(Negative ? -Result : Result);
+	return true;
+}
+
+bool JsonScanner::Number(double &Value)
+{
+	Space();
+	// The text need not end with 0, strtod() gets a copy
+	char Buffer[32];
+	size_t Length = 0;
+	while (p + Length < End && Length < sizeof(Buffer) - 1 && IsNumberChar(p[Length]))
+	{
+		Buffer[Length] = p[Length];
+		Length++;
+	}
+	Buffer[Length] = 0;
+	char *pEnd;
+	Value = strtod(Buffer, &pEnd);
+	if (Length == 0 || pEnd == Buffer)
+		return false;
+	p += pEnd - Buffer;
+	return true;
+}
+
+bool JsonScanner::Skip(std::string *Text)
+{
+	Space();
+	const char *First = p;
+	if (p < End && *p == '"')
+	{
+		if (!String(NULL))
+			return false;
+	}
+	else if (p < End && (*p == '{' || *p == '['))
+	{
+		int Depth = 0;
+		do
+		{
+			if (*p == '"')
+			{
+				if (!String(NULL))
+					return false;
+				continue;
+			}
+			if (*p == '{' || *p == '[')
+				Depth++;
+			else if (*p == '}' || *p == ']')
+				Depth--;
+			p++;
+		} while (p < End && Depth > 0);
+		if (Depth != 0)
+			return false;
+	}
+	else
+	{
+		while (p < End && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+			p++;
+		if (p == First)
+			return false;
+	}
+	if (Text)
+		Text->assign(First, p - First);
+	return true;
+}
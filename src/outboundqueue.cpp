@@ -0,0 +1,77 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl.Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "outboundqueue.h"
+
+OutboundQueue::OutboundQueue()
+{
+	BytesPerSecond = 480;	// NMEA 4800 Baud
+	MinGapMs = 50;
+	MaxSize = 64;
+	Dropped = 0;
+	m_NextSend = 0;
+}
+
+bool OutboundQueue::Push(const std::string &sentence)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (m_Queue.size() >= MaxSize)
+	{
+		Dropped++;
+		return false;
+	}
+	m_Queue.push_back(sentence);
+	return true;
+}
+
+bool OutboundQueue::Pop(int64_t Now, std::string &sentence, int64_t &Wait)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (m_Queue.empty())
+	{
+		Wait = -1;
+		return false;
+	}
+	if (Now < m_NextSend)
+	{
+		Wait = m_NextSend - Now;
+		return false;
+	}
+	sentence.swap(m_Queue.front());
+	m_Queue.pop_front();
+	int64_t Busy = BytesPerSecond > 0 ? (int64_t)sentence.length() * 1000 / BytesPerSecond : 0;
+	m_NextSend = Now + Busy + MinGapMs;
+	Wait = m_Queue.empty() ? -1 : m_NextSend - Now;
+	return true;
+}
+
+size_t OutboundQueue::Size() const
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	return m_Queue.size();
+}
+
+void OutboundQueue::Clear()
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	m_Queue.clear();
+}
@@ -0,0 +1,139 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "parametercache.h"
+
+ParameterCache::ParameterCache()
+{
+	MaxAgeMs = 0;			// opt-in, every question shows the parameter on the displays
+	ConfirmMs = 3000;
+	RetryMs = 60000;
+	Questions = 0;
+	Confirmed = 0;
+	WriteFailures = 0;
+	m_Asking = 0;
+	for (int i = 0; i < PARAMETER_COUNT; i++)
+	{
+		m_Entries[i].Value = 0;
+		m_Entries[i].Source = PARAMETER_NONE;
+		m_Entries[i].Time = 0;
+		m_Entries[i].Pending = false;
+		m_Entries[i].PendingValue = 0;
+		m_Entries[i].PendingTime = 0;
+		m_Entries[i].AskedTime = 0;
+	}
+}
+
+bool ParameterCache::Get(int Parameter, int &Value) const
+{
+	if (Parameter <= 0 || Parameter >= PARAMETER_COUNT || m_Entries[Parameter].Source == PARAMETER_NONE)
+		return false;
+	Value = m_Entries[Parameter].Value;
+	return true;
+}
+
+bool ParameterCache::CanAsk(int Parameter)
+{
+	return ParameterTable::Get(Parameter).DisplayKey != 0;
+}
+
+bool ParameterCache::IsStale(int Parameter, int64_t Now) const
+{
+	const ParameterEntry &e = m_Entries[Parameter];
+	if (!CanAsk(Parameter))
+		return e.Source == PARAMETER_NONE;	// cannot be newer
+	return e.Source == PARAMETER_NONE || (MaxAgeMs > 0 && Now - e.Time >= MaxAgeMs);
+}
+
+bool ParameterCache::Received(int Parameter, int Value, int64_t Now)
+{
+	ParameterEntry &e = m_Entries[Parameter];
+	e.Source = PARAMETER_BUS;
+	if (e.Pending)
+	{
+		if (Value == e.PendingValue)
+		{
+			Confirmed++;
+			e.Source = PARAMETER_CONFIRMED;
+		}
+		else
+			WriteFailures++;
+		e.Pending = false;
+	}
+	e.Value = Value;
+	e.Time = Now;
+	bool Answer = m_Asking == Parameter;
+	if (Answer)
+		m_Asking = 0;
+	return Answer;
+}
+
+void ParameterCache::Written(int Parameter, int Value, int64_t Now)
+{
+	ParameterEntry &e = m_Entries[Parameter];
+	if (e.Pending)
+		WriteFailures++;	// the last one was not confirmed
+	if (!CanAsk(Parameter))
+	{
+		// Nothing comes back, the value is believed
+		e.Value = Value;
+		e.Source = PARAMETER_WRITTEN;
+		e.Time = Now;
+		return;
+	}
+	e.Pending = true;
+	e.PendingValue = Value;
+	e.PendingTime = Now;
+}
+
+int ParameterCache::Ask(int64_t Now)
+{
+	for (int i = 1; i < PARAMETER_COUNT; i++)
+	{
+		ParameterEntry &e = m_Entries[i];
+		if (e.Pending && Now - e.PendingTime >= ConfirmMs)
+		{
+			WriteFailures++;
+			e.Pending = false;
+		}
+	}
+	if (m_Asking != 0)
+	{
+		if (Now - m_Entries[m_Asking].AskedTime < ConfirmMs)
+			return 0;
+		m_Asking = 0;	// no answer, RetryMs later again
+	}
+	if (MaxAgeMs <= 0)
+		return 0;
+	for (int i = 1; i < PARAMETER_COUNT; i++)
+	{
+		ParameterEntry &e = m_Entries[i];
+		if (!CanAsk(i) || e.Pending || !IsStale(i, Now) ||
+			(e.AskedTime != 0 && Now - e.AskedTime < RetryMs))
+			continue;
+		e.AskedTime = Now;
+		m_Asking = i;
+		Questions++;
+		return i;
+	}
+	return 0;
+}
@@ -0,0 +1,63 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "parametertable.h"
+#include "autopilotcore.h"
+
+static const ParameterInfo s_Parameters[PARAMETER_COUNT] =
+{
+	// Name				Code	Min	Max	Default	DisplayKey
+	{ "------------",	0x00,	0,	0,	0,		0 },
+	{ "Response",		0x12,	1,	9,	5,		KEY_RESPONSE_DISPLAY },
+	{ "WindTrim",		0x11,	1,	9,	5,		0 },
+	{ "RudderGain",		0x01,	1,	9,	5,		KEY_RUDDERGAIN_DISPLAY },
+	{ "CounterRudder",	0x02,	1,	9,	5,		0 },
+	{ "RudderLimit",	0x03,	10,	40,	30,		0 },
+	{ "TurnRateLimit",	0x04,	1,	30,	10,		0 },
+	{ "OffCourseLimit",	0x06,	15,	40,	20,		0 },
+	{ "AutoTrim",		0x07,	0,	4,	1,		0 },
+	{ "RudderDamping",	0x0B,	1,	9,	3,		0 },
+	{ "AutoTackAngle",	0x1D,	40,	125,	100,	0 },
+};
+
+const ParameterInfo &ParameterTable::Get(int Parameter)
+{
+	if (Parameter <= 0 || Parameter >= PARAMETER_COUNT)
+		return s_Parameters[0];
+	return s_Parameters[Parameter];
+}
+
+int ParameterTable::Find(const std::string &Name)
+{
+	for (int i = 1; i < PARAMETER_COUNT; i++)
+		if (Name == s_Parameters[i].Name)
+			return i;
+	return 0;
+}
+
+int ParameterTable::FindCode(int Code)
+{
+	for (int i = 1; i < PARAMETER_COUNT; i++)
+		if (Code == s_Parameters[i].Code)
+			return i;
+	return 0;
+}
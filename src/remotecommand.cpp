@@ -0,0 +1,256 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "remotecommand.h"
+#include "jsonscanner.h"
+#include "parametertable.h"
+
+#include <ctype.h>
+#include <stdio.h>
+
+static const char *s_Methods[] =
+{
+	"", "standby", "auto", "track", "autowind", "course", "set", "state", "subscribe", "unsubscribe",
+	"heading", "dodge", "resume",
+};
+
+#define REMOTE_METHODS	(int)(sizeof(s_Methods) / sizeof(s_Methods[0]))
+
+RemoteCommand::RemoteCommand()
+{
+	Clear();
+}
+
+void RemoteCommand::Clear()
+{
+	Method = REMOTE_NONE;
+	Id.clear();
+	Change = 0;
+	Heading = -1;
+	Seconds = 0;
+	Parameter = 0;
+	Value = 0;
+	HasValue = false;
+	ErrorCode = 0;
+	Error.clear();
+}
+
+const char *RemoteCommand::MethodName(int Method)
+{
+	return Method > 0 && Method < REMOTE_METHODS ? s_Methods[Method] : "";
+}
+
+// A JSON number as Skip() returns it: -?digits[.digits][e[+-]digits]
+static bool IsNumber(const std::string &Text)
+{
+	size_t i = Text[0] == '-' ? 1 : 0, First = i;
+	while (i < Text.length() && isdigit((unsigned char)Text[i]))
+		i++;
+	if (i == First)
+		return false;
+	if (i < Text.length() && Text[i] == '.')
+	{
+		First = ++i;
+		while (i < Text.length() && isdigit((unsigned char)Text[i]))
+			i++;
+		if (i == First)
+			return false;
+	}
+	if (i < Text.length() && (Text[i] == 'e' || Text[i] == 'E'))
+	{
+		if (++i < Text.length() && (Text[i] == '+' || Text[i] == '-'))
+			i++;
+		First = i;
+		while (i < Text.length() && isdigit((unsigned char)Text[i]))
+			i++;
+		if (i == First)
+			return false;
+	}
+	return i == Text.length();
+}
+
+// The members of the request and of its params in one loop, params may only
+// hold values, no further objects.
+static bool ParseMembers(JsonScanner &Json, RemoteCommand &Command, bool Params)
+{
+	std::string Name, Text;	// short, no allocation
+	if (!Json.Expect('{'))
+		return false;
+	if (Json.Expect('}'))
+		return true;
+	do
+	{
+		if (!Json.String(&Name) || !Json.Expect(':'))
+			return false;
+		bool Ok;
+		if (!Params && (Name == "method" || Name == "command"))
+		{
+			Ok = Json.String(&Text);
+			Command.Method = -1;
+			for (int i = 1; i < REMOTE_METHODS && Ok; i++)
+				if (Text == s_Methods[i])
+					Command.Method = i;
+		}
+		else if (!Params && Name == "id")
+		{
+			// a string, a number or null is echoed, true, false, an object
+			// or an array is no valid id, anything else is no JSON
+			Ok = Json.Skip(&Text);
+			if (Ok && (Text[0] == '"' || Text == "null" || IsNumber(Text)))
+				Command.Id = Text;
+			else if (Ok && (Text == "true" || Text == "false" || Text[0] == '{' || Text[0] == '['))
+				Command.ErrorCode = REMOTE_INVALID_REQUEST;
+			else
+				Ok = false;
+		}
+		else if (!Params && Name == "params" && Json.Peek('{'))
+			Ok = ParseMembers(Json, Command, true);
+		else if (Name == "change")
+			Ok = Json.Integer(Command.Change);
+		else if (Name == "heading")
+			Ok = Json.Integer(Command.Heading);
+		else if (Name == "seconds")
+			Ok = Json.Integer(Command.Seconds);
+		else if (Name == "value")
+			Ok = Command.HasValue = Json.Integer(Command.Value);
+		else if (Name == "parameter")
+		{
+			if (Json.Peek('"'))
+			{
+				Ok = Json.String(&Text);
+				Command.Parameter = ParameterTable::Find(Text);
+			}
+			else
+				Ok = Json.Integer(Command.Parameter);
+		}
+		else
+			Ok = Json.Skip(NULL);
+		if (!Ok)
+			return false;
+	} while (Json.Expect(','));
+	return Json.Expect('}');
+}
+
+bool RemoteCommand::Parse(const char *pText, size_t Length)
+{
+	Clear();
+	JsonScanner Json(pText, Length);
+	if (!ParseMembers(Json, *this, false) || !Json.AtEnd())
+	{
+		ErrorCode = REMOTE_PARSE_ERROR;
+		Error = "parse error";
+		return false;
+	}
+	if (ErrorCode == REMOTE_INVALID_REQUEST)
+	{
+		Error = "invalid id";
+		return false;
+	}
+	if (Method <= 0)
+	{
+		ErrorCode = REMOTE_UNKNOWN_METHOD;
+		Error = "unknown method";
+		return false;
+	}
+	if (Method == REMOTE_COURSE && (Change == 0 || Change < -180 || Change > 180))
+	{
+		ErrorCode = REMOTE_INVALID_PARAMS;
+		Error = "change must be -180 .. 180 and not 0";
+		return false;
+	}
+	if (Method == REMOTE_HEADING && (Heading < 0 || Heading > 359))
+	{
+		ErrorCode = REMOTE_INVALID_PARAMS;
+		Error = "heading must be 0 .. 359";
+		return false;
+	}
+	if (Method == REMOTE_DODGE && (Change == 0 || Change < -90 || Change > 90 || Seconds < 0 || Seconds > 3600))
+	{
+		ErrorCode = REMOTE_INVALID_PARAMS;
+		Error = "change must be -90 .. 90 and not 0, seconds 0 .. 3600";
+		return false;
+	}
+	if (Method == REMOTE_SET)
+	{
+		const ParameterInfo &Info = ParameterTable::Get(Parameter);
+		if (Info.Code == 0 || !HasValue || Value < Info.Min || Value > Info.Max)
+		{
+			ErrorCode = REMOTE_INVALID_PARAMS;
+			Error = Info.Code == 0 ? "unknown parameter" : "value out of range";
+			return false;
+		}
+	}
+	return true;
+}
+
+static void AppendString(std::string &Json, const std::string &Text)
+{
+	Json += '"';
+	for (size_t i = 0; i < Text.length(); i++)
+	{
+		char c = Text[i];
+		if (c == '"' || c == '\\')
+			Json += '\\';
+		if ((unsigned char)c >= 0x20)
+			Json += c;
+	}
+	Json += '"';
+}
+
+std::string RemoteCommand::Reply() const
+{
+	std::string Json = "{\"jsonrpc\":\"2.0\",\"id\":";
+	Json += Id.empty() ? "null" : Id;
+	Json += ",\"result\":\"ok\"}\n";
+	return Json;
+}
+
+std::string RemoteCommand::Reply(int Code, const std::string &Message) const
+{
+	char Buffer[32];
+	snprintf(Buffer, sizeof(Buffer), "%d", Code);
+	std::string Json = "{\"jsonrpc\":\"2.0\",\"id\":";
+	Json += Id.empty() ? "null" : Id;
+	Json += ",\"error\":{\"code\":";
+	Json += Buffer;
+	Json += ",\"message\":";
+	AppendString(Json, Message);
+	Json += "}}\n";
+	return Json;
+}
+
+std::string RemoteCommand::MessageReply(const std::string &Error, const std::string &State) const
+{
+	std::string Json = "{\"id\":";
+	Json += Id.empty() ? "null" : Id;
+	if (Error.empty())
+		Json += ",\"result\":\"ok\"";
+	else
+	{
+		Json += ",\"error\":";
+		AppendString(Json, Error);
+	}
+	Json += ",\"state\":";
+	Json += State;
+	Json += "}";
+	return Json;
+}
@@ -0,0 +1,137 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "seastatecontrol.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// -180 .. 179
+static int HeadingError(int Heading, int LockedCourse)
+{
+	int Error = (Heading - LockedCourse) % 360;
+	if (Error < -180)
+		Error += 360;
+	if (Error >= 180)
+		Error -= 360;
+	return Error;
+}
+
+SeaStateControl::SeaStateControl()
+{
+	Enabled = false;
+	MinIntervalMs = 600000;
+	CalmErrorSd = 2.0;
+	RoughErrorSd = 5.0;
+	CalmRudder = 2.0;
+	MinResponse = 2;
+	MaxResponse = 8;
+	CourseChange = 3;
+	MaxGapMs = 5000;
+	Changes = 0;
+	ChangeErrorSd = 0;
+	ChangeRudderWork = 0;
+	m_Changed = false;
+	m_LastChange = 0;
+	Clear();
+}
+
+void SeaStateControl::Clear()
+{
+	m_Head = 0;
+	m_Size = 0;
+	m_SumError = 0;
+	m_SumError2 = 0;
+	m_SumRudder = 0;
+	m_HaveLast = false;
+}
+
+double SeaStateControl::ErrorSd() const
+{
+	if (m_Size < 2)
+		return 0;
+	double n = (double)m_Size;
+	double Variance = (m_SumError2 - (double)m_SumError * m_SumError / n) / (n - 1);
+	return Variance > 0 ? sqrt(Variance) : 0;
+}
+
+double SeaStateControl::RudderWork() const
+{
+	return m_Size > 0 ? (double)m_SumRudder / m_Size : 0;
+}
+
+int SeaStateControl::Add(const TelemetrySample &Sample, int Response)
+{
+	if (!(Sample.Flags & TELEMETRY_AUTO) ||
+		(m_HaveLast && (Sample.Time - m_Last.Time > MaxGapMs ||
+			abs(HeadingError(Sample.LockedCourse, m_Last.LockedCourse)) >= CourseChange)))
+		Clear();
+	if (!(Sample.Flags & TELEMETRY_AUTO))
+		return 0;
+	if (!m_HaveLast)
+	{
+		m_Last = Sample;
+		m_HaveLast = true;
+		return 0;
+	}
+	Entry e;
+	e.Error = (int16_t)HeadingError(Sample.Heading, Sample.LockedCourse);
+	e.RudderChange = (int16_t)abs(Sample.Rudder - m_Last.Rudder);
+	m_Last = Sample;
+	if (m_Size == SEASTATE_WINDOW)
+	{
+		const Entry &Old = m_Window[m_Head];
+		m_SumError -= Old.Error;
+		m_SumError2 -= Old.Error * Old.Error;
+		m_SumRudder -= Old.RudderChange;
+	}
+	else
+		m_Size++;
+	m_Window[m_Head] = e;
+	m_Head = (m_Head + 1) % SEASTATE_WINDOW;
+	m_SumError += e.Error;
+	m_SumError2 += e.Error * e.Error;
+	m_SumRudder += e.RudderChange;
+
+	if (Response <= 0 || m_Size < SEASTATE_WINDOW || (m_Changed && Sample.Time - m_LastChange < MinIntervalMs))
+		return 0;
+	double Sd = ErrorSd();
+	int New = Response;
+	if (Sd > RoughErrorSd)
+		New = Response + 1;
+	else if (Sd < CalmErrorSd && RudderWork() < CalmRudder)
+		New = Response - 1;
+	if (New > MaxResponse)
+		New = MaxResponse;
+	if (New < MinResponse)
+		New = MinResponse;
+	if (New == Response)
+		return 0;
+	// The new level has to show its effect in a window of its own
+	Changes++;
+	ChangeErrorSd = Sd;
+	ChangeRudderWork = RudderWork();
+	m_Changed = true;
+	m_LastChange = Sample.Time;
+	Clear();
+	return New;
+}
@@ -0,0 +1,90 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl.Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "seatalk.h"
+
+#include <stdio.h>
+
+std::string SeatalkSentence(const std::string &Name, const SeatalkDatagram &Datagram)
+{
+	static const char Hex[] = "0123456789ABCDEF";
+	std::string s;
+	s.reserve(Name.length() + 3 * Datagram.Length + 5);
+	s += '$';
+	s += Name;
+	for (int i = 0; i < Datagram.Length; i++)
+	{
+		s += ',';
+		s += Hex[Datagram.Data[i] >> 4];
+		s += Hex[Datagram.Data[i] & 0x0F];
+	}
+	unsigned char Checksum = 0;
+	for (size_t i = 1; i < s.length(); i++)
+		Checksum ^= (unsigned char)s[i];
+	s += '*';
+	s += Hex[Checksum >> 4];
+	s += Hex[Checksum & 0x0F];
+	return s;
+}
+
+SeatalkFramer::SeatalkFramer()
+{
+	Datagrams = 0;
+	Errors = 0;
+	Reset();
+}
+
+void SeatalkFramer::Reset()
+{
+	m_Datagram.Length = 0;
+	m_Expected = 0;
+	m_MarkState = 0;
+	m_HaveLowByte = false;
+	m_LowByte = 0;
+}
+
+bool SeatalkFramer::Push(unsigned char Byte, bool Command, SeatalkDatagram &Datagram)
+{
+	if (Command)
+	{
+		if (m_Expected != 0)
+			Errors++;	// collision, the last datagram is incomplete
+		m_Datagram.Data[0] = Byte;
+		m_Datagram.Length = 1;
+		m_Expected = 2;	// length is known with the attribute byte
+		return false;
+	}
+	if (m_Expected == 0)
+	{
+		Errors++;		// data without a command byte
+		return false;
+	}
+	m_Datagram.Data[m_Datagram.Length++] = Byte;
+	if (m_Datagram.Length == 2)
+		m_Expected = 3 + (Byte & 0x0F);
+	if (m_Datagram.Length < m_Expected)
+		return false;
+	m_Expected = 0;
+	Datagrams++;
+	Datagram = m_Datagram;
+	return true;
+}
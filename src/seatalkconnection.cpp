@@ -0,0 +1,468 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl.Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "seatalkconnection.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+#define MAX_LINE	512		// longer lines without CR/LF are thrown away
+#define CONNECT_TIMEOUT_MS	2000
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0	// macOS, SO_NOSIGPIPE on the socket instead
+#endif
+
+SeatalkConnection::SeatalkConnection()
+	: BytesIn(0), BytesOut(0), Lost(false), m_Stop(false), m_NotifyPending(false)
+{
+	m_fd = -1;
+	m_Wake[0] = m_Wake[1] = -1;
+	m_Binary = false;
+	m_Udp = false;
+	m_Socket = false;
+}
+
+SeatalkConnection::~SeatalkConnection()
+{
+	Close();
+}
+
+static std::string Field(const std::string &Spec, size_t Index)
+{
+	size_t First = 0;
+	for (size_t i = 0; i < Index; i++)
+	{
+		First = Spec.find(':', First);
+		if (First == std::string::npos)
+			return std::string();
+		First++;
+	}
+	size_t End = Spec.find(':', First);
+	return Spec.substr(First, End == std::string::npos ? std::string::npos : End - First);
+}
+
+bool SeatalkConnection::Receive(std::string &sentence)
+{
+	if (Inbound.Pop(sentence))
+		return true;
+	m_NotifyPending = false;
+	return Inbound.Pop(sentence);	// pushed between the Pop and the reset
+}
+
+#ifdef _WIN32
+
+bool SeatalkConnection::Open(const std::string &, const std::string &)
+{
+	m_Error = "direct connection is not available on Windows";
+	return false;
+}
+
+void SeatalkConnection::Close()
+{
+}
+
+void SeatalkConnection::Send(const std::string &)
+{
+}
+
+#else
+
+bool SeatalkConnection::Open(const std::string &Spec, const std::string &Name)
+{
+	Close();
+	m_Name = Name;
+	m_Error.clear();
+	m_Line.clear();
+	m_Framer.Reset();
+	Outbound.Clear();
+
+	std::string Type = Field(Spec, 0);
+	m_Binary = Type == "seatalk";
+	m_Udp = Type == "udp";
+	m_Socket = Type == "tcp" || Type == "udp";
+	if (Type == "serial" || Type == "seatalk")
+	{
+		std::string Baud = Field(Spec, 2);
+		m_fd = OpenSerial(Field(Spec, 1), Baud.empty() || m_Binary ? 4800 : atoi(Baud.c_str()), m_Binary);
+		if (!Baud.empty() && !m_Binary)
+			Outbound.BytesPerSecond = atoi(Baud.c_str()) / 10;
+	}
+	else if (Type == "tcp" || Type == "udp")
+		m_fd = OpenSocket(Field(Spec, 1), Field(Spec, 2), m_Udp);
+	else
+		m_Error = "unknown connection type " + Type;
+	if (m_fd < 0)
+		return false;
+
+	if (pipe(m_Wake) != 0)
+	{
+		m_Error = strerror(errno);
+		close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+	fcntl(m_Wake[0], F_SETFL, O_NONBLOCK);
+	fcntl(m_Wake[1], F_SETFL, O_NONBLOCK);
+	m_Stop = false;
+	m_NotifyPending = false;
+	Lost = false;
+	m_Thread = std::thread(&SeatalkConnection::Run, this);
+	return true;
+}
+
+void SeatalkConnection::Close()
+{
+	if (m_Thread.joinable())
+	{
+		m_Stop = true;
+		char c = 0;
+		if (write(m_Wake[1], &c, 1) < 0)
+		{
+			// pipe full, poll() wakes up anyway
+		}
+		m_Thread.join();
+	}
+	if (m_fd >= 0)
+		close(m_fd);
+	if (m_Wake[0] >= 0)
+		close(m_Wake[0]);
+	if (m_Wake[1] >= 0)
+		close(m_Wake[1]);
+	m_fd = -1;
+	m_Wake[0] = m_Wake[1] = -1;
+}
+
+void SeatalkConnection::Send(const std::string &sentence)
+{
+	if (m_fd < 0 || !Outbound.Push(sentence))
+		return;
+	char c = 0;
+	if (write(m_Wake[1], &c, 1) < 0)
+	{
+		// pipe full, the I/O thread is awake already
+	}
+}
+
+static speed_t BaudConstant(int Baud)
+{
+	switch (Baud)
+	{
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		default: return B4800;
+	}
+}
+
+int SeatalkConnection::OpenSerial(const std::string &Path, int Baud, bool Binary)
+{
+	int fd = open(Path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0)
+	{
+		m_Error = Path + ": " + strerror(errno);
+		return -1;
+	}
+	struct termios tio;
+	if (tcgetattr(fd, &tio) != 0)
+	{
+		m_Error = Path + ": " + strerror(errno);
+		close(fd);
+		return -1;
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	if (Binary)
+	{
+#ifdef CMSPAR
+		// Parity trick: space parity, so the command bit (9th bit = 1) gives
+		// a parity error, which PARMRK marks with 0xFF 0x00.
+		tio.c_cflag |= PARENB | CMSPAR;
+		tio.c_cflag &= ~PARODD;
+		tio.c_iflag |= INPCK | PARMRK;
+		tio.c_iflag &= ~(IGNPAR | ISTRIP);
+#else
+		m_Error = "seatalk: mark/space parity is not available on this system";
+		close(fd);
+		return -1;
+#endif
+	}
+	cfsetispeed(&tio, BaudConstant(Baud));
+	cfsetospeed(&tio, BaudConstant(Baud));
+	if (tcsetattr(fd, TCSANOW, &tio) != 0)
+	{
+		m_Error = Path + ": " + strerror(errno);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int SeatalkConnection::OpenSocket(const std::string &Host, const std::string &Port, bool Udp)
+{
+	struct addrinfo Hints, *pResult = NULL;
+	memset(&Hints, 0, sizeof(Hints));
+	Hints.ai_family = AF_UNSPEC;
+	Hints.ai_socktype = Udp ? SOCK_DGRAM : SOCK_STREAM;
+	int Result = getaddrinfo(Host.c_str(), Port.c_str(), &Hints, &pResult);
+	if (Result != 0 || pResult == NULL)
+	{
+		m_Error = Host + ":" + Port + ": " + gai_strerror(Result);
+		return -1;
+	}
+	int fd = socket(pResult->ai_family, pResult->ai_socktype, pResult->ai_protocol);
+	if (fd < 0)
+	{
+		m_Error = strerror(errno);
+		freeaddrinfo(pResult);
+		return -1;
+	}
+#ifdef SO_NOSIGPIPE
+	// A write to a closed peer must not kill OpenCPN with SIGPIPE
+	int NoSigPipe = 1;
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &NoSigPipe, sizeof(NoSigPipe));
+#endif
+	bool Ok;
+	if (Udp)
+	{
+		// Receive on the same port, from everybody. Sent to Host with sendto().
+		int One = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &One, sizeof(One));
+		struct sockaddr_storage Local;
+		memset(&Local, 0, sizeof(Local));
+		memcpy(&Local, pResult->ai_addr, pResult->ai_addrlen);
+		if (Local.ss_family == AF_INET)
+			((struct sockaddr_in *)&Local)->sin_addr.s_addr = htonl(INADDR_ANY);
+		else
+			((struct sockaddr_in6 *)&Local)->sin6_addr = in6addr_any;
+		Ok = bind(fd, (struct sockaddr *)&Local, pResult->ai_addrlen) == 0;
+		m_Peer.assign((const char *)pResult->ai_addr, pResult->ai_addrlen);
+	}
+	else
+	{
+		// Connect with a timeout, Open() also runs in the timer of the plugin
+		// to reconnect and must not hold up OpenCPN for long
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		Ok = connect(fd, pResult->ai_addr, pResult->ai_addrlen) == 0;
+		if (!Ok && errno == EINPROGRESS)
+		{
+			struct pollfd Fd;
+			Fd.fd = fd;
+			Fd.events = POLLOUT;
+			Fd.revents = 0;
+			int Error = ETIMEDOUT;
+			socklen_t Length = sizeof(Error);
+			if (poll(&Fd, 1, CONNECT_TIMEOUT_MS) == 1)
+				getsockopt(fd, SOL_SOCKET, SO_ERROR, &Error, &Length);
+			Ok = Error == 0;
+			errno = Error;
+		}
+		int One = 1;
+		if (Ok)
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &One, sizeof(One));
+	}
+	freeaddrinfo(pResult);
+	if (!Ok)
+	{
+		m_Error = Host + ":" + Port + ": " + strerror(errno);
+		close(fd);
+		return -1;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+void SeatalkConnection::Run()
+{
+	struct pollfd Fds[2];
+	int64_t Wait = -1;
+	while (!m_Stop)
+	{
+		Fds[0].fd = Lost ? -1 : m_fd;	// POLLHUP would come again and again
+		Fds[0].events = POLLIN;
+		Fds[0].revents = 0;
+		Fds[1].fd = m_Wake[0];
+		Fds[1].events = POLLIN;
+		Fds[1].revents = 0;
+		int Result = poll(Fds, 2, (int)Wait);
+		if (Result < 0 && errno != EINTR)
+			break;
+		if (Fds[1].revents & POLLIN)
+		{
+			char Buffer[64];
+			while (read(m_Wake[0], Buffer, sizeof(Buffer)) > 0)
+				;
+		}
+		if (Fds[0].revents & (POLLIN | POLLERR | POLLHUP))
+			Read();
+
+		std::string sentence;
+		while (Outbound.Pop(m_Clock.NowMs(), sentence, Wait))
+			Write(sentence);
+	}
+}
+
+void SeatalkConnection::Read()
+{
+	unsigned char Buffer[1024];
+	ssize_t Count = read(m_fd, Buffer, sizeof(Buffer));
+	if (Count <= 0)
+	{
+		if (Count < 0 && (errno == EAGAIN || errno == EINTR))
+			return;
+		if (m_Udp)
+			return;		// an empty datagram or an ICMP error, nothing is lost
+		// Peer closed or device gone, the fd is not polled any more. The
+		// plugin sees Lost, closes and opens again.
+		Lost = true;
+		return;
+	}
+	BytesIn += Count;
+	if (m_Binary)
+	{
+		m_Framer.PushMarked(Buffer, (size_t)Count, [this](const SeatalkDatagram &Datagram)
+		{
+			std::string s = SeatalkSentence(m_Name, Datagram);
+			Deliver(s.c_str(), s.length());
+		});
+		return;
+	}
+	for (ssize_t i = 0; i < Count; i++)
+	{
+		char c = (char)Buffer[i];
+		if (c == '\r' || c == '\n')
+		{
+			if (!m_Line.empty())
+				Deliver(m_Line.c_str(), m_Line.length());
+			m_Line.clear();
+		}
+		else if (m_Line.length() < MAX_LINE)
+			m_Line += c;
+		else
+			m_Line.clear();
+		if (m_Udp && i == Count - 1 && !m_Line.empty())
+		{
+			// One datagram is one sentence, CR LF is optional
+			Deliver(m_Line.c_str(), m_Line.length());
+			m_Line.clear();
+		}
+	}
+}
+
+void SeatalkConnection::Deliver(const char *pSentence, size_t Length)
+{
+	if (!Inbound.Push(pSentence, Length))
+		return;
+	if (!m_NotifyPending.exchange(true) && m_Notify)
+		m_Notify();
+}
+
+void SeatalkConnection::Write(const std::string &sentence)
+{
+	if (m_Binary)
+	{
+		WriteBinary(sentence);
+		return;
+	}
+	ssize_t Count;
+	// No SIGPIPE when the peer has closed, that would end OpenCPN
+	if (m_Udp)
+		Count = sendto(m_fd, sentence.c_str(), sentence.length(), MSG_NOSIGNAL, (const struct sockaddr *)m_Peer.data(), (socklen_t)m_Peer.length());
+	else if (m_Socket)
+		Count = send(m_fd, sentence.c_str(), sentence.length(), MSG_NOSIGNAL);
+	else
+		Count = write(m_fd, sentence.c_str(), sentence.length());
+	// A sentence is short, a full socket or tty buffer means the bridge is
+	// gone, so there is no partial write handling.
+	if (Count > 0)
+		BytesOut += Count;
+	else if (Count < 0 && (errno == EPIPE || errno == ECONNRESET || errno == EIO || errno == ENXIO))
+		Lost = true;
+}
+
+// $STALK,86,21,01,FE*4E -> command byte with mark parity (9th bit 1), then
+// the data bytes with space parity.
+void SeatalkConnection::WriteBinary(const std::string &sentence)
+{
+#ifdef CMSPAR
+	// Every field two hex digits up to the '*', as many as the attribute
+	// byte says. Anything else is no Seatalk datagram and not written.
+	std::vector<unsigned char> Bytes;
+	size_t End = sentence.find('*');
+	if (End == std::string::npos)
+		End = sentence.find_first_of("\r\n");
+	if (End == std::string::npos)
+		End = sentence.length();
+	size_t Position = sentence.find(',');
+	while (Position != std::string::npos && Position < End)
+	{
+		size_t Next = sentence.find(',', Position + 1);
+		size_t Length = (Next == std::string::npos || Next > End ? End : Next) - Position - 1;
+		if (Length != 2 || !isxdigit((unsigned char)sentence[Position + 1]) || !isxdigit((unsigned char)sentence[Position + 2]))
+			return;
+		Bytes.push_back((unsigned char)strtol(sentence.substr(Position + 1, 2).c_str(), NULL, 16));
+		Position = Next;
+	}
+	if (Bytes.size() < 3 || Bytes.size() != 3 + (size_t)(Bytes[1] & 0x0F))
+		return;
+	struct termios tio;
+	if (tcgetattr(m_fd, &tio) != 0)
+		return;
+	for (size_t i = 0; i < Bytes.size(); i++)
+	{
+		if (i <= 1)
+		{
+			if (i == 0)
+				tio.c_cflag |= PARODD;
+			else
+				tio.c_cflag &= ~PARODD;
+			tcdrain(m_fd);
+			tcsetattr(m_fd, TCSADRAIN, &tio);
+		}
+		if (write(m_fd, &Bytes[i], 1) == 1)
+			BytesOut++;
+	}
+	tcdrain(m_fd);
+#else
+	(void)sentence;
+#endif
+}
+
+#endif
@@ -0,0 +1,203 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl.Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "sentencecapture.h"
+
+#include <string.h>
+#include <time.h>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define CAPTURE_ALIGN(x) (((x) + 7) & ~((uint64_t)7))
+
+SentenceCapture::SentenceCapture()
+{
+	m_pBase = NULL;
+	m_Size = 0;
+	m_Used = 0;
+	m_StartNs = 0;
+#ifdef _WIN32
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMapping = NULL;
+#else
+	m_fd = -1;
+#endif
+}
+
+SentenceCapture::~SentenceCapture()
+{
+	Close();
+}
+
+bool SentenceCapture::Open(const char *path, uint64_t size)
+{
+	Close();
+	size = CAPTURE_ALIGN(size);
+	if (size < 4096)
+		size = 4096;
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READWRITE,
+		(DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+	if (hMapping == NULL)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+	void *pBase = MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+	if (pBase == NULL)
+	{
+		CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+#else
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+	// Reserve the blocks now, so a full disk does not end in SIGBUS while capturing.
+#if defined(__linux__)
+	if (posix_fallocate(fd, 0, (off_t)size) != 0)
+#else
+	if (ftruncate(fd, (off_t)size) != 0)
+#endif
+	{
+		close(fd);
+		return false;
+	}
+	void *pBase = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (pBase == MAP_FAILED)
+	{
+		close(fd);
+		return false;
+	}
+	m_fd = fd;
+#endif
+	m_pBase = (unsigned char *)pBase;
+	m_Size = size;
+	m_Used = sizeof(CaptureFileHeader);
+
+	CaptureFileHeader *pHeader = (CaptureFileHeader *)m_pBase;
+	memset(pHeader, 0, sizeof(CaptureFileHeader));
+	memcpy(pHeader->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+	pHeader->version = CAPTURE_VERSION;
+	pHeader->header_size = sizeof(CaptureFileHeader);
+	pHeader->file_size = m_Size;
+	pHeader->used = m_Used;
+	pHeader->start_time = (int64_t)time(NULL);
+	m_StartNs = (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	return true;
+}
+
+void SentenceCapture::Close()
+{
+	if (m_pBase == NULL)
+		return;
+	uint64_t used = m_Used;
+#ifdef _WIN32
+	UnmapViewOfFile(m_pBase);
+	CloseHandle((HANDLE)m_hMapping);
+	// Cut off the unused, preallocated rest of the file.
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)used;
+	if (SetFilePointerEx((HANDLE)m_hFile, end, NULL, FILE_BEGIN))
+		SetEndOfFile((HANDLE)m_hFile);
+	CloseHandle((HANDLE)m_hFile);
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMapping = NULL;
+#else
+	munmap(m_pBase, (size_t)m_Size);
+	// Cut off the unused, preallocated rest of the file.
+	if (ftruncate(m_fd, (off_t)used) != 0)
+	{
+		// Keep the preallocated size, the reader stops at the first empty record.
+	}
+	close(m_fd);
+	m_fd = -1;
+#endif
+	m_pBase = NULL;
+	m_Size = 0;
+	m_Used = 0;
+}
+
+uint64_t SentenceCapture::NowNs() const
+{
+	int64_t now = (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	return (uint64_t)(now - m_StartNs);
+}
+
+bool SentenceCapture::Append(int direction, const char *sentence, size_t length)
+{
+	if (m_pBase == NULL)
+		return false;
+	if (length > 0xFFFF)
+		length = 0xFFFF;
+
+	CaptureFileHeader *pHeader = (CaptureFileHeader *)m_pBase;
+	uint64_t needed = sizeof(CaptureRecordHeader) + CAPTURE_ALIGN(length);
+	if (m_Used + needed > m_Size)
+	{
+		// Session file is full. Count and forget, never block the caller.
+		pHeader->dropped++;
+		return false;
+	}
+
+	CaptureRecordHeader *pRecord = (CaptureRecordHeader *)(m_pBase + m_Used);
+	memcpy(m_pBase + m_Used + sizeof(CaptureRecordHeader), sentence, length);
+	pRecord->direction = (uint8_t)direction;
+	pRecord->length = (uint16_t)length;
+	// The 1 keeps the end of data marker (time 0, length 0) unique.
+	pRecord->time_ns = NowNs() | 1;
+	m_Used += needed;
+	pHeader->used = m_Used;
+	pHeader->records++;
+	return true;
+}
+
+uint64_t SentenceCapture::Records() const
+{
+	if (m_pBase == NULL)
+		return 0;
+	return ((const CaptureFileHeader *)m_pBase)->records;
+}
+
+uint64_t SentenceCapture::Dropped() const
+{
+	if (m_pBase == NULL)
+		return 0;
+	return ((const CaptureFileHeader *)m_pBase)->dropped;
+}
@@ -0,0 +1,40 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "sentencerouter.h"
+
+void SentenceRouter::Add(const std::string &Name, int Bus)
+{
+	m_Buses[Name] = Bus;
+}
+
+int SentenceRouter::Route(const std::string &sentence) const
+{
+	if (sentence.empty() || m_Buses.empty())
+		return -1;
+	size_t Comma = sentence.find(',');
+	if (Comma == std::string::npos || Comma < 2)
+		return -1;
+	m_Key.assign(sentence, 1, Comma - 1);
+	std::unordered_map<std::string, int>::const_iterator i = m_Buses.find(m_Key);
+	return i == m_Buses.end() ? -1 : i->second;
+}
@@ -0,0 +1,83 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "steeringprofile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+SteeringProfile::SteeringProfile()
+{
+	for (int i = 0; i < PARAMETER_COUNT; i++)
+		Values[i] = -1;
+}
+
+bool SteeringProfile::Parse(const std::string &Text)
+{
+	for (int i = 0; i < PARAMETER_COUNT; i++)
+		Values[i] = -1;
+	size_t Start = 0;
+	while (Start < Text.length())
+	{
+		size_t End = Text.find(',', Start);
+		if (End == std::string::npos)
+			End = Text.length();
+		std::string Item = Text.substr(Start, End - Start);
+		Start = End + 1;
+		size_t Equal = Item.find('=');
+		if (Equal == std::string::npos)
+			return false;
+		int Parameter = ParameterTable::Find(Item.substr(0, Equal));
+		if (Parameter == 0)
+			return false;
+		const ParameterInfo &Info = ParameterTable::Get(Parameter);
+		char *pEnd;
+		long Value = strtol(Item.c_str() + Equal + 1, &pEnd, 10);
+		if (pEnd == Item.c_str() + Equal + 1 || *pEnd != 0 || Value < Info.Min || Value > Info.Max)
+			return false;
+		Values[Parameter] = (int)Value;
+	}
+	return Count() > 0;
+}
+
+std::string SteeringProfile::Format() const
+{
+	std::string Text;
+	for (int i = 1; i < PARAMETER_COUNT; i++)
+	{
+		if (Values[i] < 0)
+			continue;
+		char Buffer[48];
+		snprintf(Buffer, sizeof(Buffer), "%s%s=%d", Text.empty() ? "" : ",", ParameterTable::Get(i).Name, Values[i]);
+		Text.append(Buffer);
+	}
+	return Text;
+}
+
+int SteeringProfile::Count() const
+{
+	int n = 0;
+	for (int i = 1; i < PARAMETER_COUNT; i++)
+		if (Values[i] >= 0)
+			n++;
+	return n;
+}
@@ -0,0 +1,162 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "steeringstats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+double Welford::StdDev() const
+{
+	return sqrt(Variance());
+}
+
+void SteeringStats::Clear()
+{
+	HeadingError.Clear();
+	RudderActivity = 0;
+	TimeMs = 0;
+	OffCourseMs = 0;
+	StandbyDrops = 0;
+}
+
+SteeringStatistics::SteeringStatistics()
+{
+	MaxGapMs = 5000;
+	m_HaveLast = false;
+	m_LastSteeringMode = -1;
+}
+
+void SteeringStatistics::Clear()
+{
+	for (int m = 0; m < STEERING_MODES; m++)
+		m_Modes[m].Clear();
+	m_Leg.Clear();
+	m_HaveLast = false;
+	m_LastSteeringMode = -1;
+}
+
+int SteeringStatistics::SteeringMode(int Flags)
+{
+	if (!(Flags & TELEMETRY_AUTO))
+		return -1;
+	if (Flags & TELEMETRY_VANE)
+		return STEERING_WIND;
+	if (Flags & TELEMETRY_TRACK)
+		return STEERING_TRACK;
+	return STEERING_AUTO;
+}
+
+const char *SteeringStatistics::ModeName(int Mode)
+{
+	static const char *Names[STEERING_MODES] = { "auto", "wind", "track" };
+	return Names[Mode];
+}
+
+void SteeringStatistics::Add(const TelemetrySample &Sample)
+{
+	int Mode = SteeringMode(Sample.Flags);
+	if (Mode >= 0)
+	{
+		int Error = (Sample.Heading - Sample.LockedCourse) % 360;
+		if (Error < -180)
+			Error += 360;
+		if (Error >= 180)
+			Error -= 360;
+		m_Modes[Mode].HeadingError.Add(Error);
+		m_Leg.HeadingError.Add(Error);
+		m_LastSteeringMode = Mode;
+	}
+	// The time up to this sample belongs to the mode of the last one.
+	if (m_HaveLast)
+	{
+		int LastMode = SteeringMode(m_Last.Flags);
+		int64_t Gap = Sample.Time - m_Last.Time;
+		if (LastMode >= 0 && Gap > 0 && Gap <= MaxGapMs)
+		{
+			SteeringStats *Stats[2] = { &m_Modes[LastMode], &m_Leg };
+			for (int i = 0; i < 2; i++)
+			{
+				Stats[i]->TimeMs += Gap;
+				if (m_Last.Flags & TELEMETRY_OFFCOURSE)
+					Stats[i]->OffCourseMs += Gap;
+				if (LastMode == Mode)
+					Stats[i]->RudderActivity += abs(Sample.Rudder - m_Last.Rudder);
+			}
+		}
+	}
+	m_Last = Sample;
+	m_HaveLast = true;
+}
+
+void SteeringStatistics::StandbyDrop()
+{
+	// Seen with the first standby sample, so it was the mode before.
+	if (m_LastSteeringMode >= 0)
+		m_Modes[m_LastSteeringMode].StandbyDrops++;
+	m_Leg.StandbyDrops++;
+}
+
+void SteeringStatistics::NewLeg(const std::string &Name)
+{
+	m_Leg.Clear();
+	m_LegName = Name;
+}
+
+static void AppendStats(std::string &Json, const SteeringStats &s)
+{
+	char Buffer[256];
+	snprintf(Buffer, sizeof(Buffer),
+		"\"samples\":%llu,\"heading_error_mean\":%.2f,\"heading_error_sd\":%.2f,"
+		"\"rudder_activity\":%.0f,\"time_s\":%.0f,\"off_course_s\":%.0f,\"standby_drops\":%d}",
+		(unsigned long long)s.HeadingError.Count, s.HeadingError.Mean, s.HeadingError.StdDev(),
+		s.RudderActivity, s.TimeMs / 1000.0, s.OffCourseMs / 1000.0, s.StandbyDrops);
+	Json += Buffer;
+}
+
+std::string SteeringStatistics::ToJSON() const
+{
+	std::string Json = "{\"leg\":{\"name\":\"";
+	for (size_t i = 0; i < m_LegName.length(); i++)
+	{
+		char c = m_LegName[i];
+		if (c == '"' || c == '\\')
+			Json += '\\';
+		if ((unsigned char)c >= 0x20)
+			Json += c;
+	}
+	Json += "\",";
+	AppendStats(Json, m_Leg);
+	Json += ",\"modes\":{";
+	for (int m = 0; m < STEERING_MODES; m++)
+	{
+		if (m > 0)
+			Json += ",";
+		Json += "\"";
+		Json += ModeName(m);
+		Json += "\":{";
+		AppendStats(Json, m_Modes[m]);
+	}
+	Json += "}}";
+	return Json;
+}
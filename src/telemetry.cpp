@@ -0,0 +1,137 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "telemetry.h"
+
+static const size_t s_Capacity[TELEMETRY_LEVELS] = { 300, 360, 240 };
+static const size_t s_SamplesPerBucket[TELEMETRY_LEVELS] = { 1, 10, 60 };
+
+static int16_t HeadingError(int Heading, int LockedCourse)
+{
+	int Error = (Heading - LockedCourse) % 360;
+	if (Error < -180)
+		Error += 360;
+	if (Error >= 180)
+		Error -= 360;
+	return (int16_t)Error;
+}
+
+TelemetryRing::TelemetryRing()
+{
+	size_t First = 0;
+	for (int l = 0; l < TELEMETRY_LEVELS; l++)
+	{
+		m_Levels[l].First = First;
+		First += s_Capacity[l];
+	}
+	Clear();
+}
+
+void TelemetryRing::Clear()
+{
+	for (int l = 0; l < TELEMETRY_LEVELS; l++)
+	{
+		m_Levels[l].Head = 0;
+		m_Levels[l].Size = 0;
+		m_Levels[l].Open.Count = 0;
+	}
+}
+
+size_t TelemetryRing::Capacity(int Level) const
+{
+	return s_Capacity[Level];
+}
+
+size_t TelemetryRing::SamplesPerBucket(int Level) const
+{
+	return s_SamplesPerBucket[Level];
+}
+
+void TelemetryRing::Add(const TelemetrySample &Sample)
+{
+	TelemetryBucket b;
+	b.TimeFirst = Sample.Time;
+	b.TimeLast = Sample.Time;
+	b.Count = 1;
+	b.Heading = Sample.Heading;
+	b.LockedCourse = Sample.LockedCourse;
+	b.ErrorMin = b.ErrorMax = HeadingError(Sample.Heading, Sample.LockedCourse);
+	b.RudderMin = b.RudderMax = Sample.Rudder;
+	b.Flags = Sample.Flags;
+	Push(0, b);
+
+	for (int l = 1; l < TELEMETRY_LEVELS; l++)
+	{
+		TelemetryBucket &Open = m_Levels[l].Open;
+		if (Open.Count == 0)
+			Open = b;
+		else
+		{
+			Open.TimeLast = b.TimeLast;
+			Open.Count++;
+			Open.Heading = b.Heading;
+			Open.LockedCourse = b.LockedCourse;
+			if (b.ErrorMin < Open.ErrorMin) Open.ErrorMin = b.ErrorMin;
+			if (b.ErrorMax > Open.ErrorMax) Open.ErrorMax = b.ErrorMax;
+			if (b.RudderMin < Open.RudderMin) Open.RudderMin = b.RudderMin;
+			if (b.RudderMax > Open.RudderMax) Open.RudderMax = b.RudderMax;
+			Open.Flags |= b.Flags;
+		}
+		if (Open.Count >= s_SamplesPerBucket[l])
+		{
+			Push(l, Open);
+			Open.Count = 0;
+		}
+	}
+}
+
+void TelemetryRing::Push(int Level, const TelemetryBucket &Bucket)
+{
+	LevelRing &l = m_Levels[Level];
+	m_Buckets[l.First + l.Head] = Bucket;
+	l.Head = (l.Head + 1) % s_Capacity[Level];
+	if (l.Size < s_Capacity[Level])
+		l.Size++;
+}
+
+const TelemetryBucket &TelemetryRing::At(int Level, size_t Index) const
+{
+	const LevelRing &l = m_Levels[Level];
+	size_t Oldest = (l.Head + s_Capacity[Level] - l.Size) % s_Capacity[Level];
+	return m_Buckets[l.First + (Oldest + Index) % s_Capacity[Level]];
+}
+
+int TelemetryRing::LevelFor(int64_t Span) const
+{
+	for (int l = 0; l < TELEMETRY_LEVELS; l++)
+	{
+		if (m_Levels[l].Size == 0)
+			return l;
+		// Not full yet: everything since the start is in the level
+		if (m_Levels[l].Size < s_Capacity[l])
+			return l;
+		const TelemetryBucket &Newest = At(l, m_Levels[l].Size - 1);
+		if (Newest.TimeLast - At(l, 0).TimeFirst >= Span)
+			return l;
+	}
+	return TELEMETRY_LEVELS - 1;
+}
@@ -0,0 +1,168 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "trackcontrol.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static double Wrap360(double Value)
+{
+	Value = fmod(Value, 360.0);
+	return Value < 0 ? Value + 360.0 : Value;
+}
+
+// nm east and north of (Lat0, Lon0)
+static void Flat(double Lat0, double Lon0, double Lat, double Lon, double &East, double &North)
+{
+	double dLon = Wrap360(Lon - Lon0 + 180.0) - 180.0;
+	East = dLon * 60.0 * cos(Lat0 * M_PI / 180.0);
+	North = (Lat - Lat0) * 60.0;
+}
+
+TrackControl::TrackControl()
+{
+	Enabled = false;
+	MinIntervalMs = 30000;
+	Gain = 100.0;
+	MaxIntercept = 30.0;
+	MaxStep = 10;
+	Deadband = 3;
+	MinSpeed = 1.0;
+	MaxAgeMs = 10000;
+	Corrections = 0;
+	CorrectionXte = 0;
+	CorrectionCog = 0;
+	m_Changed = false;
+	m_LastChange = 0;
+	Clear();
+}
+
+void TrackControl::Clear()
+{
+	m_HaveFrom = false;
+	m_HaveTo = false;
+	m_HaveFix = false;
+	m_FromLat = m_FromLon = 0;
+	m_ToLat = m_ToLon = 0;
+	m_Name.clear();
+	m_LegTime = 0;
+	m_Lat = m_Lon = 0;
+	m_Cog = m_Sog = NAN;
+	m_FixTime = 0;
+}
+
+void TrackControl::Destination(const std::string &Name, double Lat, double Lon, int64_t Now)
+{
+	if (isnan(Lat) || isnan(Lon))
+		return;
+	bool Recent = m_HaveTo && Now - m_LegTime <= MaxAgeMs;
+	if (!Recent || Name != m_Name)
+	{
+		// The next leg of the route starts where the last one ended
+		m_HaveFrom = Recent;
+		m_FromLat = m_ToLat;
+		m_FromLon = m_ToLon;
+		if (!m_HaveFrom && m_HaveFix && Now - m_FixTime <= MaxAgeMs)
+		{
+			m_HaveFrom = true;
+			m_FromLat = m_Lat;
+			m_FromLon = m_Lon;
+		}
+		m_Name = Name;
+	}
+	m_HaveTo = true;
+	m_ToLat = Lat;
+	m_ToLon = Lon;
+	m_LegTime = Now;
+}
+
+void TrackControl::Fix(double Lat, double Lon, double Cog, double Sog, int64_t Now)
+{
+	if (isnan(Lat) || isnan(Lon))
+		return;
+	m_HaveFix = true;
+	m_Lat = Lat;
+	m_Lon = Lon;
+	m_Cog = Cog;
+	m_Sog = Sog;
+	m_FixTime = Now;
+	if (m_HaveTo && !m_HaveFrom)
+	{
+		m_HaveFrom = true;
+		m_FromLat = Lat;
+		m_FromLon = Lon;
+	}
+}
+
+bool TrackControl::Geometry(double &XteNm, double &Bearing) const
+{
+	if (!HasLeg() || !m_HaveFix)
+		return false;
+	double LegEast, LegNorth, East, North;
+	Flat(m_FromLat, m_FromLon, m_ToLat, m_ToLon, LegEast, LegNorth);
+	Flat(m_FromLat, m_FromLon, m_Lat, m_Lon, East, North);
+	double Length = sqrt(LegEast * LegEast + LegNorth * LegNorth);
+	if (Length < 0.01)
+		return false;
+	XteNm = (LegNorth * East - LegEast * North) / Length;
+	Bearing = Wrap360(atan2(LegEast, LegNorth) * 180.0 / M_PI);
+	return true;
+}
+
+bool TrackControl::Xte(double &Nm) const
+{
+	double Bearing;
+	return Geometry(Nm, Bearing);
+}
+
+int TrackControl::Correction(int64_t Now)
+{
+	double XteNm, Bearing;
+	if (!Enabled || Now - m_FixTime > MaxAgeMs || Now - m_LegTime > MaxAgeMs ||
+		!(m_Sog >= MinSpeed) || isnan(m_Cog) || (m_Changed && Now - m_LastChange < MinIntervalMs) ||
+		!Geometry(XteNm, Bearing))
+		return 0;
+	double Intercept = -Gain * XteNm;
+	if (Intercept > MaxIntercept)
+		Intercept = MaxIntercept;
+	if (Intercept < -MaxIntercept)
+		Intercept = -MaxIntercept;
+	double Course = Wrap360(Bearing + Intercept);
+	int Change = (int)lround(Wrap360(Course - m_Cog + 180.0) - 180.0);
+	if (abs(Change) < Deadband)
+		return 0;
+	if (Change > MaxStep)
+		Change = MaxStep;
+	if (Change < -MaxStep)
+		Change = -MaxStep;
+	Corrections++;
+	CorrectionXte = XteNm;
+	CorrectionCog = Course;
+	m_Changed = true;
+	m_LastChange = Now;
+	return Change;
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin, tools
+ * Author:   Dipl.Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "alloccount.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+static std::atomic<unsigned long long> s_Allocations(0);
+
+unsigned long long AllocationCount()
+{
+	return s_Allocations.load(std::memory_order_relaxed);
+}
+
+static void *CountedAlloc(size_t Size)
+{
+	s_Allocations.fetch_add(1, std::memory_order_relaxed);
+	void *p = malloc(Size ? Size : 1);
+	return p;
+}
+
+void *operator new(size_t Size)
+{
+	void *p = CountedAlloc(Size);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t Size)
+{
+	void *p = CountedAlloc(Size);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new(size_t Size, const std::nothrow_t &) noexcept
+{
+	return CountedAlloc(Size);
+}
+
+void *operator new[](size_t Size, const std::nothrow_t &) noexcept
+{
+	return CountedAlloc(Size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
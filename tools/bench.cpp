@@ -0,0 +1,292 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin, microbenchmarks
+ * Author:   Dipl.Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+// ns/op and heap allocations/op of the decoders, the checksum, the RMC
+// rewrite and the construction of the command sentences. Every function runs
+// on representative sentences and on broken ones (truncated, no commas, no
+// hex, long garbage), the result is written as JSON.
+
+#include "autopilotcore.h"
+#include "alloccount.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+static volatile size_t s_Consumed; // keeps the compiler from removing the calls
+
+class NullSink : public AutopilotSink
+{
+public:
+	void PushSentence(const std::string &sentence) { s_Consumed += sentence.length(); }
+	void ShowStatus(const std::string &Text) { s_Consumed += Text.length(); }
+	void ShowCompass(const std::string &Text) { s_Consumed += Text.length(); }
+	void ShowNormalColours() {}
+	void ShowAlarmColours() {}
+	void ShowParameter(int, int Value) { s_Consumed += Value; }
+	void LogMessage(const std::string &) {}
+	void LogInfo(const std::string &) {}
+};
+
+struct BenchResult
+{
+	std::string	Name;
+	std::string	Input;
+	uint64_t	Iterations;
+	double		NsPerOp;
+	double		AllocsPerOp;
+};
+
+struct BenchOptions
+{
+	double		MinTime;		// seconds per repetition
+	int			Repetitions;
+	const char	*Filter;
+};
+
+static std::string JsonString(const std::string &s)
+{
+	std::string Out = "\"";
+	for (size_t i = 0; i < s.length(); i++)
+	{
+		unsigned char c = (unsigned char)s[i];
+		if (c == '"' || c == '\\')
+		{
+			Out += '\\';
+			Out += (char)c;
+		}
+		else if (c < 0x20 || c >= 0x7F)
+		{
+			char Buffer[8];
+			snprintf(Buffer, sizeof(Buffer), "\\u%04x", c);
+			Out += Buffer;
+		}
+		else
+			Out += (char)c;
+	}
+	return Out + "\"";
+}
+
+// Runs Function in growing batches until one batch takes MinTime, then keeps
+// the fastest of the repetitions. Allocations are counted over the same batch.
+static void Bench(const BenchOptions &Options, std::vector<BenchResult> &Results,
+	const char *Name, const char *Label, const std::string &Input,
+	const std::function<void(const std::string &)> &Function)
+{
+	std::string FullName = std::string(Name) + "/" + Label;
+	if (Options.Filter && FullName.find(Options.Filter) == std::string::npos)
+		return;
+
+	typedef std::chrono::steady_clock Clock;
+	uint64_t Iterations = 1;
+	for (;;)
+	{
+		Clock::time_point Begin = Clock::now();
+		for (uint64_t i = 0; i < Iterations; i++)
+			Function(Input);
+		double Seconds = std::chrono::duration<double>(Clock::now() - Begin).count();
+		if (Seconds >= Options.MinTime || Iterations >= (1ULL << 32))
+			break;
+		Iterations *= Seconds < Options.MinTime / 16 ? 8 : 2;
+	}
+
+	BenchResult Result;
+	Result.Name = FullName;
+	Result.Input = Input;
+	Result.Iterations = Iterations;
+	Result.NsPerOp = 0;
+	Result.AllocsPerOp = 0;
+	for (int r = 0; r < Options.Repetitions; r++)
+	{
+		unsigned long long Allocations = AllocationCount();
+		Clock::time_point Begin = Clock::now();
+		for (uint64_t i = 0; i < Iterations; i++)
+			Function(Input);
+		double Ns = std::chrono::duration<double, std::nano>(Clock::now() - Begin).count() / Iterations;
+		Allocations = AllocationCount() - Allocations;
+		if (r == 0 || Ns < Result.NsPerOp)
+			Result.NsPerOp = Ns;
+		Result.AllocsPerOp = (double)Allocations / Iterations;
+	}
+	fprintf(stderr, "%-44s %10.1f ns/op %8.2f allocs/op\n", FullName.c_str(), Result.NsPerOp, Result.AllocsPerOp);
+	Results.push_back(Result);
+}
+
+struct BenchInput
+{
+	const char	*Label;
+	const char	*Sentence;
+};
+
+// 0x84 status datagrams as they come from the NMEA <-> Seatalk converter
+static const BenchInput StatusInputs[] =
+{
+	{ "standby",        "$STALK,84,C6,2D,2D,00,00,00,00,00*5F" },
+	{ "auto",           "$STALK,84,46,2D,2D,02,00,00,00,08*4C" },
+	{ "autowind",       "$STALK,84,06,1B,97,06,00,00,00,0F*46" },
+	{ "track_offcourse","$STALK,84,A6,45,13,0A,04,FE,00,08*48" },
+	{ "trailing_crlf",  "$STALK,84,46,2D,2D,02,00,00,00,08*4C  \r\n" },
+	{ "lowercase_hex",  "$STALK,84,c6,2d,2d,02,00,00,00,08*4C" },
+	{ "truncated",      "$STALK,84,46,2D" },
+	{ "no_commas",      "$STALK8446 2D2D0200000008" },
+	{ "no_hex",         "$STALK,84,ZZ,QQ,XX,0Y,0W,RR,SS,TT*00" },
+	{ "empty_fields",   "$STALK,84,,,,,,,,*00" },
+	{ "long_garbage",   "$STALK,84,46,2D,2D,02,00,00,00,08,"
+	                    "0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF"
+	                    "0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF*00" },
+};
+
+static const BenchInput RMBInputs[] =
+{
+	{ "normal",       "$GPRMB,A,0.66,L,003,004,4917.24,N,12309.57,W,001.3,052.5,000.5,V*20" },
+	{ "integer",      "$GPRMB,A,0.66,L,003,004,4917.24,N,12309.57,W,001.3,052,000.5,V*20" },
+	{ "empty_fields", "$GPRMB,V,,,,,,,,,,,,V*00" },
+	{ "truncated",    "$GPRMB,A,0.66,L,003" },
+	{ "no_commas",    "$GPRMB A 0.66 L 003 004" },
+};
+
+static const BenchInput RMCInputs[] =
+{
+	{ "no_variation", "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A*6A" },
+	{ "variation",    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A" },
+	{ "nmea23",       "$GNRMC,123519.00,A,4807.03800,N,01131.00000,E,0.014,,230394,,,D,V*0B" },
+	{ "truncated",    "$GPRMC,123519,A,4807.038" },
+	{ "own_sentence", "$ECRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A*6A" },
+};
+
+static const BenchInput ChecksumInputs[] =
+{
+	{ "keystroke", "$STALK,86,21,07,F8" },
+	{ "status",    "$STALK,84,46,2D,2D,02,00,00,00,08" },
+	{ "rmc",       "$ECRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+	{ "with_star", "$STALK,86,21,07,F8*00" },
+	{ "dollar",    "$" },
+};
+
+#define COUNT(a) (sizeof(a) / sizeof(a[0]))
+
+static void Usage()
+{
+	fprintf(stderr,
+		"usage: autopilot_bench [options]\n"
+		"  -o <file>    write the JSON result to <file> (default stdout)\n"
+		"  -t <ms>      minimum time of one measurement (default 200)\n"
+		"  -r <count>   repetitions, the fastest counts (default 5)\n"
+		"  -f <text>    only benchmarks whose name contains <text>\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *OutputName = NULL;
+	BenchOptions Options;
+	Options.MinTime = 0.2;
+	Options.Repetitions = 5;
+	Options.Filter = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *a = argv[i];
+		bool HasValue = i + 1 < argc;
+		if (!strcmp(a, "-o") && HasValue) OutputName = argv[++i];
+		else if (!strcmp(a, "-t") && HasValue) Options.MinTime = atof(argv[++i]) / 1000.0;
+		else if (!strcmp(a, "-r") && HasValue) Options.Repetitions = atoi(argv[++i]);
+		else if (!strcmp(a, "-f") && HasValue) Options.Filter = argv[++i];
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+	if (Options.Repetitions < 1)
+		Options.Repetitions = 1;
+
+	NullSink Sink;
+	AutopilotCore Core(&Sink);
+	Core.ModyfyRMC = true;
+	Core.BoatVariation = -2.4;
+	std::vector<BenchResult> Results;
+	size_t i;
+
+	for (i = 0; i < COUNT(StatusInputs); i++)
+		Bench(Options, Results, "GetAutopilotMode", StatusInputs[i].Label, StatusInputs[i].Sentence,
+			[&](const std::string &s) { s_Consumed += Core.GetAutopilotMode(s); });
+	for (i = 0; i < COUNT(StatusInputs); i++)
+		Bench(Options, Results, "GetAutopilotCompassCourse", StatusInputs[i].Label, StatusInputs[i].Sentence,
+			[&](const std::string &s) { s_Consumed += Core.GetAutopilotCompassCourse(s).length(); });
+	for (i = 0; i < COUNT(StatusInputs); i++)
+		Bench(Options, Results, "GetAutopilotMAGCourse", StatusInputs[i].Label, StatusInputs[i].Sentence,
+			[&](const std::string &s) { s_Consumed += Core.GetAutopilotMAGCourse(s).length(); });
+	for (i = 0; i < COUNT(StatusInputs); i++)
+		Bench(Options, Results, "GetAutopilotCompassDifferenz", StatusInputs[i].Label, StatusInputs[i].Sentence,
+			[&](const std::string &s) { s_Consumed += Core.GetAutopilotCompassDifferenz(s).length(); });
+	for (i = 0; i < COUNT(RMBInputs); i++)
+		Bench(Options, Results, "GetWaypointBearing", RMBInputs[i].Label, RMBInputs[i].Sentence,
+			[&](const std::string &s) { Core.GetWaypointBearing(s); s_Consumed += Core.WayPointBearing.length(); });
+	for (i = 0; i < COUNT(ChecksumInputs); i++)
+		Bench(Options, Results, "ComputeChecksum", ChecksumInputs[i].Label, ChecksumInputs[i].Sentence,
+			[&](const std::string &s) { s_Consumed += Core.ComputeChecksum(s).length(); });
+	for (i = 0; i < COUNT(RMCInputs); i++)
+		Bench(Options, Results, "AddVariationToRMCanSendOut", RMCInputs[i].Label, RMCInputs[i].Sentence,
+			[&](const std::string &s) { Core.AddVariationToRMCanSendOut(s); });
+
+	// Command sentences, as sent by the buttons of the dialog
+	static const BenchInput KeyInputs[] =
+	{
+		{ "auto", "01" }, { "standby", "02" }, { "plus_10", "08" }, { "autowind", "23" },
+	};
+	for (i = 0; i < COUNT(KeyInputs); i++)
+	{
+		int Key = (int)strtol(KeyInputs[i].Sentence, NULL, 16);
+		Bench(Options, Results, "KeystrokeSentence", KeyInputs[i].Label, KeyInputs[i].Sentence,
+			[&](const std::string &) { s_Consumed += Core.KeystrokeSentence(Key).length(); });
+		Bench(Options, Results, "SendKeystroke", KeyInputs[i].Label, KeyInputs[i].Sentence,
+			[&](const std::string &) { Core.SendKeystroke(Key); });
+	}
+
+	// The whole path of a received status, decoders and state machine together
+	for (i = 0; i < COUNT(StatusInputs); i++)
+		Bench(Options, Results, "SetNMEASentence", StatusInputs[i].Label, StatusInputs[i].Sentence,
+			[&](const std::string &s) { Core.SetNMEASentence(s); });
+
+	FILE *f = stdout;
+	if (OutputName && (f = fopen(OutputName, "w")) == NULL)
+	{
+		fprintf(stderr, "autopilot_bench: cannot write %s\n", OutputName);
+		return 1;
+	}
+	fprintf(f, "{\n  \"benchmarks\": [\n");
+	for (i = 0; i < Results.size(); i++)
+	{
+		const BenchResult &r = Results[i];
+		fprintf(f, "    { \"name\": %s, \"input\": %s, \"iterations\": %llu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.3f }%s\n",
+			JsonString(r.Name).c_str(), JsonString(r.Input).c_str(), (unsigned long long)r.Iterations,
+			r.NsPerOp, r.AllocsPerOp, i + 1 < Results.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+	if (f != stdout)
+		fclose(f);
+	return 0;
+}
@@ -0,0 +1,205 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin, direct connection test
+ * Author:   Dipl.Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+// The plugin logic on a direct connection (serial, pty, TCP, UDP) without
+// OpenCPN, to try a bridge or a socat stand-in:
+//
+//   socat -d -d pty,raw,echo=0 pty,raw,echo=0
+//   autopilot_link serial:/dev/pts/3
+//
+// Every reaction is printed. Keys are read from stdin, one per line:
+// AUTO, STANDBY, TRACK, AUTOWIND, +1, -1, +10, -10 or the key code in hex.
+// With a control socket the remote clients steer as well, try it with
+// autopilot_remote:
+//
+//   autopilot_link serial:/dev/pts/3 STALK unix:/tmp/autopilot
+//   autopilot_remote unix:/tmp/autopilot ../tools/scenarios/remote.txt
+
+#include "autopilotcore.h"
+#include "controlserver.h"
+#include "seatalkconnection.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+class PrintSink : public AutopilotSink
+{
+public:
+	PrintSink(SeatalkConnection &Connection, AutopilotClock &Clock) : m_Connection(Connection), m_Clock(Clock), m_Start(Clock.NowMs()) {}
+
+	void PushSentence(const std::string &sentence)
+	{
+		m_Connection.Send(sentence);
+		std::string s(sentence);
+		while (!s.empty() && (s[s.length() - 1] == '\n' || s[s.length() - 1] == '\r'))
+			s.erase(s.length() - 1);
+		Line("SEND", s);
+	}
+	void ShowStatus(const std::string &Text) { Line("STATUS", Text); }
+	void ShowCompass(const std::string &Text) { Line("COMPASS", Text); }
+	void ShowNormalColours() {}
+	void ShowAlarmColours() { Line("COLOURS", "alarm"); }
+	void ShowParameter(int Parameter, int Value)
+	{
+		char Text[32];
+		snprintf(Text, sizeof(Text), "%d %d", Parameter, Value);
+		Line("PARAMETER", Text);
+	}
+	void LogMessage(const std::string &Text) { Line("MESSAGE", Text); }
+	void LogInfo(const std::string &Text) { Line("INFO", Text); }
+
+	void Line(const char *What, const std::string &Text)
+	{
+		printf("%10.3f %-9s %s\n", (m_Clock.NowMs() - m_Start) / 1000.0, What, Text.c_str());
+		fflush(stdout);
+	}
+
+private:
+	SeatalkConnection	&m_Connection;
+	AutopilotClock		&m_Clock;
+	int64_t				m_Start;
+};
+
+static int KeyByName(const char *Name)
+{
+	static const struct { const char *Name; int Key; } Keys[] =
+	{
+		{ "AUTO", KEY_AUTO }, { "STANDBY", KEY_STANDBY }, { "TRACK", KEY_TRACK }, { "AUTOWIND", KEY_AUTOWIND },
+		{ "-1", KEY_MINUS_1 }, { "-10", KEY_MINUS_10 }, { "+1", KEY_PLUS_1 }, { "+10", KEY_PLUS_10 },
+	};
+	for (size_t i = 0; i < sizeof(Keys) / sizeof(Keys[0]); i++)
+		if (!strcmp(Name, Keys[i].Name))
+			return Keys[i].Key;
+	return (int)strtol(Name, NULL, 16);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: autopilot_link <connection> [name] [control]\n"
+			"  connection: serial:<device>[:baud], seatalk:<device>, tcp:<host>:<port>, udp:<host>:<port>\n"
+			"  control:    unix:<path>, tcp:<port>, tcp:<host>:<port>\n");
+		return 2;
+	}
+	std::string Name = argc > 2 ? argv[2] : "STALK";
+	SeatalkConnection Connection;
+	SteadyClock Clock;
+	PrintSink Sink(Connection, Clock);
+	AutopilotCore Core(&Sink);
+	Core.STALKSendName = Name;
+	Core.STALKReceiveName = Name;
+	Core.WriteMessages = true;
+	Core.StartNoDataTimeout();
+
+	// The notification only wakes up the poll() below.
+	int Wake[2];
+	if (pipe(Wake) != 0)
+		return 1;
+	Connection.SetNotify([&Wake]()
+	{
+		char c = 0;
+		if (write(Wake[1], &c, 1) < 0)
+		{
+		}
+	});
+	if (!Connection.Open(argv[1], Name))
+	{
+		fprintf(stderr, "autopilot_link: %s\n", Connection.Error().c_str());
+		return 1;
+	}
+	ControlServer Control;
+	Control.SetNotify([&Wake]()
+	{
+		char c = 0;
+		if (write(Wake[1], &c, 1) < 0)
+		{
+		}
+	});
+	if (argc > 3 && !Control.Open(argv[3]))
+	{
+		fprintf(stderr, "autopilot_link: %s\n", Control.Error().c_str());
+		return 1;
+	}
+
+	bool Input = true;
+	while (Input || Connection.Outbound.Size() > 0)
+	{
+		struct pollfd Fds[2];
+		Fds[0].fd = Wake[0];
+		Fds[0].events = POLLIN;
+		Fds[1].fd = Input ? 0 : -1;
+		Fds[1].events = POLLIN;
+		poll(Fds, 2, 250);
+		if (Fds[0].revents & POLLIN)
+		{
+			char Buffer[64];
+			if (read(Wake[0], Buffer, sizeof(Buffer)) < 0)
+			{
+			}
+		}
+		std::string sentence;
+		while (Connection.Receive(sentence))
+		{
+			Sink.Line("RECEIVE", sentence);
+			Core.SetNMEASentence(sentence);
+		}
+		if (Input && (Fds[1].revents & (POLLIN | POLLHUP)))
+		{
+			char Line[64];
+			if (fgets(Line, sizeof(Line), stdin) == NULL)
+				Input = false;
+			else
+			{
+				Line[strcspn(Line, "\r\n")] = 0;
+				if (Line[0])
+					Core.SendKeystroke(KeyByName(Line));
+			}
+		}
+		int Client;
+		RemoteCommand Command;
+		while (Control.Receive(Client, Command))
+		{
+			std::string Error;
+			if (!Control.Arbitrate(Client, Command, Clock.NowMs()))
+				Error = "another client has control";
+			else
+				Core.Execute(Command, Error);
+			Sink.Line("REMOTE", std::string(RemoteCommand::MethodName(Command.Method)) + " " + (Error.empty() ? "ok" : Error));
+			if (!Command.Id.empty())	// a notification is not answered
+				Control.Reply(Client, Error.empty() ? Command.Reply() : Command.Reply(REMOTE_REFUSED, Error));
+		}
+		Control.Publish(Core.StateJSON());
+		Core.Poll();
+	}
+	Control.Close();
+	usleep(200000);
+	Connection.Close();
+	fprintf(stderr, "in %llu bytes  out %llu bytes  overruns %llu  dropped %llu\n",
+		(unsigned long long)Connection.BytesIn, (unsigned long long)Connection.BytesOut,
+		(unsigned long long)Connection.Inbound.Overruns, (unsigned long long)Connection.Outbound.Dropped);
+	return 0;
+}
@@ -0,0 +1,200 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin, control socket client
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+// Scripted client of the control socket, for autopilot_link or the plugin
+// with "ControlSocket" in the config:
+//
+//   autopilot_remote unix:/tmp/autopilot ../tools/scenarios/remote.txt
+//
+// The script has one JSON-RPC request per line, "sleep <ms>" and comments
+// with '#'. Without a script the requests are read from stdin. Everything
+// sent and received is printed. The script can check the answers:
+//
+//   expect <line>   this line must come back before the end
+//   never <text>    no line that comes back may contain the text
+//
+// The exit status is 1 when a check fails.
+
+#include "autopilotclock.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <string>
+#include <vector>
+
+static int Connect(const std::string &Spec)
+{
+	if (Spec.compare(0, 5, "unix:") == 0)
+	{
+		struct sockaddr_un Address;
+		memset(&Address, 0, sizeof(Address));
+		Address.sun_family = AF_UNIX;
+		strncpy(Address.sun_path, Spec.c_str() + 5, sizeof(Address.sun_path) - 1);
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd >= 0 && connect(fd, (struct sockaddr *)&Address, sizeof(Address)) != 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+		return fd;
+	}
+	if (Spec.compare(0, 4, "tcp:") != 0)
+		return -1;
+	std::string Host = "127.0.0.1", Port = Spec.substr(4);
+	size_t Colon = Port.rfind(':');
+	if (Colon != std::string::npos)
+	{
+		Host = Port.substr(0, Colon);
+		Port = Port.substr(Colon + 1);
+	}
+	struct addrinfo Hints, *pResult = NULL;
+	memset(&Hints, 0, sizeof(Hints));
+	Hints.ai_family = AF_UNSPEC;
+	Hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(Host.c_str(), Port.c_str(), &Hints, &pResult) != 0 || pResult == NULL)
+		return -1;
+	int fd = socket(pResult->ai_family, pResult->ai_socktype, pResult->ai_protocol);
+	if (fd >= 0 && connect(fd, pResult->ai_addr, pResult->ai_addrlen) != 0)
+	{
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(pResult);
+	return fd;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: autopilot_remote <unix:path | tcp:[host:]port> [script]\n");
+		return 2;
+	}
+	int fd = Connect(argv[1]);
+	if (fd < 0)
+	{
+		fprintf(stderr, "autopilot_remote: cannot connect to %s\n", argv[1]);
+		return 1;
+	}
+	FILE *Script = argc > 2 ? fopen(argv[2], "r") : stdin;
+	if (Script == NULL)
+	{
+		fprintf(stderr, "autopilot_remote: cannot read %s\n", argv[2]);
+		return 1;
+	}
+
+	SteadyClock Clock;
+	int64_t Start = Clock.NowMs();
+	int64_t Next = Start;		// of the next script line
+	int64_t End = -1;			// after the script, the last answers
+	std::string In;
+	std::vector<std::string> Received, Expected, Never;
+	while (End < 0 || Clock.NowMs() < End)
+	{
+		int64_t Now = Clock.NowMs();
+		if (End < 0 && Now >= Next)
+		{
+			char Line[1100];
+			if (fgets(Line, sizeof(Line), Script) == NULL)
+			{
+				End = Now + 1000;
+				continue;
+			}
+			Line[strcspn(Line, "\r\n")] = 0;
+			if (Line[0] == 0 || Line[0] == '#')
+				continue;
+			if (strncmp(Line, "sleep ", 6) == 0)
+			{
+				Next = Now + atoi(Line + 6);
+				continue;
+			}
+			if (strncmp(Line, "expect ", 7) == 0)
+			{
+				Expected.push_back(Line + 7);
+				continue;
+			}
+			if (strncmp(Line, "never ", 6) == 0)
+			{
+				Never.push_back(Line + 6);
+				continue;
+			}
+			printf("%10.3f SEND    %s\n", (Now - Start) / 1000.0, Line);
+			fflush(stdout);
+			strcat(Line, "\n");
+			if (write(fd, Line, strlen(Line)) < 0)
+				break;
+			continue;
+		}
+		struct pollfd Fds;
+		Fds.fd = fd;
+		Fds.events = POLLIN;
+		Fds.revents = 0;
+		int64_t Wait = End < 0 ? Next - Now : End - Now;
+		poll(&Fds, 1, (int)(Wait > 0 ? Wait : 0));
+		if (!(Fds.revents & (POLLIN | POLLHUP)))
+			continue;
+		char Buffer[4096];
+		ssize_t Count = read(fd, Buffer, sizeof(Buffer));
+		if (Count <= 0)
+		{
+			printf("%10.3f CLOSED\n", (Clock.NowMs() - Start) / 1000.0);
+			break;
+		}
+		In.append(Buffer, Count);
+		size_t Eol;
+		while ((Eol = In.find('\n')) != std::string::npos)
+		{
+			Received.push_back(In.substr(0, Eol));
+			printf("%10.3f RECEIVE %s\n", (Clock.NowMs() - Start) / 1000.0, Received.back().c_str());
+			In.erase(0, Eol + 1);
+		}
+		fflush(stdout);
+	}
+	close(fd);
+
+	int Failed = 0;
+	for (size_t i = 0; i < Expected.size(); i++)
+	{
+		size_t j = 0;
+		while (j < Received.size() && Received[j] != Expected[i])
+			j++;
+		if (j == Received.size())
+		{
+			fprintf(stderr, "autopilot_remote: not received %s\n", Expected[i].c_str());
+			Failed++;
+		}
+	}
+	for (size_t i = 0; i < Never.size(); i++)
+		for (size_t j = 0; j < Received.size(); j++)
+			if (Received[j].find(Never[i]) != std::string::npos)
+			{
+				fprintf(stderr, "autopilot_remote: received %s\n", Received[j].c_str());
+				Failed++;
+			}
+	return Failed ? 1 : 0;
+}
@@ -0,0 +1,796 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin, replay harness
+ * Author:   Dipl.Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+// Runs a recorded sentence log through the decoder and state machine without
+// OpenCPN and without a display. The dialog, the log and PushNMEABuffer are
+// replaced by a stub sink, which writes every reaction as one line of a trace.
+// Two runs with the same log must give the same trace.
+//
+// Input is a text log (one NMEA sentence per line, e.g. from the OpenCPN
+// NMEA debug window), a session file written by the capture (see README.md)
+// or with -B a raw 9 bit Seatalk stream, e.g. read from a pty. Only inbound
+// sentences of a capture are replayed.
+//
+// With -S the log is replaced by the course computer simulator (seatalksim.h)
+// and a scenario file of button presses and faults. The loop is closed, the
+// sentences of the plugin go to the simulator. At the end the command latency
+// (sent by the plugin until the first 0x84 showing it) and the time to
+// recover from a spurious standby are printed.
+// A passage (position, waypoint) moves the boat with the heading of the
+// simulator along a route, with RMB and position fixes like from OpenCPN
+// every second, to try the track control. The XTE is traced every 30 s.
+
+#include "autopilotcore.h"
+#include "sentencecapture.h"
+#include "alloccount.h"
+#include "seatalksim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define POLL_NS				250000000ULL	// AUTOPILOT_POLL_MS of the plugin
+#define ANIMATION_NS		33000000ULL		// AUTOPILOT_ANIMATION_MS of the plugin
+#define SIM_TICK_NS			10000000ULL		// time step of the simulation
+
+#define SEATALK_CHAR_NS		2291667ULL		// 11 bit at 4800 baud
+#define FIX_NS				1000000000ULL	// RMB and position fix of a passage
+#define PASSAGE_TRACE_NS	30000000000ULL
+
+struct ReplaySentence
+{
+	uint64_t		time_ns;
+	std::string		sentence;
+	bool			IsDatagram;		// binary Seatalk, Datagram instead of sentence
+	SeatalkDatagram	Datagram;
+};
+
+class ReplaySink : public AutopilotSink
+{
+public:
+	ReplaySink(FILE *pTrace) : Sent(0), Unexpected(0), pSim(NULL), m_pTrace(pTrace), m_Now(0) {}
+
+	void SetTime(uint64_t Now) { m_Now = Now; }
+
+	void PushSentence(const std::string &sentence)
+	{
+		Sent++;
+		std::string s(sentence);
+		while (!s.empty() && (s[s.length() - 1] == '\n' || s[s.length() - 1] == '\r'))
+			s.erase(s.length() - 1);
+		Line("SEND", s.c_str());
+		if (pSim)
+			pSim->Receive(m_Now, sentence);
+	}
+	void ShowStatus(const std::string &Text) { Changed("STATUS", Text, m_Status); }
+	void ShowCompass(const std::string &Text) { Changed("COMPASS", Text, m_Compass); }
+	void ShowNormalColours() { Changed("COLOURS", "normal", m_Colours); }
+	void ShowAlarmColours() { Line("COLOURS", "alarm"); }	// background, the normal colours are the text
+	void ShowParameter(int Parameter, int Value)
+	{
+		char Text[32];
+		snprintf(Text, sizeof(Text), "%d %d", Parameter, Value);
+		Line("PARAMETER", Text);
+	}
+	void LogMessage(const std::string &Text) { Line("MESSAGE", Text.c_str()); }
+	void LogInfo(const std::string &Text) { Line("INFO", Text.c_str()); }
+
+	void Line(const char *What, const char *Text)
+	{
+		if (m_pTrace)
+			fprintf(m_pTrace, "%10.3f %-9s %s\n", m_Now / 1e9, What, Text);
+	}
+
+	uint64_t			Sent;
+	uint64_t			Unexpected;		// expect of the scenario not met
+	CourseComputerSim	*pSim;
+
+private:
+	// The dialog is redrawn with every 0x84, only the changes are of interest.
+	void Changed(const char *What, const std::string &Text, std::string &Last)
+	{
+		if (Text == Last)
+			return;
+		Last = Text;
+		Line(What, Text.c_str());
+	}
+
+	FILE		*m_pTrace;
+	uint64_t	m_Now;
+	std::string	m_Status;
+	std::string	m_Compass;
+	std::string	m_Colours;
+};
+
+static bool ReadCapture(FILE *f, std::vector<ReplaySentence> &Sentences)
+{
+	CaptureFileHeader Header;
+	if (fread(&Header, sizeof(Header), 1, f) != 1 || memcmp(Header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0)
+		return false;
+	fseek(f, (long)Header.header_size, SEEK_SET);
+	CaptureRecordHeader Record;
+	std::vector<char> Buffer;
+	while (fread(&Record, sizeof(Record), 1, f) == 1)
+	{
+		if (Record.time_ns == 0 && Record.length == 0)
+			break;
+		size_t Padded = (Record.length + 7) & ~(size_t)7;
+		Buffer.resize(Padded);
+		if (Padded && fread(&Buffer[0], 1, Padded, f) != Padded)
+			break;
+		if (Record.direction != CAPTURE_INBOUND)
+			continue;
+		ReplaySentence s;
+		s.IsDatagram = false;
+		s.time_ns = Record.time_ns;
+		s.sentence.assign(Buffer.empty() ? "" : &Buffer[0], Record.length);
+		Sentences.push_back(s);
+	}
+	return true;
+}
+
+static void ReadText(FILE *f, uint64_t Interval_ns, std::vector<ReplaySentence> &Sentences)
+{
+	char Line[1024];
+	uint64_t Now = 0;
+	while (fgets(Line, sizeof(Line), f))
+	{
+		// Take the sentence from the first '$' or '!', the debug window puts text in front.
+		char *p = Line;
+		while (*p && *p != '$' && *p != '!')
+			p++;
+		if (*p == 0)
+			continue;
+		ReplaySentence s;
+		s.IsDatagram = false;
+		s.time_ns = Now;
+		s.sentence = p;
+		Sentences.push_back(s);
+		Now += Interval_ns;
+	}
+}
+
+// Feeds the core like the plugin does. The core runs on a virtual clock, which
+// follows the log time, and is polled like by localTimer in the plugin.
+// With Animation the compass is animated like by animationTimer.
+class Feeder
+{
+public:
+	Feeder(AutopilotCore &Core, ReplaySink &Sink)
+		: Frames(0), Animation(false), AnimationFrames(0), m_Core(Core), m_Sink(Sink), m_NextPoll(0),
+		  m_NextFrame(0), m_Animating(false), m_LastStatus(Core.Autopilot_Status)
+	{
+		m_Core.SetClock(&m_Clock);
+		m_Core.StartNoDataTimeout();
+	}
+
+	void Tick(uint64_t Now)
+	{
+		while (m_NextPoll <= Now)
+		{
+			SetTime(m_NextPoll);
+			m_Core.Poll();
+			TraceMode();
+			m_NextPoll += POLL_NS;
+		}
+		while (m_Animating && m_NextFrame <= Now)
+		{
+			SetTime(m_NextFrame);
+			m_Animating = m_Core.Animate();
+			AnimationFrames += m_Animating;
+			m_NextFrame += ANIMATION_NS;
+		}
+		SetTime(Now);
+	}
+
+	void Deliver(uint64_t Now, const std::string &sentence)
+	{
+		Tick(Now);
+		Frames++;
+		m_Core.SetNMEASentence(sentence);
+		TraceMode();
+		if (Animation && !m_Animating && m_Core.IsTurning())
+		{
+			m_Animating = true;
+			m_NextFrame = Now + ANIMATION_NS;
+		}
+	}
+
+	void Deliver(uint64_t Now, const SeatalkDatagram &Datagram)
+	{
+		Tick(Now);
+		Frames++;
+		m_Core.SetDatagram(Datagram);
+		TraceMode();
+	}
+
+	uint64_t	Frames;
+	bool		Animation;
+	uint64_t	AnimationFrames;
+
+private:
+	void SetTime(uint64_t Now)
+	{
+		m_Clock.Set((int64_t)(Now / 1000000ULL));
+		m_Sink.SetTime(Now);
+	}
+
+	void TraceMode()
+	{
+		if (m_Core.Autopilot_Status == m_LastStatus)
+			return;
+		char Text[32];
+		snprintf(Text, sizeof(Text), "%d -> %d", m_LastStatus, m_Core.Autopilot_Status);
+		m_Sink.Line("MODE", Text);
+		m_LastStatus = m_Core.Autopilot_Status;
+	}
+
+	AutopilotCore	&m_Core;
+	ReplaySink		&m_Sink;
+	VirtualClock	m_Clock;
+	uint64_t		m_NextPoll;
+	uint64_t		m_NextFrame;
+	bool			m_Animating;
+	int				m_LastStatus;
+};
+
+struct ScenarioEvent
+{
+	uint64_t	Time;
+	std::string	Action;
+	std::string	Argument;
+};
+
+// One event per line: <seconds> <action> [argument], # starts a comment.
+static bool ReadScenario(const char *Name, std::vector<ScenarioEvent> &Events)
+{
+	FILE *f = fopen(Name, "r");
+	if (f == NULL)
+		return false;
+	char Line[256];
+	while (fgets(Line, sizeof(Line), f))
+	{
+		char *Comment = strchr(Line, '#');
+		if (Comment)
+			*Comment = 0;
+		double Seconds;
+		char Action[64], Argument[64] = "";
+		if (sscanf(Line, "%lf %63s %63s", &Seconds, Action, Argument) < 2)
+			continue;
+		ScenarioEvent e;
+		e.Time = (uint64_t)llround(Seconds * 1e9);
+		e.Action = Action;
+		e.Argument = Argument;
+		Events.push_back(e);
+	}
+	fclose(f);
+	struct ByTime
+	{
+		bool operator()(const ScenarioEvent &a, const ScenarioEvent &b) const { return a.Time < b.Time; }
+	};
+	std::stable_sort(Events.begin(), Events.end(), ByTime());
+	return true;
+}
+
+static int KeyByName(const std::string &Name)
+{
+	static const struct { const char *Name; int Key; } Keys[] =
+	{
+		{ "AUTO", KEY_AUTO }, { "STANDBY", KEY_STANDBY }, { "TRACK", KEY_TRACK }, { "AUTOWIND", KEY_AUTOWIND },
+		{ "-1", KEY_MINUS_1 }, { "-10", KEY_MINUS_10 }, { "+1", KEY_PLUS_1 }, { "+10", KEY_PLUS_10 },
+	};
+	for (size_t i = 0; i < sizeof(Keys) / sizeof(Keys[0]); i++)
+		if (Name == Keys[i].Name)
+			return Keys[i].Key;
+	return (int)strtol(Name.c_str(), NULL, 16);
+}
+
+// <name><=|<|><value>, the outcome so far. mode is the mode of the plugin,
+// course and heading those of the course computer. Actual is what it is.
+static bool Expect(const std::string &Argument, AutopilotCore &Core, CourseComputerSim &Sim, PassageSim &Passage, std::string &Actual)
+{
+	static const char *Modes[] = { "unknown", "auto", "standby", "autowind", "track", "windshift", "autotrack", "offcourse" };
+	size_t Op = Argument.find_first_of("=<>");
+	if (Op == std::string::npos || Op == 0)
+		return false;
+	std::string Name = Argument.substr(0, Op);
+	std::string Text = Argument.substr(Op + 1);
+	double Value;
+	if (Name == "mode")
+	{
+		Actual = Core.Autopilot_Status >= 0 && Core.Autopilot_Status <= OFFCOURSE ? Modes[Core.Autopilot_Status] : "unknown";
+		return Argument[Op] == '=' && Text == Actual;
+	}
+	else if (Name == "course") Value = Sim.LockedCourse;
+	else if (Name == "heading") Value = Sim.Heading;
+	else if (Name == "target") Value = Core.TargetCourse();
+	else if (Name == "dodging") Value = Core.IsDodging() ? 1 : 0;
+	else if (Name == "failed") Value = (double)Core.FailedCommands;
+	else if (Name == "echoes") Value = (double)Core.EchoesSuppressed;
+	else if (Name == "keyslost") Value = (double)Sim.KeysLost;
+	else if (Name == "recovered") Value = (double)Sim.StandbyRecovery_ns.size();
+	else if (Name == "standbypending") Value = Sim.StandbyPending;
+	else if (Name == "confirmed") Value = (double)Core.Parameters.Confirmed;
+	else if (Name == "writefailures") Value = (double)Core.Parameters.WriteFailures;
+	else if (Name == "response") Value = Sim.Response;
+	else if (Name == "ruddergain") Value = Sim.RudderGain;
+	else if (Name == "seastate") Value = (double)Core.SeaState.Changes;
+	else if (Name == "legs") Value = (double)Passage.LegsDone;
+	else if (Name == "xte") Value = fabs(Passage.Xte());
+	else if (Name == "maxxte") Value = Passage.MaxXte;
+	else
+		return false;
+	char Buffer[32];
+	snprintf(Buffer, sizeof(Buffer), "%g", Value);
+	Actual = Buffer;
+	double Wanted = atof(Text.c_str());
+	if (Argument[Op] == '<')
+		return Value < Wanted;
+	if (Argument[Op] == '>')
+		return Value > Wanted;
+	return Value == Wanted;
+}
+
+static bool RunEvent(const ScenarioEvent &e, AutopilotCore &Core, CourseComputerSim &Sim, PassageSim &Passage, ReplaySink &Sink)
+{
+	double Value = atof(e.Argument.c_str());
+	// <a>,<b> of position, waypoint, current and dodge
+	double Second = 0;
+	size_t Comma = e.Argument.find(',');
+	if (Comma != std::string::npos)
+		Second = atof(e.Argument.c_str() + Comma + 1);
+	Sink.Line("SCENARIO", (e.Argument.empty() ? e.Action : e.Action + " " + e.Argument).c_str());
+	if (e.Action == "key")
+	{
+		int Key = KeyByName(e.Argument);
+		if (Key == KEY_STANDBY)
+		{
+			// as Dlg::OnStandby
+			Core.StandbySelfPressed = true;
+			Core.Standbycommandreceived = true;
+			Core.NeedCompassCorrection = false;
+		}
+		Core.SendKeystroke(Key);
+	}
+	else if (e.Action == "change")
+	{
+		// as a held +-1 or +-10 button, collected and sent at once
+		Core.NeedCompassCorrection = false;
+		Core.AddCourseChange((int)Value);
+		Core.SendCourseChange();
+	}
+	else if (e.Action == "steer")
+	{
+		// as the heading of the dialog or a remote client
+		if (!Core.SteerTo((int)Value))
+			fprintf(stderr, "autopilot_replay: cannot steer to %s, not in auto\n", e.Argument.c_str());
+	}
+	else if (e.Action == "dodge")
+	{
+		// <change>,<seconds>, as the right click of the dialog or a remote client
+		if (!Core.Dodge((int)Value, (int)Second))
+			fprintf(stderr, "autopilot_replay: cannot dodge %s, not in auto\n", e.Argument.c_str());
+	}
+	else if (e.Action == "resume") Core.EndDodge();
+	else if (e.Action == "state") Sink.Line("STATE", Core.StateJSON().c_str());
+	else if (e.Action == "response") Core.WriteParameter(PARAMETER_RESPONSE, (int)Value);
+	else if (e.Action == "windtrim") Core.WriteParameter(PARAMETER_WINDTRIM, (int)Value);
+	else if (e.Action == "ruddergain") Core.WriteParameter(PARAMETER_RUDDERGAIN, (int)Value);
+	else if (e.Action == "parameter")
+	{
+		// <name>=<value>, a row of ParameterTable
+		size_t Equal = e.Argument.find('=');
+		int Parameter = ParameterTable::Find(e.Argument.substr(0, Equal));
+		if (Parameter == 0 || Equal == std::string::npos || !Core.WriteParameter(Parameter, atoi(e.Argument.c_str() + Equal + 1)))
+			fprintf(stderr, "autopilot_replay: cannot set parameter %s\n", e.Argument.c_str());
+	}
+	else if (e.Action == "profile")
+	{
+		// <name>:<name>=<value>,..., as a profile of the config
+		SteeringProfile Profile;
+		size_t Colon = e.Argument.find(':');
+		Profile.Name = e.Argument.substr(0, Colon);
+		if (Colon == std::string::npos || !Profile.Parse(e.Argument.substr(Colon + 1)))
+			fprintf(stderr, "autopilot_replay: cannot read profile %s\n", e.Argument.c_str());
+		else
+			Core.ApplyProfile(Profile);
+	}
+	else if (e.Action == "standby") Sim.SpuriousStandby(e.Time);
+	else if (e.Action == "offcourse") Sim.OffCourse(Value);
+	else if (e.Action == "windshift") Sim.WindShift(Value);
+	else if (e.Action == "heading") Sim.Heading = Value;
+	else if (e.Action == "sea") Sim.SeaState = Value;
+	else if (e.Action == "loss") Sim.LossProbability = Value;
+	else if (e.Action == "duplicate") Sim.DuplicateProbability = Value;
+	else if (e.Action == "keyloss") Sim.KeyLossProbability = Value;
+	else if (e.Action == "silent") Sim.LossProbability = Value > 0 ? 1.0 : 0.0;
+	else if (e.Action == "position") Passage.Start(Value, Second);
+	else if (e.Action == "waypoint") Passage.AddWaypoint(Value, Second);
+	else if (e.Action == "speed") Passage.Speed = Value;
+	else if (e.Action == "current")
+	{
+		Passage.CurrentSet = Value;
+		Passage.CurrentDrift = Second;
+	}
+	else if (e.Action == "track")
+	{
+		// <seconds> between the changes, 0 is off
+		Core.Track.Enabled = Value > 0;
+		if (Value > 0)
+			Core.Track.MinIntervalMs = (int64_t)(Value * 1000);
+	}
+	else if (e.Action == "expect")
+	{
+		std::string Actual = "?";
+		bool Ok = Expect(e.Argument, Core, Sim, Passage, Actual);
+		Sink.Line("EXPECT", ((Ok ? "ok " : "failed ") + Actual).c_str());
+		if (!Ok)
+		{
+			Sink.Unexpected++;
+			fprintf(stderr, "autopilot_replay: %.0f s expect %s failed, is %s\n", e.Time / 1e9, e.Argument.c_str(), Actual.c_str());
+		}
+	}
+	else if (e.Action == "end") return false;
+	else fprintf(stderr, "autopilot_replay: unknown scenario action %s\n", e.Action.c_str());
+	return true;
+}
+
+static bool WriteTelemetry(const char *Name, const TelemetryRing &Telemetry)
+{
+	FILE *f = fopen(Name, "w");
+	if (!f)
+		return false;
+	fprintf(f, "level,time_first,time_last,count,heading,locked,error_min,error_max,rudder_min,rudder_max,flags\n");
+	for (int l = 0; l < TELEMETRY_LEVELS; l++)
+		for (size_t i = 0; i < Telemetry.Size(l); i++)
+		{
+			const TelemetryBucket &b = Telemetry.At(l, i);
+			fprintf(f, "%d,%.3f,%.3f,%u,%d,%d,%d,%d,%d,%d,0x%02X\n", l, b.TimeFirst / 1000.0, b.TimeLast / 1000.0,
+				(unsigned)b.Count, b.Heading, b.LockedCourse, b.ErrorMin, b.ErrorMax, b.RudderMin, b.RudderMax, b.Flags);
+		}
+	fclose(f);
+	return true;
+}
+
+static void PrintTimes(const char *What, std::vector<uint64_t> Times)
+{
+	if (Times.empty())
+	{
+		fprintf(stderr, "%s: none\n", What);
+		return;
+	}
+	std::sort(Times.begin(), Times.end());
+	double Sum = 0;
+	for (size_t i = 0; i < Times.size(); i++)
+		Sum += Times[i];
+	fprintf(stderr, "%s: %lu  min %.3f s  median %.3f s  mean %.3f s  max %.3f s\n", What,
+		(unsigned long)Times.size(), Times.front() / 1e9, Times[Times.size() / 2] / 1e9,
+		Sum / Times.size() / 1e9, Times.back() / 1e9);
+}
+
+// Raw 9 bit Seatalk as recorded from a serial port or a pty. The time is taken
+// from the position in the stream.
+static void ReadBinary(FILE *f, bool Words, std::vector<ReplaySentence> &Sentences, SeatalkFramer &Framer)
+{
+	unsigned char Buffer[4096];
+	uint64_t Position = 0;
+	size_t Count;
+	while ((Count = fread(Buffer, 1, sizeof(Buffer), f)) > 0)
+	{
+		for (size_t i = 0; i < Count; i++, Position++)
+		{
+			auto Add = [&](const SeatalkDatagram &Datagram)
+			{
+				ReplaySentence s;
+				s.time_ns = (Words ? Position / 2 : Position) * SEATALK_CHAR_NS;
+				s.IsDatagram = true;
+				s.Datagram = Datagram;
+				Sentences.push_back(s);
+			};
+			if (Words)
+				Framer.PushWords(&Buffer[i], 1, Add);
+			else
+				Framer.PushMarked(&Buffer[i], 1, Add);
+		}
+	}
+}
+
+static void Usage()
+{
+	fprintf(stderr,
+		"usage: autopilot_replay [options] <log file>\n"
+		"       autopilot_replay [options] -S <scenario>\n"
+		"  -o <file>   write the trace to <file> (default stdout, - for none)\n"
+		"  -s <speed>  replay speed, 1 = real time, 0 = as fast as possible (default 0)\n"
+		"  -T <file>   write the steering telemetry of the 0x84 as CSV to <file>\n"
+		"  -A          animate the compass text between the 0x84 while turning\n"
+		"  -i <ms>     time between the lines of a text log (default 100)\n"
+		"  -n <name>   Seatalk sentence name (default STALK)\n"
+		"  -B <format> the log is binary Seatalk: marked (0xFF 0x00 before a command byte,\n"
+		"              like a tty with PARMRK) or words (16 bit, bit 8 is the command bit)\n"
+		"  -m          write messages (WriteMessages)\n"
+		"  -d          write debug messages (WriteDebug)\n"
+		"  -a          new auto after standby (NewAutoOnStandby)\n"
+		"  -l          change value to last (ChangeValueToLast)\n"
+		"  -r <count>  resend standby after <count> sentences (NewStandbyNoStandbyReceived)\n"
+		"  -t <s>      send track <s> seconds after the next waypoint (SendTrack)\n"
+		"  -R <min>    response from the sea state, at most one change in <min> minutes\n"
+		"  -P <ms>     ask for parameters older than <ms> with the display key (ParameterMaxAge)\n"
+		"simulator:\n"
+		"  -S <file>   run the scenario against the course computer simulator\n"
+		"  -p <ms>     0x84 period of the simulator (default 1000)\n"
+		"  -b <ms>     delay from the plugin to the simulator (default 50)\n"
+		"  -x <seed>   random seed of the simulator (default 1)\n"
+		"  -e          the simulator sends every sentence of the plugin back (OpenCPN multiplexer)\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *TraceName = NULL;
+	const char *TelemetryName = NULL;
+	const char *LogName = NULL;
+	const char *ScenarioName = NULL;
+	const char *BinaryFormat = NULL;
+	double Speed = 0;
+	int Interval_ms = 100, Period_ms = 1000, BusDelay_ms = 50;
+	unsigned Seed = 1;
+	std::string Name = "STALK";
+	bool WriteMessages = false, WriteDebug = false, NewAutoOnStandby = false, ChangeValueToLast = false, Echo = false, Animation = false;
+	int StandbyCount = -1, TrackSeconds = -1, SeaStateMinutes = -1, ParameterMaxAge_ms = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *a = argv[i];
+		bool HasValue = i + 1 < argc;
+		if (!strcmp(a, "-o") && HasValue) TraceName = argv[++i];
+		else if (!strcmp(a, "-T") && HasValue) TelemetryName = argv[++i];
+		else if (!strcmp(a, "-s") && HasValue) Speed = atof(argv[++i]);
+		else if (!strcmp(a, "-i") && HasValue) Interval_ms = atoi(argv[++i]);
+		else if (!strcmp(a, "-n") && HasValue) Name = argv[++i];
+		else if (!strcmp(a, "-m")) WriteMessages = true;
+		else if (!strcmp(a, "-d")) WriteDebug = true;
+		else if (!strcmp(a, "-a")) NewAutoOnStandby = true;
+		else if (!strcmp(a, "-l")) ChangeValueToLast = true;
+		else if (!strcmp(a, "-r") && HasValue) StandbyCount = atoi(argv[++i]);
+		else if (!strcmp(a, "-t") && HasValue) TrackSeconds = atoi(argv[++i]);
+		else if (!strcmp(a, "-S") && HasValue) ScenarioName = argv[++i];
+		else if (!strcmp(a, "-B") && HasValue) BinaryFormat = argv[++i];
+		else if (!strcmp(a, "-p") && HasValue) Period_ms = atoi(argv[++i]);
+		else if (!strcmp(a, "-b") && HasValue) BusDelay_ms = atoi(argv[++i]);
+		else if (!strcmp(a, "-x") && HasValue) Seed = (unsigned)atoi(argv[++i]);
+		else if (!strcmp(a, "-e")) Echo = true;
+		else if (!strcmp(a, "-A")) Animation = true;
+		else if (!strcmp(a, "-R") && HasValue) SeaStateMinutes = atoi(argv[++i]);
+		else if (!strcmp(a, "-P") && HasValue) ParameterMaxAge_ms = atoi(argv[++i]);
+		else if (a[0] != '-' && LogName == NULL) LogName = a;
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+	if ((LogName == NULL) == (ScenarioName == NULL) ||
+		(BinaryFormat && strcmp(BinaryFormat, "marked") && strcmp(BinaryFormat, "words")))
+	{
+		Usage();
+		return 2;
+	}
+
+	std::vector<ReplaySentence> Sentences;
+	std::vector<ScenarioEvent> Events;
+	SeatalkFramer Framer;
+	if (ScenarioName)
+	{
+		if (!ReadScenario(ScenarioName, Events))
+		{
+			fprintf(stderr, "autopilot_replay: cannot open %s\n", ScenarioName);
+			return 1;
+		}
+	}
+	else
+	{
+		FILE *f = fopen(LogName, "rb");
+		if (f == NULL)
+		{
+			fprintf(stderr, "autopilot_replay: cannot open %s\n", LogName);
+			return 1;
+		}
+		if (BinaryFormat)
+			ReadBinary(f, !strcmp(BinaryFormat, "words"), Sentences, Framer);
+		else if (!ReadCapture(f, Sentences))
+		{
+			rewind(f);
+			ReadText(f, (uint64_t)Interval_ms * 1000000ULL, Sentences);
+		}
+		fclose(f);
+	}
+
+	FILE *pTrace = stdout;
+	if (TraceName && !strcmp(TraceName, "-"))
+		pTrace = NULL;
+	else if (TraceName && (pTrace = fopen(TraceName, "w")) == NULL)
+	{
+		fprintf(stderr, "autopilot_replay: cannot write %s\n", TraceName);
+		return 1;
+	}
+
+	ReplaySink Sink(pTrace);
+	AutopilotCore Core(&Sink);
+	Core.STALKSendName = Name;
+	Core.STALKReceiveName = Name;
+	Core.WriteMessages = WriteMessages;
+	Core.WriteDebug = WriteDebug;
+	Core.NewAutoOnStandby = NewAutoOnStandby;
+	Core.ChangeValueToLast = ChangeValueToLast;
+	Core.Parameters.MaxAgeMs = ParameterMaxAge_ms;
+	if (StandbyCount >= 0)
+	{
+		Core.NewStandbyNoStandbyReceived = true;
+		Core.SelectCounterStandby = StandbyCount;
+	}
+	if (TrackSeconds >= 0)
+	{
+		Core.SendTrack = true;
+		Core.TimeToSendNewWaypiont = TrackSeconds;
+	}
+	if (SeaStateMinutes >= 0)
+	{
+		Core.SeaState.Enabled = true;
+		Core.SeaState.MinIntervalMs = SeaStateMinutes * 60000LL;
+	}
+	Feeder Feed(Core, Sink);
+	Feed.Animation = Animation;
+
+	CourseComputerSim Sim(Name);
+	Sim.Seed(Seed);
+	Sim.Period_ns = (uint64_t)Period_ms * 1000000ULL;
+	Sim.BusDelay_ns = (uint64_t)BusDelay_ms * 1000000ULL;
+	Sim.Echo = Echo;
+	std::vector<uint64_t> Latencies;
+	if (ScenarioName)
+		Sink.pSim = &Sim;
+	PassageSim Passage;
+	bool Sailed = false;
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point WallStart = Clock::now();
+	Clock::duration Busy = Clock::duration::zero();
+	unsigned long long AllocationsBefore = AllocationCount();
+
+	if (ScenarioName)
+	{
+		uint64_t End = Events.empty() ? 0 : Events.back().Time;
+		size_t Next = 0;
+		std::vector<SimFrame> Frames;
+		for (uint64_t Now = 0; Now <= End; Now += SIM_TICK_NS)
+		{
+			if (Speed > 0)
+				std::this_thread::sleep_until(WallStart + std::chrono::nanoseconds((uint64_t)(Now / Speed)));
+			Clock::time_point Begin = Clock::now();
+			Feed.Tick(Now);
+			bool Running = true;
+			while (Next < Events.size() && Events[Next].Time <= Now && Running)
+				Running = RunEvent(Events[Next++], Core, Sim, Passage, Sink);
+			Passage.Step(SIM_TICK_NS / 1e9, Sim.Heading);
+			if (Passage.Active() && Now % FIX_NS == 0)
+			{
+				// OpenCPN: RMB to the plugins, then the fix
+				Sailed = true;
+				Feed.Deliver(Now, Passage.RMB());
+				Core.SetPositionFix(Passage.Lat, Passage.Lon, Passage.Cog, Passage.Sog);
+				if (Now % PASSAGE_TRACE_NS == 0)
+				{
+					char Text[96];
+					snprintf(Text, sizeof(Text), "xte %+.3f nm  cog %.0f  sog %.1f  legs %u",
+						Passage.Xte(), Passage.Cog, Passage.Sog, (unsigned)Passage.LegsDone);
+					Sink.Line("PASSAGE", Text);
+				}
+			}
+			Frames.clear();
+			Sim.Run(Now, Frames);
+			for (size_t i = 0; i < Frames.size(); i++)
+			{
+				Feed.Deliver(Frames[i].Time, Frames[i].Sentence);
+				for (size_t c = 0; c < Frames[i].Commands.size(); c++)
+					Latencies.push_back(Frames[i].Time - Frames[i].Commands[c]);
+			}
+			Busy += Clock::now() - Begin;
+			if (!Running)
+				break;
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < Sentences.size(); i++)
+		{
+			const ReplaySentence &s = Sentences[i];
+			if (Speed > 0)
+				std::this_thread::sleep_until(WallStart + std::chrono::nanoseconds((uint64_t)(s.time_ns / Speed)));
+			Clock::time_point Begin = Clock::now();
+			if (s.IsDatagram)
+				Feed.Deliver(s.time_ns, s.Datagram);
+			else
+				Feed.Deliver(s.time_ns, s.sentence);
+			Busy += Clock::now() - Begin;
+		}
+	}
+
+	unsigned long long Allocations = AllocationCount() - AllocationsBefore;
+	double Seconds = std::chrono::duration<double>(Busy).count();
+	uint64_t Frames = Feed.Frames;
+	if (TelemetryName && !WriteTelemetry(TelemetryName, Core.Telemetry))
+		fprintf(stderr, "autopilot_replay: cannot write %s\n", TelemetryName);
+	if (pTrace && pTrace != stdout)
+		fclose(pTrace);
+	fprintf(stderr, "frames %llu  sent %llu  time %.3f s  %.0f frames/s  %.2f allocs/frame\n",
+		(unsigned long long)Frames, (unsigned long long)Sink.Sent, Seconds,
+		Seconds > 0 ? Frames / Seconds : 0.0,
+		Frames ? (double)Allocations / Frames : 0.0);
+	if (Core.StatusFrames > 0)
+		fprintf(stderr, "status 0x84 %llu  repeats skipped %llu (%.1f %%)\n",
+			(unsigned long long)Core.StatusFrames, (unsigned long long)Core.StatusRepeats,
+			100.0 * Core.StatusRepeats / Core.StatusFrames);
+	if (Core.StatusFrames > 0)
+		fprintf(stderr, "steering: %s\n", Core.Statistics.ToJSON().c_str());
+	if (Animation)
+		fprintf(stderr, "animation frames %llu\n", (unsigned long long)Feed.AnimationFrames);
+	fprintf(stderr, "parameters: questions %llu  confirmed %llu  failed %llu\n",
+		(unsigned long long)Core.Parameters.Questions, (unsigned long long)Core.Parameters.Confirmed,
+		(unsigned long long)Core.Parameters.WriteFailures);
+	if (Core.SeaState.Enabled)
+		fprintf(stderr, "sea state: response changes %llu\n", (unsigned long long)Core.SeaState.Changes);
+	if (Core.FailedCommands > 0)
+		fprintf(stderr, "failed commands %llu\n", (unsigned long long)Core.FailedCommands);
+	if (Sim.KeysLost > 0)
+		fprintf(stderr, "keys lost on the bus %llu\n", (unsigned long long)Sim.KeysLost);
+	if (Core.EchoesSuppressed > 0)
+		fprintf(stderr, "echoes suppressed %llu\n", (unsigned long long)Core.EchoesSuppressed);
+	if (BinaryFormat)
+		fprintf(stderr, "seatalk: datagrams %llu  errors %llu\n",
+			(unsigned long long)Framer.Datagrams, (unsigned long long)Framer.Errors);
+	if (ScenarioName)
+	{
+		fprintf(stderr, "simulator: received %llu  ignored %llu  lost %llu  duplicated %llu  echoed %llu\n",
+			(unsigned long long)Sim.Received, (unsigned long long)Sim.Ignored,
+			(unsigned long long)Sim.Lost, (unsigned long long)Sim.Duplicated, (unsigned long long)Sim.Echoed);
+		PrintTimes("command latency", Latencies);
+		PrintTimes("standby recovery", Sim.StandbyRecovery_ns);
+		if (Sim.StandbyPending)
+			fprintf(stderr, "standby not recovered: %d\n", Sim.StandbyPending);
+		if (Sailed)
+			fprintf(stderr, "passage: %.1f nm  legs %u  xte after 5 min of a leg: max %.3f nm  mean %.3f nm  track changes %llu\n",
+				Passage.Distance, (unsigned)Passage.LegsDone, Passage.MaxXte, Passage.Seconds > 0 ? Passage.SumXte / Passage.Seconds : 0.0,
+				(unsigned long long)Core.Track.Corrections);
+		if (Sink.Unexpected > 0)
+		{
+			fprintf(stderr, "expectations failed %llu\n", (unsigned long long)Sink.Unexpected);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+# remote.txt against autopilot_link with a control socket, no bridge: the
+# sentences go to a UDP port nobody listens on.
+#
+#   sh tools/scenarios/remote.sh build-tools/autopilot_link build-tools/autopilot_remote
+#
+# The exit status is the one of autopilot_remote, 1 for a wrong answer.
+
+LINK=$1
+REMOTE=$2
+PORT=${3:-47555}
+SCRIPT=$(dirname "$0")/remote.txt
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+# autopilot_link ends when its stdin ends, the fifo holds it open
+mkfifo "$DIR/in"
+"$LINK" udp:127.0.0.1:$PORT STALK unix:"$DIR/control" < "$DIR/in" > "$DIR/link.txt" 2>&1 &
+LINK_PID=$!
+exec 3> "$DIR/in"
+i=0
+while [ ! -S "$DIR/control" ] && [ $i -lt 50 ]; do
+	sleep 0.1
+	i=$((i + 1))
+done
+
+"$REMOTE" unix:"$DIR/control" "$SCRIPT"
+STATUS=$?
+exec 3>&-
+wait $LINK_PID
+exit $STATUS
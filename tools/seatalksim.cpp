@@ -0,0 +1,504 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin, course computer simulator
+ * Author:   Dipl.Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#include "seatalksim.h"
+#include "autopilotcore.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// 0x84 datagram, see http://www.thomasknauf.de/rap/seatalk2.htm
+#define SIM_MODE_STANDBY	0x00
+#define SIM_MODE_AUTO		0x02
+#define SIM_MODE_VANE		0x04
+#define SIM_MODE_TRACK		0x08
+#define SIM_ALARM_OFFCOURSE	0x04
+#define SIM_ALARM_WINDSHIFT	0x08
+
+static double Wrap360(double Value)
+{
+	Value = fmod(Value, 360.0);
+	return Value < 0 ? Value + 360.0 : Value;
+}
+
+static double Wrap180(double Value)
+{
+	Value = Wrap360(Value);
+	return Value >= 180.0 ? Value - 360.0 : Value;
+}
+
+static bool SplitFields(const std::string &sentence, std::vector<std::string> &Fields)
+{
+	std::string s = sentence;
+	size_t End = s.find_last_not_of(" \t\r\n");
+	s.erase(End == std::string::npos ? 0 : End + 1);
+	size_t Star = s.find('*');
+	if (s.empty() || s[0] != '$' || Star == std::string::npos)
+		return false;
+	unsigned char Checksum = 0;
+	for (size_t i = 1; i < Star; i++)
+		Checksum ^= (unsigned char)s[i];
+	if (strtol(s.substr(Star + 1).c_str(), NULL, 16) != Checksum)
+		return false;
+	Fields.clear();
+	size_t First = 1;
+	for (;;)
+	{
+		size_t Comma = s.find(',', First);
+		if (Comma == std::string::npos || Comma > Star)
+		{
+			Fields.push_back(s.substr(First, Star - First));
+			return true;
+		}
+		Fields.push_back(s.substr(First, Comma - First));
+		First = Comma + 1;
+	}
+}
+
+CourseComputerSim::CourseComputerSim(const std::string &Name)
+	: m_Name(Name), m_Random(1)
+{
+	Period_ns = 1000000000ULL;
+	BusDelay_ns = 50000000ULL;
+	LossProbability = 0;
+	DuplicateProbability = 0;
+	KeyLossProbability = 0;
+	OffCourseLimit = 20;
+	Drift = 0.5;
+	SeaState = 0;
+	Echo = false;
+
+	Mode = STANDBY;
+	Heading = 90;
+	LockedCourse = 90;
+	Wind = 45;
+	Response = 3;
+	RudderGain = 5;
+	WindTrim = 5;
+	WindShiftAlarm = false;
+
+	Received = 0;
+	Ignored = 0;
+	Lost = 0;
+	Duplicated = 0;
+	KeysLost = 0;
+	Echoed = 0;
+	StandbyPending = 0;
+
+	m_NextFrame = 0;
+	m_LastStep = 0;
+	m_StandbyFault = 0;
+	m_Yaw = 0;
+}
+
+void CourseComputerSim::Receive(uint64_t Now, const std::string &sentence)
+{
+	Pending p;
+	p.Time = Now;
+	p.Sentence = sentence;
+	m_Inbound.push_back(p);
+	if (Echo)
+		m_Echoes.push_back(p);
+}
+
+void CourseComputerSim::Run(uint64_t Now, std::vector<SimFrame> &Frames)
+{
+	size_t First = Frames.size();
+	while (!m_Echoes.empty() && m_Echoes.front().Time <= Now)
+	{
+		SimFrame f;
+		f.Time = m_Echoes.front().Time;
+		f.Sentence = m_Echoes.front().Sentence;
+		f.Sentence.erase(f.Sentence.find_last_not_of("\r\n") + 1);
+		m_Echoes.pop_front();
+		Echoed++;
+		Frames.push_back(f);
+	}
+	while (!m_Inbound.empty() && m_Inbound.front().Time + BusDelay_ns <= Now)
+	{
+		Pending p = m_Inbound.front();
+		m_Inbound.pop_front();
+		Apply(p.Time + BusDelay_ns, p, Frames);
+	}
+	while (m_NextFrame <= Now)
+	{
+		Step((m_NextFrame - m_LastStep) / 1e9);
+		m_LastStep = m_NextFrame;
+		if (Chance(LossProbability))
+			Lost++;		// the commands stay unacknowledged until a frame gets through
+		else
+		{
+			SimFrame f;
+			f.Time = m_NextFrame;
+			f.Sentence = StatusSentence();
+			f.Commands.swap(m_Unacknowledged);
+			Frames.push_back(f);
+			if (Chance(DuplicateProbability))
+			{
+				Duplicated++;
+				f.Commands.clear();
+				Frames.push_back(f);
+			}
+		}
+		m_NextFrame += Period_ns;
+	}
+	struct ByTime
+	{
+		bool operator()(const SimFrame &a, const SimFrame &b) const { return a.Time < b.Time; }
+	};
+	std::stable_sort(Frames.begin() + First, Frames.end(), ByTime());
+}
+
+void CourseComputerSim::Apply(uint64_t Now, const Pending &p, std::vector<SimFrame> &Frames)
+{
+	std::vector<std::string> Fields;
+	if (!SplitFields(p.Sentence, Fields) || Fields[0] != m_Name || Fields.size() < 2)
+	{
+		Ignored++;
+		return;
+	}
+	Received++;
+	if (Fields[1] == "86" && Fields.size() >= 5)
+	{
+		int k = (int)strtol(Fields[3].c_str(), NULL, 16);
+		int nk = (int)strtol(Fields[4].c_str(), NULL, 16);
+		if (((k ^ nk) & 0xFF) != 0xFF)
+		{
+			Ignored++;
+			return;
+		}
+		if (KeyLossProbability > 0 && Chance(KeyLossProbability))
+		{
+			KeysLost++;
+			return;
+		}
+		m_Unacknowledged.push_back(p.Time);
+		Key(Now, k, Frames);
+		return;
+	}
+	if (Fields[1] == "92" && Fields.size() >= 5)
+	{
+		int Parameter = (int)strtol(Fields[3].c_str(), NULL, 16);
+		int Value = (int)strtol(Fields[4].c_str(), NULL, 16);
+		const ParameterInfo &Info = ParameterTable::Get(ParameterTable::FindCode(Parameter));
+		if (Info.Code == 0 || Value < Info.Min || Value > Info.Max)
+		{
+			Ignored++;
+			return;
+		}
+		switch (Parameter)
+		{
+			case 0x01: RudderGain = Value; break;
+			case 0x11: WindTrim = Value; break;
+			case 0x12: Response = Value; break;
+			default: Calibration[Parameter] = Value; break;
+		}
+		m_Unacknowledged.push_back(p.Time);
+		return;
+	}
+	Ignored++;
+}
+
+void CourseComputerSim::Key(uint64_t Now, int Key, std::vector<SimFrame> &Frames)
+{
+	SimFrame f;
+	f.Time = Now;
+	WindShiftAlarm = false;		// every key acknowledges the alarm
+	switch (Key)
+	{
+		case KEY_AUTO:
+			LockedCourse = (int)lround(Wrap360(Heading)) % 360;
+			SetMode(Now, AUTO);
+			break;
+		case KEY_STANDBY:
+			SetMode(Now, STANDBY);
+			break;
+		case KEY_TRACK:
+			if (Mode == AUTO)
+				SetMode(Now, TRACK);
+			break;
+		case KEY_AUTOWIND:
+			if (Mode == AUTO)
+				SetMode(Now, AUTOWIND);
+			break;
+		case KEY_MINUS_1:
+		case KEY_MINUS_10:
+		case KEY_PLUS_1:
+		case KEY_PLUS_10:
+			if (Mode != STANDBY)
+			{
+				static const int Change[] = { -1, -10, 1, 10 };
+				LockedCourse = (int)Wrap360(LockedCourse + Change[Key - KEY_MINUS_1]);
+			}
+			break;
+		case KEY_RESPONSE_DISPLAY:
+			f.Sentence = Sentence("87,00,%02X", Response);
+			Frames.push_back(f);
+			break;
+		case KEY_RUDDERGAIN_DISPLAY:
+			f.Sentence = Sentence("91,00,%02X", RudderGain);
+			Frames.push_back(f);
+			break;
+		default:
+			Ignored++;
+			break;
+	}
+}
+
+void CourseComputerSim::SetMode(uint64_t Now, int NewMode)
+{
+	if (NewMode != STANDBY && Mode == STANDBY && StandbyPending > 0)
+	{
+		StandbyRecovery_ns.push_back(Now - m_StandbyFault);
+		StandbyPending = 0;
+	}
+	Mode = NewMode;
+}
+
+void CourseComputerSim::SpuriousStandby(uint64_t Now)
+{
+	if (Mode == STANDBY)
+		return;
+	Mode = STANDBY;
+	if (StandbyPending == 0)
+		m_StandbyFault = Now;
+	StandbyPending++;
+}
+
+void CourseComputerSim::OffCourse(double Degrees)
+{
+	Heading = Wrap360(Heading + Degrees);
+}
+
+void CourseComputerSim::WindShift(double Degrees)
+{
+	Wind = Wrap360(Wind + Degrees);
+	if (Mode == AUTOWIND)
+	{
+		// The pilot keeps the wind angle, so the course follows the wind.
+		LockedCourse = (int)lround(Wrap360(LockedCourse + Degrees)) % 360;
+		WindShiftAlarm = true;
+	}
+}
+
+// Heading follows the locked course with a rate given by the response level.
+void CourseComputerSim::Step(double Seconds)
+{
+	if (Seconds <= 0)
+		return;
+	std::normal_distribution<double> Noise(0.0, 1.0);
+	if (Mode == STANDBY)
+	{
+		Heading = Wrap360(Heading + Noise(m_Random) * Drift * Seconds);
+		return;
+	}
+	double Steered = Heading - m_Yaw;
+	double Error = Wrap180(LockedCourse - Steered);
+	double MaxTurn = (1.0 + Response) * Seconds;
+	double Turn = std::max(-MaxTurn, std::min(MaxTurn, Error));
+	Steered += Turn + Noise(m_Random) * 0.3 * Seconds;
+	// The waves yaw the boat, a higher response corrects more of it
+	if (SeaState > 0)
+		m_Yaw = m_Yaw * std::max(0.0, 1.0 - Response / 10.0 * Seconds) + Noise(m_Random) * SeaState * sqrt(Seconds);
+	else
+		m_Yaw = 0;
+	Heading = Wrap360(Steered + m_Yaw);
+}
+
+std::string CourseComputerSim::StatusSentence() const
+{
+	int h = (int)lround(Heading) % 360;
+	int c = LockedCourse % 360;
+	int U = (h / 90) | ((h % 90) & 1 ? 0x04 : 0x00);
+	int VW = ((c / 90) << 6) | ((h % 90) / 2);
+	int XY = (c % 90) * 2;
+	int Z = SIM_MODE_STANDBY, M = 0;
+	switch (Mode)
+	{
+		case AUTO: Z = SIM_MODE_AUTO; break;
+		case AUTOWIND: Z = SIM_MODE_AUTO | SIM_MODE_VANE; break;
+		case TRACK: Z = SIM_MODE_AUTO | SIM_MODE_TRACK; break;
+	}
+	double Error = Wrap180(LockedCourse - Heading);
+	if (Mode != STANDBY && fabs(Error) > OffCourseLimit)
+		M |= SIM_ALARM_OFFCOURSE;
+	if (WindShiftAlarm)
+		M |= SIM_ALARM_WINDSHIFT;
+	int Rudder = 0;
+	if (Mode != STANDBY)
+		Rudder = (int)std::max(-30.0, std::min(30.0, Error * RudderGain / 5.0));
+	return Sentence("84,%X6,%02X,%02X,%02X,%02X,%02X,02,06", U, VW, XY, Z, M, Rudder & 0xFF);
+}
+
+std::string CourseComputerSim::Sentence(const char *Format, ...) const
+{
+	char Buffer[96];
+	va_list Args;
+	va_start(Args, Format);
+	vsnprintf(Buffer, sizeof(Buffer), Format, Args);
+	va_end(Args);
+	std::string s = "$" + m_Name + "," + Buffer;
+	unsigned char Checksum = 0;
+	for (size_t i = 1; i < s.length(); i++)
+		Checksum ^= (unsigned char)s[i];
+	snprintf(Buffer, sizeof(Buffer), "*%02X\r\n", Checksum);
+	return s + Buffer;
+}
+
+bool CourseComputerSim::Chance(double Probability)
+{
+	if (Probability <= 0)
+		return false;
+	std::uniform_real_distribution<double> Uniform(0.0, 1.0);
+	return Uniform(m_Random) < Probability;
+}
+
+PassageSim::PassageSim()
+{
+	Speed = 6.0;
+	CurrentSet = 0;
+	CurrentDrift = 0;
+	ArrivalRadius = 0.05;
+	Lat = 0;
+	Lon = 0;
+	Cog = 0;
+	Sog = 0;
+	Distance = 0;
+	MaxXte = 0;
+	SumXte = 0;
+	Seconds = 0;
+	LegsDone = 0;
+	m_Started = false;
+	m_Route.resize(1);
+	m_Route[0].Name = "START";
+	m_Route[0].Lat = 0;
+	m_Route[0].Lon = 0;
+	m_Leg = 1;
+	m_LegSeconds = 0;
+}
+
+void PassageSim::Start(double StartLat, double StartLon)
+{
+	Lat = m_Route[0].Lat = StartLat;
+	Lon = m_Route[0].Lon = StartLon;
+	m_Started = true;
+	m_Leg = 1;
+	m_LegSeconds = 0;
+}
+
+void PassageSim::AddWaypoint(double WaypointLat, double WaypointLon)
+{
+	Waypoint w;
+	char Name[16];
+	snprintf(Name, sizeof(Name), "WP%u", (unsigned)m_Route.size());
+	w.Name = Name;
+	w.Lat = WaypointLat;
+	w.Lon = WaypointLon;
+	m_Route.push_back(w);
+}
+
+void PassageSim::Flat(const Waypoint &From, double PointLat, double PointLon, double &East, double &North) const
+{
+	East = Wrap180(PointLon - From.Lon) * 60.0 * cos(From.Lat * M_PI / 180.0);
+	North = (PointLat - From.Lat) * 60.0;
+}
+
+double PassageSim::Xte() const
+{
+	if (!Active())
+		return 0;
+	const Waypoint &From = m_Route[m_Leg - 1];
+	double LegEast, LegNorth, East, North;
+	Flat(From, m_Route[m_Leg].Lat, m_Route[m_Leg].Lon, LegEast, LegNorth);
+	Flat(From, Lat, Lon, East, North);
+	double Length = sqrt(LegEast * LegEast + LegNorth * LegNorth);
+	return Length > 0 ? (LegNorth * East - LegEast * North) / Length : 0;
+}
+
+void PassageSim::Step(double StepSeconds, double Heading)
+{
+	if (!m_Started || StepSeconds <= 0)
+		return;
+	double East = Speed * sin(Heading * M_PI / 180.0) + CurrentDrift * sin(CurrentSet * M_PI / 180.0);
+	double North = Speed * cos(Heading * M_PI / 180.0) + CurrentDrift * cos(CurrentSet * M_PI / 180.0);
+	Sog = sqrt(East * East + North * North);
+	Cog = Wrap360(atan2(East, North) * 180.0 / M_PI);
+	Lat += North * StepSeconds / 3600.0 / 60.0;
+	Lon = Wrap180(Lon + East * StepSeconds / 3600.0 / 60.0 / cos(Lat * M_PI / 180.0));
+	Distance += Sog * StepSeconds / 3600.0;
+	if (!Active())
+		return;
+	m_LegSeconds += StepSeconds;
+	if (m_LegSeconds > 300)
+	{
+		double x = fabs(Xte());
+		MaxXte = std::max(MaxXte, x);
+		SumXte += x * StepSeconds;
+		Seconds += StepSeconds;
+	}
+	// In the arrival circle or past the end of the leg
+	const Waypoint &From = m_Route[m_Leg - 1];
+	double LegEast, LegNorth;
+	Flat(From, m_Route[m_Leg].Lat, m_Route[m_Leg].Lon, LegEast, LegNorth);
+	Flat(m_Route[m_Leg], Lat, Lon, East, North);
+	if (sqrt(East * East + North * North) < ArrivalRadius || East * LegEast + North * LegNorth > 0)
+	{
+		m_Leg++;
+		LegsDone++;
+		m_LegSeconds = 0;
+	}
+}
+
+std::string PassageSim::RMB() const
+{
+	if (!Active())
+		return std::string();
+	const Waypoint &To = m_Route[m_Leg];
+	double East, North;
+	Flat(m_Route[m_Leg - 1], To.Lat, To.Lon, East, North);
+	double LegEast = East, LegNorth = North;
+	Flat(m_Route[m_Leg - 1], Lat, Lon, East, North);
+	double ToEast = LegEast - East, ToNorth = LegNorth - North;
+	double Range = sqrt(ToEast * ToEast + ToNorth * ToNorth);
+	double Bearing = Wrap360(atan2(ToEast, ToNorth) * 180.0 / M_PI);
+	double Velocity = Range > 0 ? Sog * cos((Bearing - Cog) * M_PI / 180.0) : 0;
+	double x = Xte(), AbsLat = fabs(To.Lat), AbsLon = fabs(To.Lon);
+	char Buffer[160];
+	// The direction to steer, left when starboard of the leg
+	snprintf(Buffer, sizeof(Buffer), "$ECRMB,A,%.3f,%c,%s,%s,%02d%06.3f,%c,%03d%06.3f,%c,%.2f,%.1f,%.1f,V",
+		fabs(x), x > 0 ? 'L' : 'R', m_Route[m_Leg - 1].Name.c_str(), To.Name.c_str(),
+		(int)AbsLat, (AbsLat - (int)AbsLat) * 60.0, To.Lat < 0 ? 'S' : 'N',
+		(int)AbsLon, (AbsLon - (int)AbsLon) * 60.0, To.Lon < 0 ? 'W' : 'E', Range, Bearing, Velocity);
+	std::string s = Buffer;
+	unsigned char Checksum = 0;
+	for (size_t i = 1; i < s.length(); i++)
+		Checksum ^= (unsigned char)s[i];
+	snprintf(Buffer, sizeof(Buffer), "*%02X\r\n", Checksum);
+	return s + Buffer;
+}
@@ -0,0 +1,175 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  autopilot Plugin, course computer simulator
+ * Author:   Dipl-Ing. Bernd Cirotzki
+ *
+ ***************************************************************************
+ *   Copyright (C) 2017 by Bernd Cirotzki                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ ***************************************************************************
+ */
+
+#ifndef _SEATALKSIM_H_
+#define _SEATALKSIM_H_
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// A sentence from the course computer to the plugin.
+// Commands holds the send times of the plugin commands which are seen in
+// this frame for the first time, so the harness can measure the latency.
+struct SimFrame
+{
+	uint64_t				Time;
+	std::string				Sentence;
+	std::vector<uint64_t>	Commands;
+};
+
+// Stand-in for a ST6002 / S1 course computer behind the NMEA <-> Seatalk
+// converter. It takes the 0x86 keystrokes and 0x92 parameters the plugin
+// sends and answers with 0x84 status every Period_ns, 0x87 response and
+// 0x91 rudder gain. All times are ns on the clock of the caller.
+class CourseComputerSim
+{
+public:
+	CourseComputerSim(const std::string &Name = "STALK");
+
+	void Seed(unsigned Value) { m_Random.seed(Value); }
+
+	// Plugin -> course computer, the sentence reaches it after BusDelay_ns.
+	void Receive(uint64_t Now, const std::string &sentence);
+	// Course computer -> plugin, all frames due until Now, in time order.
+	void Run(uint64_t Now, std::vector<SimFrame> &Frames);
+
+	// Faults
+	void SpuriousStandby(uint64_t Now);		// e.g. power glitch of the drive
+	void OffCourse(double Degrees);			// a wave pushes the bow away
+	void WindShift(double Degrees);
+
+	// Settings
+	uint64_t	Period_ns;
+	uint64_t	BusDelay_ns;
+	double		LossProbability;			// 0x84 frames not delivered
+	double		DuplicateProbability;		// 0x84 frames delivered twice
+	double		KeyLossProbability;			// 0x86 keystrokes of the plugin lost on the bus
+	int			OffCourseLimit;				// degrees, alarm above
+	double		Drift;						// degrees/s random walk in standby
+	double		SeaState;					// degrees, yaw of the waves per second, the pilot takes Response / 10 of it out
+	bool		Echo;						// every sentence of the plugin comes back, like from the OpenCPN multiplexer
+
+	// State
+	int			Mode;
+	double		Heading;
+	int			LockedCourse;
+	double		Wind;
+	int			Response;
+	int			RudderGain;
+	int			WindTrim;
+	std::map<int, int>	Calibration;	// other parameters of 0x92, by XX
+	bool		WindShiftAlarm;
+
+	// Results
+	uint64_t				Received;
+	uint64_t				Ignored;
+	uint64_t				Lost;
+	uint64_t				Duplicated;
+	uint64_t				KeysLost;
+	uint64_t				Echoed;
+	std::vector<uint64_t>	StandbyRecovery_ns;	// spurious standby until the plugin put it back into a mode
+	int						StandbyPending;		// spurious standbys not recovered yet
+
+private:
+	struct Pending
+	{
+		uint64_t	Time;		// sent by the plugin
+		std::string	Sentence;
+	};
+
+	void Apply(uint64_t Now, const Pending &p, std::vector<SimFrame> &Frames);
+	void Key(uint64_t Now, int Key, std::vector<SimFrame> &Frames);
+	void Step(double Seconds);
+	void SetMode(uint64_t Now, int NewMode);
+	std::string StatusSentence() const;
+	std::string Sentence(const char *Format, ...) const;
+	bool Chance(double Probability);
+
+	std::string				m_Name;
+	std::deque<Pending>		m_Inbound;
+	std::deque<Pending>		m_Echoes;
+	std::vector<uint64_t>	m_Unacknowledged;
+	uint64_t				m_NextFrame;
+	uint64_t				m_LastStep;
+	uint64_t				m_StandbyFault;
+	double					m_Yaw;			// of the waves, in Heading
+	std::mt19937			m_Random;
+};
+
+// The boat on a passage, for the track control: dead reckoning with the
+// heading of the course computer (as true), the speed through the water and
+// a current, along a route like OpenCPN follows it. RMB of the active leg
+// is what OpenCPN sends, the fix what it gives to SetPositionFixEx.
+class PassageSim
+{
+public:
+	PassageSim();
+
+	void Start(double Lat, double Lon);
+	void AddWaypoint(double Lat, double Lon);	// named WP1, WP2, ...
+	void Step(double Seconds, double Heading);
+	bool Active() const { return m_Started && m_Leg < m_Route.size(); }
+	// Empty when the route is done
+	std::string RMB() const;
+	// nm, positive is starboard of the leg
+	double Xte() const;
+
+	// Settings
+	double		Speed;			// knots through the water
+	double		CurrentSet;		// degrees true, where the current goes to
+	double		CurrentDrift;	// knots
+	double		ArrivalRadius;	// nm, then the next leg
+
+	// State
+	double		Lat;
+	double		Lon;
+	double		Cog;
+	double		Sog;
+
+	// Results
+	double		Distance;		// nm over ground
+	double		MaxXte;			// nm, |XTE| after the first 5 minutes of each leg
+	double		SumXte;			// |XTE| * seconds of the same
+	double		Seconds;
+	size_t		LegsDone;
+
+private:
+	struct Waypoint
+	{
+		std::string	Name;
+		double		Lat;
+		double		Lon;
+	};
+
+	void Flat(const Waypoint &From, double PointLat, double PointLon, double &East, double &North) const;
+
+	bool					m_Started;
+	std::vector<Waypoint>	m_Route;	// [0] is the start
+	size_t					m_Leg;		// destination
+	double					m_LegSeconds;
+};
+
+#endif